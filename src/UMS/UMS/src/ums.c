@@ -8,11 +8,13 @@
 #include <sys/ioctl.h>
 #include <pthread.h>
 #include <errno.h>
+#include <signal.h>
 pid_t tgid = -1;
 int ums_fd = -1;
 
 static inline int create_process(pid_t tgid);
 static inline int delete_process(pid_t tgid);
+static void ums_park_signal_handler(int sig);
 
 
 // -----------------------------------------------------------------------------------------------------
@@ -20,11 +22,20 @@ static inline int delete_process(pid_t tgid);
 
 res_t ums_init(){
     int res;
-    ums_fd = open("/dev/UMS", 0);
+    ums_fd = open("/dev/UMS", O_RDWR);   // writable, for the shared mapping of the ums_ring
     if(ums_fd == -1){
         errno = ERR_INTERNAL;
         return -1;    
     }
+    // sent by the LKM to a ums thread at the end of its quantum or when it wakes up after blocking
+    struct sigaction park_action = {
+        .sa_handler = ums_park_signal_handler,
+        .sa_flags = SA_RESTART
+    };
+    sigemptyset(&park_action.sa_mask);
+    if(sigaction(UMS_PARK_SIGNAL, &park_action, NULL) == -1)
+        return -1;
+
     tgid = getpid();
     //NOTE: getpid() return tgid
     //      gettid() return thread-s pid
@@ -65,3 +76,11 @@ static inline int delete_process(pid_t tgid){
     res = ioctl(ums_fd, RQ_DELETE_PROCESS, &args);
     return (res == -1)?errno:SUCCESS; 
 }
+
+static void ums_park_signal_handler(int sig){
+    int errno_backup = errno;
+    rq_park_ums_context_args_t rq_args;
+
+    ioctl(ums_fd, RQ_PARK_UMS_CONTEXT, &rq_args);  // returns when a scheduler executes the ums_context again
+    errno = errno_backup;
+}
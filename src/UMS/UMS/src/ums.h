@@ -12,6 +12,18 @@
 
 typedef pthread_t ums_scheduler_descriptor_t;
 
+/**
+ * @brief optional attributes of a ums_scheduler, see create_ums_scheduler_attr()
+ * 
+ */
+typedef struct ums_scheduler_attr_t{
+    int pool_size;      /** maximum number of parked worker threads kept by the scheduler, 0 to create a thread for each new ums_context */
+    int pool_warm_up;   /** number of worker threads created at startup of the scheduler (at most pool_size) */
+    unsigned int quantum_us;    /** time slice of a ums_context in microseconds, then it is preempted (REASON_THREAD_PREEMPTED). 0 to disable the preemption */
+    int ring;   /** if not 0, the ums_ring of the scheduler is mapped at startup, see ums_ring_setup() */
+    int state;  /** if not 0, the state pages of the scheduler are mapped at startup, see ums_state_setup() */
+}ums_scheduler_attr_t;
+
 extern pid_t tgid;
 extern int ums_fd;
 
@@ -47,6 +59,44 @@ res_t ums_destroy(void);
  */
 res_t create_ums_context(ums_context_descriptor_t* descriptor,void* (*routine)(void*), void* args, void* user_res);
 
+/**
+ * Creates a ums_context object with a priority
+ * 
+ * Same as create_ums_context(), that uses UMS_PRIO_DEFAULT
+ * @param descriptor Pointer used to save the ums_context_descriptor assigned
+ * @param routine Function poiter to the routine of the new ums_context
+ * @param args Arguments to be passed to the ums_context's routine 
+ * @param user_res user managed object
+ * @param prio priority, from UMS_PRIO_HIGHEST (0) to UMS_PRIO_LOWEST, otherwise errno is set to EINVAL
+ * 
+ * @return Returns 0 on sucess, otherwise -1 and sets errno according to  
+ */
+res_t create_ums_context_prio(ums_context_descriptor_t* descriptor,void* (*routine)(void*), void* args, void* user_res, int prio);
+
+/**
+ * Creates several ums_context objects
+ * 
+ * It performs a RQ_CREATE_UMS_CONTEXT_BATCH request for each UMS_BATCH_MAX ums_contexts, instead of a request for each one.
+ * Either all the ums_contexts are created or none
+ * @param descriptors Array of num elements used to save the ums_context_descriptors assigned, in the same order of items
+ * @param items Array of num attributes (routine, args, user_res and prio) of the new ums_contexts
+ * @param num Number of ums_contexts to create
+ * 
+ * @return Returns 0 on sucess, otherwise -1 and sets errno according to  
+ */
+res_t create_ums_contexts_batch(ums_context_descriptor_t* descriptors, const ums_context_batch_item_t* items, int num);
+
+/**
+ * Changes the priority of a ums_context
+ * 
+ * It performs a RQ_SET_UMS_CONTEXT_PRIO request, it can be used at any time, also on a ums_context in a ready_list
+ * @param descriptor Descriptor of the ums_context
+ * @param prio new priority, from UMS_PRIO_HIGHEST (0) to UMS_PRIO_LOWEST, otherwise errno is set to EINVAL
+ * 
+ * @return Returns 0 on sucess, otherwise -1 and sets errno according to  
+ */
+res_t set_ums_context_prio(ums_context_descriptor_t descriptor, int prio);
+
 
 /**
  * Deletes a ums_context
@@ -87,6 +137,18 @@ res_t delete_ums_completion_list(ums_completion_list_descriptor_t ums_completion
  */
 res_t completion_list_add_ums_context(ums_completion_list_descriptor_t completion_list_d, ums_context_descriptor_t ums_context_d);
 
+/**
+ * @brief Add several ums_contexts to a ums_completion_list
+ * 
+ * It performs a RQ_COMPLETION_LIST_ADD_UMS_CONTEXT_BATCH request for each UMS_BATCH_MAX ums_contexts.
+ * Either all the ums_contexts are added or none
+ * @param completion_list_d Descriptor of the ums_completion_list 
+ * @param descriptors Array of num descriptors of the ums_contexts to add
+ * @param num Number of ums_contexts to add
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to   
+ */
+res_t completion_list_add_batch(ums_completion_list_descriptor_t completion_list_d, const ums_context_descriptor_t* descriptors, int num);
+
 /**
  * @brief Remove a ums_context from a ums_completion_list
  * 
@@ -114,6 +176,25 @@ res_t completion_list_remove_ums_context(ums_completion_list_descriptor_t comple
  */
 res_t create_ums_scheduler(ums_scheduler_descriptor_t* sd, ums_completion_list_descriptor_t cd, void(*entry_point)(entry_point_args_t* entry_point_args), void* sched_args, int cpu_core);
 
+/**
+ * @brief Create a ums scheduler object with attributes
+ * 
+ * Same as create_ums_scheduler(), sched_attr can be NULL to use default attributes.
+ * If sched_attr->pool_size > 0 the scheduler keeps a pool of worker threads pinned to cpu_core: a new ums_context
+ * is run by a parked worker instead of a new thread and the worker returns to the pool when the ums_context ends.
+ * If sched_attr->quantum_us > 0 a ums_context that runs for quantum_us without leaving the CPU is put in the ready_list
+ * and the entry_point is called with REASON_THREAD_PREEMPTED
+ * 
+ * @param sd Pointer used to store the descriptor of the new ums_scheduler
+ * @param cd Descriptor of the ums_completion_list to use
+ * @param entry_point Entry_point function of the scheduler
+ * @param sched_args Arguments to pass to entry_point functions
+ * @param cpu_core CPU core to use
+ * @param sched_attr Attributes of the scheduler
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to 
+ */
+res_t create_ums_scheduler_attr(ums_scheduler_descriptor_t* sd, ums_completion_list_descriptor_t cd, void(*entry_point)(entry_point_args_t* entry_point_args), void* sched_args, int cpu_core, const ums_scheduler_attr_t* sched_attr);
+
 /**
  * @brief exit() function for the scheduler
  * 
@@ -123,6 +204,107 @@ res_t create_ums_scheduler(ums_scheduler_descriptor_t* sd, ums_completion_list_d
  */
 void exit_scheduler(int return_value);
 
+/**
+ * @brief Park the scheduler until there is something to do
+ * 
+ * This function must be used in the entry_point function when both the ums_completion_list and the ready_list are empty.
+ * It performs a RQ_PARK_UMS_SCHEDULER request: the scheduler sleeps until a ums_context is added to its ums_completion_list,
+ * or a ums_context becomes ready in its ready_list or in the one of a sibling that it can steal from.
+ * NOTE: it returns to the entry_point, that should try again to execute a ums_context
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to (EINTR if interrupted by a signal)
+ */
+res_t park_scheduler(void);
+
+/**
+ * @brief Map the ums_ring of the calling scheduler, the queues shared with the kernel module (see ums_ring.h)
+ * 
+ * It must be called by the scheduler thread (e.g. in the entry_point, or with ums_scheduler_attr_t.ring).
+ * The requests queued in the submission queue are executed at the next ums_ring_submit() or, without a syscall,
+ * when the entry_point returns. Their results and the events of the ums_contexts (yield, end, blocked, preempted)
+ * are posted in the completion queue. The other functions of the API still work as before.
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to 
+ */
+res_t ums_ring_setup(void);
+
+/**
+ * @brief Unmap the ums_ring of the calling scheduler, done at the end of the scheduler thread
+ * 
+ */
+void ums_ring_teardown(void);
+
+/**
+ * @brief Get a free entry of the submission queue, initialized as UMS_SQE_NOP
+ * 
+ * The user sets opcode and arguments, the entry is given to the kernel by ums_ring_flush() or ums_ring_submit()
+ * @return ums_sqe_t* pointer to the entry, NULL if the queue is full (errno EBUSY) or not mapped (errno EINVAL)
+ */
+ums_sqe_t* ums_ring_get_sqe(void);
+
+/**
+ * @brief Give the entries got by ums_ring_get_sqe() to the kernel, without a syscall
+ * 
+ * They are executed when the entry_point returns
+ */
+void ums_ring_flush(void);
+
+/**
+ * @brief Give the entries got by ums_ring_get_sqe() to the kernel and execute them now
+ * 
+ * It performs a RQ_UMS_RING_ENTER request
+ * @return res_t Returns the number of entries executed, otherwise -1 and sets errno according to 
+ */
+res_t ums_ring_submit(void);
+
+/**
+ * @brief Get the oldest entry of the completion queue, without removing it
+ * 
+ * @return ums_cqe_t* pointer to the entry, NULL if the queue is empty
+ */
+ums_cqe_t* ums_ring_peek_cqe(void);
+
+/**
+ * @brief Remove the entry returned by ums_ring_peek_cqe() from the completion queue
+ * 
+ */
+void ums_ring_cqe_seen(void);
+
+/**
+ * @brief Map the state pages of the calling scheduler, a read-only view of its lists kept up to date by the kernel module (see ums_state.h)
+ * 
+ * It must be called by the scheduler thread (e.g. in the entry_point, or with ums_scheduler_attr_t.state).
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to 
+ */
+res_t ums_state_setup(void);
+
+/**
+ * @brief Unmap the state pages of the calling scheduler, done at the end of the scheduler thread
+ * 
+ */
+void ums_state_teardown(void);
+
+/**
+ * @brief Copy the ums_contexts in the ready_list of the calling scheduler, without a syscall
+ * 
+ * The ums_contexts are in order of arrival, the first UMS_STATE_LIST_MAX are shown
+ * @param out array of at least max entries
+ * @param max size of out
+ * @param p_num output, it can be NULL. Number of ums_contexts in the ready_list, it can be greater than the entries copied
+ * @return int number of entries copied, otherwise -1 and sets errno (EINVAL if not mapped)
+ */
+int ums_state_read_ready_list(ums_state_context_t* out, int max, int* p_num);
+
+/**
+ * @brief Copy the ums_contexts in the ums_completion_list of the calling scheduler, without a syscall
+ * 
+ * The ums_contexts are in order of the list, the first UMS_STATE_LIST_MAX are shown.
+ * NOTE: a sibling can take the ums_contexts in the meantime, execute() fails with ERR_ASSIGNED
+ * @param out array of at least max entries
+ * @param max size of out
+ * @param p_num output, it can be NULL. Number of ums_contexts in the ums_completion_list, it can be greater than the entries copied
+ * @return int number of entries copied, otherwise -1 and sets errno (EINVAL if not mapped)
+ */
+int ums_state_read_completion_list(ums_state_context_t* out, int max, int* p_num);
+
 /**
  * @brief Execute the next ums_context in the ums_completion_list of the scheduler
  * 
@@ -141,6 +323,16 @@ res_t execute_next_new_thread(void);
  */
 res_t execute_next_ready_thread(void);
 
+/**
+ * @brief Execute the ums_context with the highest priority in the ready_list of the scheduler
+ * 
+ * It performs a RQ_EXECUTE_HIGHEST_PRIO_READY_THREAD request, in O(1) and without copying the ready_list to the user.
+ * Among ums_contexts with the same priority, the one that waits from more time is chosen
+ * NOTE: It always returns a value, due to the fact that at every call of the entry_point of the scheduler, the entire entry_point function is executed!
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to 
+ */
+res_t execute_highest_prio_ready_thread(void);
+
 
 
 /**
@@ -161,14 +353,26 @@ res_t join_scheduler(ums_scheduler_descriptor_t* usd, int* return_value);
  */
 res_t yield(void);
 
+/**
+ * @brief Current ums_context in execution leaves the control directly to another ums_context
+ * 
+ * It performs a RQ_SWITCH_TO_UMS_CONTEXT request, the scheduler thread is not woken up.
+ * The current ums_context is put in the ready_list as for yield()
+ * NOTE: ucd must be idle in the ready_list of the same scheduler, otherwise errno is set to ERR_INVALID_UCD
+ * @param ucd Descriptor of the ums_context to execute
+ * @return res_t Returns 0 on sucess, otherwise -1 and sets errno according to 
+ */
+res_t switch_to(ums_context_descriptor_t ucd);
+
 /**
  * @brief Get the ums contexts from the completion_list of the scheduler
  * 
  * @param array_info_ums_context output, array of info_ums_context_t
  * @param array_size input, size of array, maximum number of ums_context to read
- * @return return (>0) the number of context readed, return -1 on failure and set errno according to
+ * @return return (>0) the number of context readed (at most UMS_BATCH_MAX), return -1 on failure and set errno according to
  * 
- * NOTE: After a successfully execution, execute() function must be always called
+ * NOTE: It is a snapshot, nothing is held after it returns. execute() claims the chosen ums_context and fails with ERR_STALE
+ * if it is no longer in the completion_list, or ERR_ASSIGNED if a sibling got it first: then choose another one
  */
 res_t get_ums_contexts_from_cl(info_ums_context_t* array_info_ums_context, size_t array_size);
 
@@ -179,7 +383,8 @@ res_t get_ums_contexts_from_cl(info_ums_context_t* array_info_ums_context, size_
  * @param array_size input, size of array, maximum number of ums_context to read
  * @return return (>0) the number of context readed, return -1 on failure and set errno according to
  * 
- * NOTE: After a successfully execution, execute() function must be always called
+ * NOTE: It is a snapshot, nothing is held after it returns: execute() may be called for one of the ums_contexts or for none.
+ * It fails with ERR_INVALID_UCD if the ums_context no longer waits in the ready_list (e.g. a sibling stole it)
  */
 res_t get_ums_contexts_from_rl(info_ums_context_t* array_info_ums_context, size_t array_size);
 
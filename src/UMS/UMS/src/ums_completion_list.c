@@ -8,6 +8,7 @@
 #include "ums.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 
 // -----------------------------------------------------------------------------------------------------
 res_t create_ums_completion_list(ums_completion_list_descriptor_t* ums_completion_list_descriptor){
@@ -36,6 +37,31 @@ res_t completion_list_add_ums_context(ums_completion_list_descriptor_t completio
     };
     return ioctl(ums_fd, RQ_COMPLETION_LIST_ADD_UMS_CONTEXT, &rq_args);
 }
+res_t completion_list_add_batch(ums_completion_list_descriptor_t completion_list_d, const ums_context_descriptor_t* descriptors, int num){
+    rq_completion_list_add_ums_context_batch_args_t rq_args = {
+        .tgid = tgid,
+        .completion_list_d = completion_list_d
+    };
+    res_t res = SUCCESS;
+    int errno_backup;
+    int done;
+
+    for(done = 0; done < num; done += rq_args.num){
+        rq_args.num = (num - done < UMS_BATCH_MAX) ? num - done : UMS_BATCH_MAX;
+        rq_args.descriptors = descriptors + done;
+        res = ioctl(ums_fd, RQ_COMPLETION_LIST_ADD_UMS_CONTEXT_BATCH, &rq_args);
+        if(res != SUCCESS)
+            break;
+    }
+
+    if(res != SUCCESS){ // all or nothing
+        errno_backup = errno;
+        for(int i = 0; i < done; i++)
+            completion_list_remove_ums_context(completion_list_d, descriptors[i]);
+        errno = errno_backup;
+    }
+    return res;
+}
 res_t completion_list_remove_ums_context(ums_completion_list_descriptor_t completion_list_d, ums_context_descriptor_t ums_context_d){
     rq_completion_list_add_remove_ums_context_args_t rq_args = {
         .tgid = tgid,
@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <sys/ioctl.h>
 #include "ums.h"
+#include "ums_worker_pool.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -17,18 +18,47 @@
 
 // -----------------------------------------------------------------------------------------------------
 res_t create_ums_context(ums_context_descriptor_t* descriptor, void* (*routine)(void*), void* args, void* user_res){
+    return create_ums_context_prio(descriptor, routine, args, user_res, UMS_PRIO_DEFAULT);
+}
+res_t create_ums_context_prio(ums_context_descriptor_t* descriptor, void* (*routine)(void*), void* args, void* user_res, int prio){
     rq_create_delete_ums_context_args_t rq_args = {
         .tgid = tgid,
         .routine = routine,
         .args = args,
         .descriptor = -1,
-        .user_res = user_res
+        .user_res = user_res,
+        .prio = prio
     };
     res_t res = ioctl(ums_fd, RQ_CREATE_UMS_CONTEXT, &rq_args); 
     
     *descriptor = rq_args.descriptor;
     return res;
 }
+res_t create_ums_contexts_batch(ums_context_descriptor_t* descriptors, const ums_context_batch_item_t* items, int num){
+    rq_create_ums_context_batch_args_t rq_args = {
+        .tgid = tgid
+    };
+    res_t res = SUCCESS;
+    int errno_backup;
+    int done;
+
+    for(done = 0; done < num; done += rq_args.num){
+        rq_args.num = (num - done < UMS_BATCH_MAX) ? num - done : UMS_BATCH_MAX;
+        rq_args.items = items + done;
+        rq_args.descriptors = descriptors + done;
+        res = ioctl(ums_fd, RQ_CREATE_UMS_CONTEXT_BATCH, &rq_args);
+        if(res != SUCCESS)
+            break;
+    }
+
+    if(res != SUCCESS){ // all or nothing
+        errno_backup = errno;
+        for(int i = 0; i < done; i++)
+            delete_ums_context(descriptors[i]);
+        errno = errno_backup;
+    }
+    return res;
+}
 res_t delete_ums_context(ums_context_descriptor_t descriptor){
     rq_create_delete_ums_context_args_t rq_args = {
         .tgid = tgid,
@@ -38,19 +68,18 @@ res_t delete_ums_context(ums_context_descriptor_t descriptor){
     };
     return ioctl(ums_fd, RQ_DELETE_UMS_CONTEXT, &rq_args); 
 }
+res_t set_ums_context_prio(ums_context_descriptor_t descriptor, int prio){
+    rq_set_ums_context_prio_args_t rq_args = {
+        .ucd = descriptor,
+        .prio = prio
+    };
+    return ioctl(ums_fd, RQ_SET_UMS_CONTEXT_PRIO, &rq_args); 
+}
 // -----------------------------------------------------------------------------------------------------
 
 
 
 // -----------------------------------------------------------------------------------------------------
-typedef struct startup_new_thread_args_t{
-    ums_context_descriptor_t ucd;
-    pid_t sheduler_pid;
-
-    void* (*routine)(void*);
-    void* args_routine;
-}startup_new_thread_args_t;
-
 void* startup_new_thread(void* args){
     startup_new_thread_args_t* startup_new_thread_args = (startup_new_thread_args_t*)args;
     int res;
@@ -112,11 +141,11 @@ res_t execute_next_new_thread(){
         .args_routine = rq_args.args,
     };
     
-    if(rq_args.cpu_core == -1)
+    if(ums_scheduler_worker_pool != NULL)
+        res = ums_worker_pool_dispatch(ums_scheduler_worker_pool, &startup_new_thread_args);
+    else if(rq_args.cpu_core == -1)
         res = pthread_create(&thread, NULL, startup_new_thread, &startup_new_thread_args);
     else{
-        printf("new thread at cpu%d\n", rq_args.cpu_core);
-
         pthread_attr_init(&attr);
         CPU_ZERO(&cpu_set);
         CPU_SET(rq_args.cpu_core, &cpu_set);
@@ -135,6 +164,14 @@ res_t execute_next_ready_thread(){
     res = ioctl(ums_fd, RQ_EXECUTE_NEXT_READY_THREAD, &rq_args);
     return res;
 }
+
+res_t execute_highest_prio_ready_thread(){
+    int res;
+    rq_execute_next_ready_thread_args_t rq_args;
+
+    res = ioctl(ums_fd, RQ_EXECUTE_HIGHEST_PRIO_READY_THREAD, &rq_args);
+    return res;
+}
 // -----------------------------------------------------------------------------------------------------
 
 // -------------------------------------------------------------------
@@ -143,6 +180,14 @@ res_t yield(void){
     int res = ioctl(ums_fd, RQ_YIELD_UMS_CONTEXT, &rq_args);
     return res;
 }
+
+res_t switch_to(ums_context_descriptor_t ucd){
+    rq_switch_to_ums_context_args_t rq_args = {
+        .ucd = ucd
+    };
+    int res = ioctl(ums_fd, RQ_SWITCH_TO_UMS_CONTEXT, &rq_args);
+    return res;
+}
 // --------------------------------------------------------------------
 
 // --------------------------------------------------------------
@@ -164,24 +209,20 @@ res_t execute(info_ums_context_t* info_ums_context){
     };
     
     if(info_ums_context->from_cl){
-        printf("new thread \n");
-
         res = ioctl(ums_fd, RQ_EXECUTE, &rq_args);
         if(res!=0)  return res;
         
-        if(res==0)
-            printf("ucd=%d, routine=%lx args=%lx\n", rq_args.ucd, (unsigned long)rq_args.routine, (unsigned long)rq_args.args);
-        
         startup_new_thread_args_t startup_new_thread_args = {
             .ucd = rq_args.ucd,
             .sheduler_pid = rq_args.pid_scheduler,
             .routine = rq_args.routine,
             .args_routine = rq_args.args
         };
-        if(rq_args.cpu_core == -1)
+        if(ums_scheduler_worker_pool != NULL)
+            res = ums_worker_pool_dispatch(ums_scheduler_worker_pool, &startup_new_thread_args);
+        else if(rq_args.cpu_core == -1)
             res = pthread_create(&thread, NULL, startup_new_thread, &startup_new_thread_args);
         else{
-            printf("new thread at cpu%d\n", rq_args.cpu_core);
             pthread_attr_init(&attr);
             CPU_ZERO(&cpu_set);
             CPU_SET(rq_args.cpu_core, &cpu_set);
@@ -191,7 +232,6 @@ res_t execute(info_ums_context_t* info_ums_context){
         //pthread_create(&thread, NULL, startup_new_thread, &startup_new_thread_args);
     }
     else{
-        printf("from ready\n");
         res = ioctl(ums_fd, RQ_EXECUTE_READY_LIST, &rq_args);
     }
     return res;
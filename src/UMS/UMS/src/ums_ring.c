@@ -0,0 +1,108 @@
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../../common/ums_requests.h"
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "ums.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+// ums_ring of the scheduler thread, NULL if not mapped
+__thread ums_ring_shared_t* ums_scheduler_ring = NULL;
+// next free sqe, published in sq_tail by ums_ring_flush()
+static __thread unsigned int ums_scheduler_ring_sq_tail = 0;
+
+static inline size_t ums_ring_mmap_size(void){
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return (sizeof(ums_ring_shared_t) + page_size - 1) & ~(page_size - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------
+res_t ums_ring_setup(void){
+    void* ring;
+
+    if(ums_scheduler_ring != NULL)
+        return SUCCESS;
+
+    ring = mmap(NULL, ums_ring_mmap_size(), PROT_READ | PROT_WRITE, MAP_SHARED, ums_fd, 0);
+    if(ring == MAP_FAILED)
+        return -1;
+
+    ums_scheduler_ring = (ums_ring_shared_t*)ring;
+    ums_scheduler_ring_sq_tail = __atomic_load_n(&ums_scheduler_ring->sq_tail, __ATOMIC_RELAXED);
+    return SUCCESS;
+}
+
+void ums_ring_teardown(void){
+    if(ums_scheduler_ring == NULL)
+        return;
+    munmap(ums_scheduler_ring, ums_ring_mmap_size());
+    ums_scheduler_ring = NULL;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+ums_sqe_t* ums_ring_get_sqe(void){
+    ums_sqe_t* sqe;
+    unsigned int sq_head;
+
+    if(ums_scheduler_ring == NULL){
+        errno = EINVAL;
+        return NULL;
+    }
+
+    sq_head = __atomic_load_n(&ums_scheduler_ring->sq_head, __ATOMIC_ACQUIRE);
+    if(ums_scheduler_ring_sq_tail - sq_head >= UMS_RING_SQ_ENTRIES){
+        errno = EBUSY;  // full, submit first
+        return NULL;
+    }
+
+    sqe = &ums_scheduler_ring->sqes[ums_scheduler_ring_sq_tail & (UMS_RING_SQ_ENTRIES - 1)];
+    ums_scheduler_ring_sq_tail++;
+    sqe->opcode = UMS_SQE_NOP;
+    sqe->prio = UMS_PRIO_DEFAULT;
+    sqe->ucd = -1;
+    sqe->cld = -1;
+    sqe->routine = NULL;
+    sqe->args = NULL;
+    sqe->user_res = NULL;
+    sqe->user_data = 0;
+    return sqe;
+}
+
+void ums_ring_flush(void){
+    if(ums_scheduler_ring != NULL)
+        __atomic_store_n(&ums_scheduler_ring->sq_tail, ums_scheduler_ring_sq_tail, __ATOMIC_RELEASE);
+}
+
+res_t ums_ring_submit(void){
+    rq_ums_ring_enter_args_t rq_args = {
+        .to_submit = UMS_RING_SQ_ENTRIES
+    };
+
+    ums_ring_flush();
+    return ioctl(ums_fd, RQ_UMS_RING_ENTER, &rq_args);
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+ums_cqe_t* ums_ring_peek_cqe(void){
+    unsigned int cq_head;
+
+    if(ums_scheduler_ring == NULL)
+        return NULL;
+
+    cq_head = ums_scheduler_ring->cq_head;
+    if(cq_head == __atomic_load_n(&ums_scheduler_ring->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &ums_scheduler_ring->cqes[cq_head & (UMS_RING_CQ_ENTRIES - 1)];
+}
+
+void ums_ring_cqe_seen(void){
+    __atomic_store_n(&ums_scheduler_ring->cq_head, ums_scheduler_ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+// -----------------------------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <sys/ioctl.h>
 #include "ums.h"
+#include "ums_worker_pool.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/sysinfo.h>
@@ -41,6 +42,18 @@ void* create_ums_scheduler_routine(void* args){
         exit(EXIT_FAILURE);
     }
 
+    if(rq_args->pool_size > 0){
+        ums_scheduler_worker_pool = ums_worker_pool_create(rq_args->cpu_core, rq_args->pool_size, rq_args->pool_warm_up);
+        if(ums_scheduler_worker_pool == NULL)
+            printf("Error! worker pool not created, a thread will be created for each ums_context\n");
+    }
+
+    if(rq_args->ring && ums_ring_setup() == FAILURE)
+        printf("Error! ums_ring not mapped\n");
+
+    if(rq_args->state && ums_state_setup() == FAILURE)
+        printf("Error! state pages not mapped\n");
+
     // CONST
     entry_point_args.sched_args = rq_args->sched_args;
     // VARIABLE
@@ -67,6 +80,12 @@ void* create_ums_scheduler_routine(void* args){
         }
     }
     // CLEAN
+    ums_ring_teardown();
+    ums_state_teardown();
+    if(ums_scheduler_worker_pool != NULL){
+        ums_worker_pool_destroy(ums_scheduler_worker_pool);
+        ums_scheduler_worker_pool = NULL;
+    }
     free(rq_args);
 
     // return value of the scheduler
@@ -74,6 +93,10 @@ void* create_ums_scheduler_routine(void* args){
 }
 
 res_t create_ums_scheduler(ums_scheduler_descriptor_t* sd, ums_completion_list_descriptor_t cd, void(*entry_point)(entry_point_args_t* entry_point_args), void* sched_args, int cpu_core){
+    return create_ums_scheduler_attr(sd, cd, entry_point, sched_args, cpu_core, NULL);
+}
+
+res_t create_ums_scheduler_attr(ums_scheduler_descriptor_t* sd, ums_completion_list_descriptor_t cd, void(*entry_point)(entry_point_args_t* entry_point_args), void* sched_args, int cpu_core, const ums_scheduler_attr_t* sched_attr){
     int res;
     cpu_set_t cpu_set;
     pthread_attr_t attr;
@@ -93,6 +116,11 @@ res_t create_ums_scheduler(ums_scheduler_descriptor_t* sd, ums_completion_list_d
     rq_args->entry_point_func = entry_point;
     rq_args->sched_args = sched_args;
     rq_args->cpu_core = cpu_core;
+    rq_args->pool_size = (sched_attr != NULL && sched_attr->pool_size > 0)? sched_attr->pool_size : 0;
+    rq_args->pool_warm_up = (sched_attr != NULL && sched_attr->pool_warm_up > 0)? sched_attr->pool_warm_up : 0;
+    rq_args->quantum_us = (sched_attr != NULL)? sched_attr->quantum_us : 0;
+    rq_args->ring = (sched_attr != NULL)? sched_attr->ring : 0;
+    rq_args->state = (sched_attr != NULL)? sched_attr->state : 0;
     if(cpu_core == -1)
         res = pthread_create(thread_sched, NULL, create_ums_scheduler_routine, (void*)rq_args);
     else{
@@ -121,6 +149,12 @@ void exit_scheduler(int return_value){
         exit(EXIT_FAILURE);
     }
 }
+
+res_t park_scheduler(void){
+    rq_park_ums_scheduler_args_t rq_args;
+    int res = ioctl(ums_fd, RQ_PARK_UMS_SCHEDULER, &rq_args);
+    return res;
+}
 // -----------------------------------------------------------------------------------------------------
 
 
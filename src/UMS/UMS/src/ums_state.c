@@ -0,0 +1,80 @@
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../../common/ums_requests.h"
+#include <sys/mman.h>
+#include "ums.h"
+#include <string.h>
+#include <errno.h>
+
+// state pages of the scheduler thread, NULL if not mapped: [0] ready_list, [1] ums_completion_list
+static __thread ums_state_list_t* ums_scheduler_state[2] = {NULL, NULL};
+
+// -----------------------------------------------------------------------------------------------------
+res_t ums_state_setup(void){
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    void* pages;
+
+    if(ums_scheduler_state[0] != NULL)
+        return SUCCESS;
+
+    pages = mmap(NULL, 2*page_size, PROT_READ, MAP_SHARED, ums_fd, UMS_STATE_MMAP_OFFSET);
+    if(pages == MAP_FAILED)
+        return -1;
+
+    ums_scheduler_state[0] = (ums_state_list_t*)pages;
+    ums_scheduler_state[1] = (ums_state_list_t*)((char*)pages + page_size);
+    return SUCCESS;
+}
+
+void ums_state_teardown(void){
+    if(ums_scheduler_state[0] == NULL)
+        return;
+    munmap(ums_scheduler_state[0], 2*(size_t)sysconf(_SC_PAGESIZE));
+    ums_scheduler_state[0] = NULL;
+    ums_scheduler_state[1] = NULL;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief copy a state page, retrying while the kernel updates it
+ *
+ */
+static int ums_state_read(const ums_state_list_t* state, ums_state_context_t* out, int max, int* p_num){
+    unsigned int seq;
+    int num, num_shown;
+
+    if(state == NULL || max < 0){
+        errno = EINVAL;
+        return -1;
+    }
+
+    do{
+        while((seq = __atomic_load_n(&state->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;   // update in progress
+        num = __atomic_load_n(&state->num, __ATOMIC_RELAXED);
+        num_shown = __atomic_load_n(&state->num_shown, __ATOMIC_RELAXED);
+        if(num_shown > max)
+            num_shown = max;
+        if(num_shown < 0 || num_shown > UMS_STATE_LIST_MAX)
+            num_shown = 0;
+        memcpy(out, state->contexts, num_shown * sizeof(ums_state_context_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }while(__atomic_load_n(&state->seq, __ATOMIC_RELAXED) != seq);
+
+    if(p_num != NULL)
+        *p_num = num;
+    return num_shown;
+}
+
+int ums_state_read_ready_list(ums_state_context_t* out, int max, int* p_num){
+    return ums_state_read(ums_scheduler_state[0], out, max, p_num);
+}
+
+int ums_state_read_completion_list(ums_state_context_t* out, int max, int* p_num){
+    return ums_state_read(ums_scheduler_state[1], out, max, p_num);
+}
+// -----------------------------------------------------------------------------------------------------
@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include <sched.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ums_worker_pool.h"
+
+__thread ums_worker_pool_t* ums_scheduler_worker_pool = NULL;
+
+typedef struct ums_pool_worker_t{
+    pthread_cond_t cond;    /** signaled when a job is assigned or the pool is destroyed */
+    bool has_job;
+    startup_new_thread_args_t job;  /** ums_context to run */
+
+    struct ums_pool_worker_t* next; /** next parked worker */
+    ums_worker_pool_t* pool;
+}ums_pool_worker_t;
+
+struct ums_worker_pool_t{
+    pthread_mutex_t mutex;  /** protects all the fields of the pool and of its workers */
+    ums_pool_worker_t* parked;  /** stack of parked workers */
+    int num_parked;
+    int num_threads;    /** workers alive, parked or busy */
+
+    int pool_size;  /** maximum number of parked workers */
+    int cpu_core;
+    bool destroyed;
+};
+
+// -----------------------------------------------------------------------------------------------------
+static inline void ums_worker_pool_free(ums_worker_pool_t* pool){
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+static void* ums_pool_worker_routine(void* args){
+    ums_pool_worker_t* worker = (ums_pool_worker_t*)args;
+    ums_worker_pool_t* pool = worker->pool;
+    startup_new_thread_args_t job;
+    bool free_pool = false;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(1){
+        while(!worker->has_job && !pool->destroyed)
+            pthread_cond_wait(&worker->cond, &pool->mutex);
+
+        if(!worker->has_job)    // destroyed while parked
+            break;
+
+        job = worker->job;
+        worker->has_job = false;
+        pthread_mutex_unlock(&pool->mutex);
+
+        startup_new_thread(&job);
+
+        pthread_mutex_lock(&pool->mutex);
+        if(pool->destroyed || pool->num_parked >= pool->pool_size)
+            break;
+
+        // back to the pool
+        worker->next = pool->parked;
+        pool->parked = worker;
+        pool->num_parked += 1;
+    }
+    pool->num_threads -= 1;
+    free_pool = (pool->destroyed && pool->num_threads == 0);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_cond_destroy(&worker->cond);
+    free(worker);
+    if(free_pool)
+        ums_worker_pool_free(pool);
+    return NULL;
+}
+
+// NOTE: pool->mutex must be held
+static inline ums_pool_worker_t* ums_worker_pool_spawn(ums_worker_pool_t* pool, startup_new_thread_args_t* startup_args){
+    pthread_t thread;
+    pthread_attr_t attr;
+    cpu_set_t cpu_set;
+    int res;
+
+    ums_pool_worker_t* worker = malloc(sizeof(ums_pool_worker_t));
+    if(worker == NULL)
+        return NULL;
+
+    pthread_cond_init(&worker->cond, NULL);
+    worker->pool = pool;
+    worker->next = NULL;
+    worker->has_job = (startup_args != NULL);
+    if(startup_args != NULL)
+        worker->job = *startup_args;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if(pool->cpu_core != -1){
+        CPU_ZERO(&cpu_set);
+        CPU_SET(pool->cpu_core, &cpu_set);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+    }
+    res = pthread_create(&thread, &attr, ums_pool_worker_routine, worker);
+    pthread_attr_destroy(&attr);
+
+    if(res != 0){
+        pthread_cond_destroy(&worker->cond);
+        free(worker);
+        return NULL;
+    }
+    pool->num_threads += 1;
+    return worker;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+ums_worker_pool_t* ums_worker_pool_create(int cpu_core, int pool_size, int warm_up){
+    ums_pool_worker_t* worker;
+    int i;
+
+    ums_worker_pool_t* pool = malloc(sizeof(ums_worker_pool_t));
+    if(pool == NULL)
+        return NULL;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->parked = NULL;
+    pool->num_parked = 0;
+    pool->num_threads = 0;
+    pool->pool_size = pool_size;
+    pool->cpu_core = cpu_core;
+    pool->destroyed = false;
+
+    if(warm_up > pool_size)
+        warm_up = pool_size;
+
+    pthread_mutex_lock(&pool->mutex);
+    for(i=0; i<warm_up; i++){
+        worker = ums_worker_pool_spawn(pool, NULL);
+        if(worker == NULL)
+            break;
+        worker->next = pool->parked;
+        pool->parked = worker;
+        pool->num_parked += 1;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return pool;
+}
+
+void ums_worker_pool_destroy(ums_worker_pool_t* pool){
+    ums_pool_worker_t* worker;
+    bool free_pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->destroyed = true;
+    for(worker = pool->parked; worker != NULL; worker = worker->next)
+        pthread_cond_signal(&worker->cond);
+    pool->parked = NULL;
+    pool->num_parked = 0;
+    free_pool = (pool->num_threads == 0);
+    pthread_mutex_unlock(&pool->mutex);
+
+    // otherwise the last worker frees the pool
+    if(free_pool)
+        ums_worker_pool_free(pool);
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+int ums_worker_pool_dispatch(ums_worker_pool_t* pool, startup_new_thread_args_t* startup_args){
+    ums_pool_worker_t* worker;
+    int res = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    worker = pool->parked;
+    if(worker != NULL){
+        pool->parked = worker->next;
+        pool->num_parked -= 1;
+
+        worker->job = *startup_args;
+        worker->has_job = true;
+        pthread_cond_signal(&worker->cond);
+    }
+    else if(ums_worker_pool_spawn(pool, startup_args) == NULL){
+        res = EAGAIN;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return res;
+}
+// -----------------------------------------------------------------------------------------------------
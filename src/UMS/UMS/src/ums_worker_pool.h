@@ -0,0 +1,59 @@
+#pragma once
+/// @file
+/// This file contains the pool of worker threads used by a scheduler to run its ums_contexts
+///
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "../../common/ums_requests.h"
+
+/**
+ * @brief arguments used by a worker thread to start a ums_context
+ *
+ */
+typedef struct startup_new_thread_args_t{
+    ums_context_descriptor_t ucd;
+    pid_t sheduler_pid;
+
+    void* (*routine)(void*);
+    void* args_routine;
+}startup_new_thread_args_t;
+
+/**
+ * @brief routine of a worker thread, it runs a ums_context from RQ_STARTUP_NEW_THREAD to RQ_END_THREAD
+ *
+ */
+void* startup_new_thread(void* args);
+
+typedef struct ums_worker_pool_t ums_worker_pool_t;
+
+/**
+ * @brief pool of the scheduler running in the current thread, NULL if the scheduler doesn't use a pool
+ *
+ */
+extern __thread ums_worker_pool_t* ums_scheduler_worker_pool;
+
+/**
+ * @brief Create a pool of worker threads pinned to cpu_core
+ *
+ * @param cpu_core CPU core of the workers, -1 for no affinity
+ * @param pool_size Maximum number of parked workers
+ * @param warm_up Number of workers created immediately (at most pool_size)
+ * @return pointer to the new pool, NULL on failure
+ */
+ums_worker_pool_t* ums_worker_pool_create(int cpu_core, int pool_size, int warm_up);
+
+/**
+ * @brief Destroy a pool, parked workers terminate, busy workers terminate at the end of their ums_context
+ *
+ */
+void ums_worker_pool_destroy(ums_worker_pool_t* pool);
+
+/**
+ * @brief Run a ums_context on a parked worker, a new worker is created if none is parked
+ *
+ * @param pool pointer to the pool
+ * @param startup_args ums_context to run, it is copied by the pool
+ * @return 0 on success, otherwise an error number
+ */
+int ums_worker_pool_dispatch(ums_worker_pool_t* pool, startup_new_thread_args_t* startup_args);
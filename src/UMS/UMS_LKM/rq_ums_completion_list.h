@@ -11,36 +11,41 @@
 #include <asm/uaccess.h> /* for put_user */
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 
 #include "../common/ums_requests.h"
 #include "../common/ums_types.h"
 
 #include "ums_hashtable.h"
+#include "ums_trace.h"
 
 //-------------------------------------------------------------------------------------------------------
 /**
  * Request used to create a new completion_list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_create_completion_list(rq_create_delete_completion_list_args_t* args){
+static inline int rq_create_completion_list(ums_process_t* ums_process, rq_create_delete_completion_list_args_t* args){
     rq_create_delete_completion_list_args_t args_san;
-    ums_process_t* ums_process;
     ums_completion_list_sl_t* ums_completion_list_sl;
 
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_hashtable_get_process(args_san.tgid, ums_process);
-    if(unlikely(ums_process == NULL))
+    ums_completion_list_sl = ums_cache_alloc(UMS_CACHE_COMPLETION_LIST_SL);
+    if(unlikely(ums_completion_list_sl == NULL))
         return -ERR_INTERNAL;
-
-    ums_completion_list_sl =  kmalloc(sizeof(ums_completion_list_sl_t), GFP_KERNEL);
     INIT_UMS_COMPLETION_LIST_SL(ums_completion_list_sl);
 
     ums_process_add_ums_completion_list_sl(ums_process, ums_completion_list_sl);
+    if(unlikely(ums_completion_list_sl->id < 0)){   // too many ums_completion_lists
+        DESTROY_UMS_COMPLETION_LIST_SL(ums_completion_list_sl);
+        ums_cache_free(UMS_CACHE_COMPLETION_LIST_SL, ums_completion_list_sl);
+        return -ENOSPC;
+    }
 
     args_san.descriptor = ums_completion_list_sl->id;
 
@@ -53,31 +58,33 @@ static inline int rq_create_completion_list(rq_create_delete_completion_list_arg
 /**
  * Request used to delete a new completion_list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_delete_completion_list(rq_create_delete_completion_list_args_t* args){
+static inline int rq_delete_completion_list(ums_process_t* ums_process, rq_create_delete_completion_list_args_t* args){
     rq_create_delete_completion_list_args_t args_san;
-    ums_process_t* ums_process;
     ums_completion_list_sl_t* ums_completion_list_sl;
 
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_hashtable_get_process(args_san.tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
+    rcu_read_lock();
     ums_process_get_ums_completion_list_sl(ums_process, args_san.descriptor, ums_completion_list_sl);
 
-    if(unlikely(ums_completion_list_sl == NULL))
+    if(unlikely(ums_completion_list_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
+    }
     
     ums_process_remove_ums_completion_list_sl(ums_process, ums_completion_list_sl);
+    rcu_read_unlock();  // no longer reachable by a lookup
+    ums_completion_list_remove_all(ums_completion_list_sl);
     DESTROY_UMS_COMPLETION_LIST_SL(ums_completion_list_sl);
 
-    kfree(ums_completion_list_sl);
+    // concurrent lockless lookups may still hold it
+    ums_cache_free_rcu(UMS_CACHE_COMPLETION_LIST_SL, ums_completion_list_sl);
     
     return 0;
 }
@@ -88,61 +95,174 @@ static inline int rq_delete_completion_list(rq_create_delete_completion_list_arg
 /**
  * Request used to add ums_context to a completion_list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_completion_list_add_ums_context(rq_completion_list_add_remove_ums_context_args_t* rq_args){
+static inline int rq_completion_list_add_ums_context_san(ums_process_t* ums_process, rq_completion_list_add_remove_ums_context_args_t rq_args_san);
+
+static inline int rq_completion_list_add_ums_context(ums_process_t* ums_process, rq_completion_list_add_remove_ums_context_args_t* rq_args){
     rq_completion_list_add_remove_ums_context_args_t rq_args_san;
-    ums_process_t* ums_process;
+
+    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
+        return -EFAULT;
+
+    return rq_completion_list_add_ums_context_san(ums_process, rq_args_san);
+}
+
+/**
+ * Same as rq_completion_list_add_ums_context(), with arguments already in kernel space (e.g. taken from a ums_ring)
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param rq_args_san Arguments of the request
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_completion_list_add_ums_context_san(ums_process_t* ums_process, rq_completion_list_add_remove_ums_context_args_t rq_args_san){
     ums_completion_list_sl_t* ums_completion_list_sl;
-    ums_completion_list_item_t* ums_completion_list_item; 
+    ums_context_sl_t* ums_context_sl;
+    bool added;
+    int ret = 0;
+
+    rcu_read_lock();
+    ums_process_get_ums_completion_list_sl(ums_process, rq_args_san.completion_list_d, ums_completion_list_sl);
+    if(unlikely(ums_completion_list_sl == NULL)){
+        ret = -ERR_INTERNAL;
+        goto unlock;
+    }
+
+    ums_process_get_ums_context_sl(ums_process, rq_args_san.ums_context_d, ums_context_sl);
+    if(unlikely(ums_context_sl == NULL)){
+        ret = -ERR_INVALID_UCD;
+        goto unlock;
+    }
+
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl, ums_context_sl, &added);
+    if(unlikely(!added)){   // already in a completion_list
+        ret = -ERR_INVALID_UCD;
+        goto unlock;
+    }
+
+    trace_ums_completion_list_add(ums_completion_list_sl->id, ums_context_sl->id);
+
+unlock:
+    rcu_read_unlock();
+    return ret; 
+}
+
+/**
+ * Request used to add several ums_contexts to a completion_list
+ * 
+ * The descriptors are copied once and the spin_lock of the completion_list is taken once, either all the 
+ * ums_contexts are added or none
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_completion_list_add_ums_context_batch(ums_process_t* ums_process, rq_completion_list_add_ums_context_batch_args_t* rq_args){
+    rq_completion_list_add_ums_context_batch_args_t rq_args_san;
+    ums_completion_list_sl_t* ums_completion_list_sl;
+    ums_context_descriptor_t* descriptors;
+    ums_context_sl_t** array_ums_context_sl;
+    bool added;
+    int i;
+    int ret = 0;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    ums_hashtable_get_process(rq_args_san.tgid, ums_process);
+    if(unlikely(rq_args_san.num <= 0 || rq_args_san.num > UMS_BATCH_MAX))
+        return -EINVAL;
+
+    descriptors = kvmalloc_array(rq_args_san.num, sizeof(*descriptors), GFP_KERNEL);
+    array_ums_context_sl = kvmalloc_array(rq_args_san.num, sizeof(*array_ums_context_sl), GFP_KERNEL);
+    if(unlikely(descriptors == NULL || array_ums_context_sl == NULL)){
+        ret = -ERR_INTERNAL;
+        goto free_arrays;
+    }
 
+    if(copy_from_user(descriptors, rq_args_san.descriptors, rq_args_san.num * sizeof(*descriptors))){
+        ret = -EFAULT;
+        goto free_arrays;
+    }
+
+    // the lookups are done after the copies, that can sleep
+    rcu_read_lock();
     ums_process_get_ums_completion_list_sl(ums_process, rq_args_san.completion_list_d, ums_completion_list_sl);
-    if(unlikely(ums_completion_list_sl == NULL))
-        return -ERR_INTERNAL;
-    
-    ums_completion_list_item = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item, rq_args_san.ums_context_d);
+    if(unlikely(ums_completion_list_sl == NULL)){
+        ret = -ERR_INTERNAL;
+        goto unlock;
+    }
+
+    for(i = 0; i < rq_args_san.num; i++){
+        ums_process_get_ums_context_sl(ums_process, descriptors[i], array_ums_context_sl[i]);
+        if(unlikely(array_ums_context_sl[i] == NULL)){
+            ret = -ERR_INVALID_UCD;
+            goto unlock;
+        }
+    }
 
-    ums_completion_list_add_item(ums_completion_list_sl, ums_completion_list_item);
+    ums_completion_list_add_ums_context_sl_batch(ums_completion_list_sl, array_ums_context_sl, rq_args_san.num, &added);
+    if(unlikely(!added))    // one of them is already in a completion_list
+        ret = -ERR_INVALID_UCD;
+    else if(trace_ums_completion_list_add_enabled()){
+        for(i = 0; i < rq_args_san.num; i++)
+            trace_ums_completion_list_add(ums_completion_list_sl->id, descriptors[i]);
+    }
 
-    return 0; 
+unlock:
+    rcu_read_unlock();
+free_arrays:
+    kvfree(array_ums_context_sl);
+    kvfree(descriptors);
+    return ret;
 }
 
 /**
  * Request used to remove a ums_context from a completion_list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_completion_list_remove_ums_context(rq_completion_list_add_remove_ums_context_args_t* rq_args){
+static inline int rq_completion_list_remove_ums_context(ums_process_t* ums_process, rq_completion_list_add_remove_ums_context_args_t* rq_args){
     rq_completion_list_add_remove_ums_context_args_t rq_args_san;
-    ums_process_t* ums_process;
     ums_completion_list_sl_t* ums_completion_list_sl;
-    ums_completion_list_item_t* ums_completion_list_item; 
+    ums_context_sl_t* ums_context_sl;
+    bool removed;
+    int ret = 0;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    ums_hashtable_get_process(rq_args_san.tgid, ums_process);
-    
+    rcu_read_lock();
     ums_process_get_ums_completion_list_sl(ums_process, rq_args_san.completion_list_d, ums_completion_list_sl);
-    if(unlikely(ums_completion_list_sl == NULL))
-        return -ERR_INTERNAL;
-        
-    ums_completion_list_remove_item_by_descriptor(ums_completion_list_sl, rq_args_san.ums_context_d, ums_completion_list_item);
+    if(unlikely(ums_completion_list_sl == NULL)){
+        ret = -ERR_INTERNAL;
+        goto unlock;
+    }
 
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item);
-    kfree(ums_completion_list_item);
+    ums_process_get_ums_context_sl(ums_process, rq_args_san.ums_context_d, ums_context_sl);
+    if(unlikely(ums_context_sl == NULL)){
+        ret = -ERR_INVALID_UCD;
+        goto unlock;
+    }
 
-    return 0;
+    ums_completion_list_remove_ums_context_sl(ums_completion_list_sl, ums_context_sl, &removed);
+    if(unlikely(!removed)){ // not in this completion_list
+        ret = -ERR_INVALID_UCD;
+        goto unlock;
+    }
+
+    trace_ums_completion_list_remove(ums_completion_list_sl->id, ums_context_sl->id);
+
+unlock:
+    rcu_read_unlock();
+    return ret;
 }
 
 
@@ -10,96 +10,306 @@
 #include <asm/uaccess.h> /* for put_user */
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 
 
 #include "../common/ums_requests.h"
 #include "../common/ums_types.h"
 
+#include "ums_trace.h"
 
 //-----------------------------------------------------------------------------------------
 /**
  * Request used to create a new ums_context
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_create_ums_context(rq_create_delete_ums_context_args_t* args){
+static inline int rq_create_ums_context_san(ums_process_t* ums_process, rq_create_delete_ums_context_args_t* args_san);
+
+static inline int rq_create_ums_context(ums_process_t* ums_process, rq_create_delete_ums_context_args_t* args){
     rq_create_delete_ums_context_args_t args_san;
-    ums_context_t* ums_context;
-    ums_context_sl_t* ums_context_sl;
-    ums_process_t* ums_process;
+    int ret;
 
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_context = kmalloc(sizeof(ums_context_t), GFP_KERNEL);
+    ret = rq_create_ums_context_san(ums_process, &args_san);
+    if(unlikely(ret != 0))
+        return ret;
+    
+    if(copy_to_user(args, &args_san, sizeof(args_san)))
+        return -EFAULT;
+    
+    return 0;
+}
+
+/**
+ * Same as rq_create_ums_context(), with arguments already in kernel space (e.g. taken from a ums_ring)
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args_san Arguments of the request, descriptor is set on success
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_create_ums_context_san(ums_process_t* ums_process, rq_create_delete_ums_context_args_t* args_san){
+    ums_context_t* ums_context;
+    ums_context_sl_t* ums_context_sl;
+
+    if(unlikely(!ums_context_valid_prio(args_san->prio)))
+        return -EINVAL;
+
+    ums_context = ums_cache_alloc(UMS_CACHE_CONTEXT);
     if(likely(ums_context)) 
-        INIT_UMS_CONTEXT(ums_context, args_san.routine, args_san.args);
+        INIT_UMS_CONTEXT(ums_context, args_san->routine, args_san->args);
     else    
         return -ERR_INTERNAL;
     
-    ums_context->user_reserved = args_san.user_res;
+    ums_context->user_reserved = args_san->user_res;
+    ums_context->prio = args_san->prio;
     
-    ums_context_sl = kmalloc(sizeof(ums_context_sl_t), GFP_KERNEL);
+    ums_context_sl = ums_cache_alloc(UMS_CACHE_CONTEXT_SL);
     if(likely(ums_context_sl))
         INIT_UMS_CONTEXT_SL(ums_context_sl, ums_context);
-    else
+    else{
+        ums_cache_free(UMS_CACHE_CONTEXT, ums_context);
         return -ERR_INTERNAL;
+    }
 
-    ums_hashtable_get_process(args_san.tgid, ums_process);
-    if(likely(ums_process)){
-        ums_process_add_ums_context_sl(ums_process, ums_context_sl);
-        args_san.descriptor = ums_context_sl->id;
-        
-        if(copy_to_user(args, &args_san, sizeof(args_san)))
-            return -EFAULT;
-        
-        return 0;
-    }
-    else
-        return -ERR_INTERNAL;
+    ums_process_add_ums_context_sl(ums_process, ums_context_sl);
+    if(unlikely(ums_context_sl->id < 0)){   // too many ums_contexts
+        DESTROY_UMS_CONTEXT(ums_context);
+        ums_cache_free(UMS_CACHE_CONTEXT, ums_context);
+        DESTROY_UMS_CONTEXT_SL(ums_context_sl);
+        ums_cache_free(UMS_CACHE_CONTEXT_SL, ums_context_sl);
+        return -ENOSPC;
+    }
+    args_san->descriptor = ums_context_sl->id;
+    trace_ums_context_create(-1, ums_context_sl->id);
+    
+    return 0;
+}
+
+/**
+ * Request used to create several ums_contexts
+ * 
+ * The objects are allocated in bulk, the lock of the descriptors is taken once and the descriptors are given back 
+ * with a single copy, either all the ums_contexts are created or none
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_create_ums_context_batch(ums_process_t* ums_process, rq_create_ums_context_batch_args_t* args){
+    rq_create_ums_context_batch_args_t args_san;
+    ums_context_batch_item_t* items;
+    ums_context_descriptor_t* descriptors;
+    ums_context_t** array_ums_context;
+    ums_context_sl_t** array_ums_context_sl;
+    int num, num_added, i;
+    int ret = 0;
+
+    if(copy_from_user(&args_san, args, sizeof(args_san)))
+        return -EFAULT;
+
+    num = args_san.num;
+    if(unlikely(num <= 0 || num > UMS_BATCH_MAX))
+        return -EINVAL;
+
+    items = kvmalloc_array(num, sizeof(*items), GFP_KERNEL);
+    descriptors = kvmalloc_array(num, sizeof(*descriptors), GFP_KERNEL);
+    array_ums_context = kvmalloc_array(num, sizeof(*array_ums_context), GFP_KERNEL);
+    array_ums_context_sl = kvmalloc_array(num, sizeof(*array_ums_context_sl), GFP_KERNEL);
+    if(unlikely(items == NULL || descriptors == NULL || array_ums_context == NULL || array_ums_context_sl == NULL)){
+        ret = -ERR_INTERNAL;
+        goto free_arrays;
+    }
+
+    if(copy_from_user(items, args_san.items, num * sizeof(*items))){
+        ret = -EFAULT;
+        goto free_arrays;
+    }
+
+    for(i = 0; i < num; i++){
+        if(unlikely(!ums_context_valid_prio(items[i].prio))){
+            ret = -EINVAL;
+            goto free_arrays;
+        }
+    }
+
+    if(unlikely(!ums_cache_alloc_bulk(UMS_CACHE_CONTEXT, num, (void**)array_ums_context))){
+        ret = -ERR_INTERNAL;
+        goto free_arrays;
+    }
+    if(unlikely(!ums_cache_alloc_bulk(UMS_CACHE_CONTEXT_SL, num, (void**)array_ums_context_sl))){
+        ums_cache_free_bulk(UMS_CACHE_CONTEXT, num, (void**)array_ums_context);
+        ret = -ERR_INTERNAL;
+        goto free_arrays;
+    }
+
+    for(i = 0; i < num; i++){
+        INIT_UMS_CONTEXT(array_ums_context[i], items[i].routine, items[i].args);
+        array_ums_context[i]->user_reserved = items[i].user_res;
+        array_ums_context[i]->prio = items[i].prio;
+        INIT_UMS_CONTEXT_SL(array_ums_context_sl[i], array_ums_context[i]);
+    }
+
+    ums_process_add_ums_context_sl_batch(ums_process, array_ums_context_sl, num, &num_added);
+    if(unlikely(num_added < num)){  // too many ums_contexts
+        ums_process_remove_ums_context_sl_batch(ums_process, array_ums_context_sl, num_added);
+        if(num_added > 0)
+            synchronize_rcu();  // concurrent lockless lookups may have found them
+
+        for(i = 0; i < num; i++){
+            DESTROY_UMS_CONTEXT(array_ums_context[i]);
+            DESTROY_UMS_CONTEXT_SL(array_ums_context_sl[i]);
+        }
+        ums_cache_free_bulk(UMS_CACHE_CONTEXT_SL, num, (void**)array_ums_context_sl);
+        ums_cache_free_bulk(UMS_CACHE_CONTEXT, num, (void**)array_ums_context);
+        ret = -ENOSPC;
+        goto free_arrays;
+    }
+
+    for(i = 0; i < num; i++){
+        descriptors[i] = array_ums_context_sl[i]->id;
+        trace_ums_context_create(-1, descriptors[i]);
+    }
+
+    if(copy_to_user(args_san.descriptors, descriptors, num * sizeof(*descriptors)))
+        ret = -EFAULT;
+
+free_arrays:
+    kvfree(array_ums_context_sl);
+    kvfree(array_ums_context);
+    kvfree(descriptors);
+    kvfree(items);
+    return ret;
 }
 
 /**
  * Request used to delete a ums_context
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_delete_ums_context(rq_create_delete_ums_context_args_t* args){
+static inline int rq_delete_ums_context(ums_process_t* ums_process, rq_create_delete_ums_context_args_t* args){
     rq_create_delete_ums_context_args_t args_san;
-    ums_process_t* ums_process;
     ums_context_sl_t* ums_context_sl;
-    bool assigned;
+    bool acquired;
     ums_context_t* ums_context;
 
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_hashtable_get_process(args_san.tgid, ums_process);
-
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-
+    rcu_read_lock();
     ums_process_get_ums_context_sl(ums_process, args_san.descriptor, ums_context_sl);
+    if(unlikely(ums_context_sl == NULL)){
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
+    }
 
-    assigned = true;
-    ums_context_sl_get_assigned(ums_context_sl, &assigned); 
-    if(unlikely(assigned))  // someone is using it! We cannot delete it
+    // claimed as for an execution: no one else can use or delete it, it can be used out of the RCU read section
+    ums_context_sl_try_to_acquire(ums_context_sl, &acquired);
+    rcu_read_unlock();
+    if(unlikely(!acquired))  // someone is using it! We cannot delete it
         return -ERR_INTERNAL;
+
+    // its thread exited without RQ_END_THREAD
+    if(unlikely(ums_context_detach_blocked_notify(ums_context_sl->ums_context) != 0)){
+        ums_context_sl_set_assigned(ums_context_sl, false);
+        return -EBUSY;
+    }
     
     ums_process_remove_ums_context_sl(ums_process, ums_context_sl);
+    ums_completion_list_detach_ums_context_sl(ums_context_sl);
     ums_context = ums_context_sl->ums_context;
-    
-    ums_proc_remove_thread(ums_context->proc_entry);
+    trace_ums_context_delete(ums_context->pid_scheduler, ums_context_sl->id);
 
+    // concurrent lockless lookups may still hold them
     DESTROY_UMS_CONTEXT(ums_context);
-    kfree(ums_context);
+    ums_cache_free_rcu(UMS_CACHE_CONTEXT, ums_context);
 
     DESTROY_UMS_CONTEXT_SL(ums_context_sl);
-    kfree(ums_context_sl);
+    ums_cache_free_rcu(UMS_CACHE_CONTEXT_SL, ums_context_sl);
+
+    return 0;
+}
+
+/**
+ * Request used to change the priority of a ums_context
+ * 
+ * If the ums_context waits in the ready list of a scheduler, it is moved in the ready_queue of the new priority
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_set_ums_context_prio_san(ums_process_t* ums_process, rq_set_ums_context_prio_args_t args_san);
+
+static inline int rq_set_ums_context_prio(ums_process_t* ums_process, rq_set_ums_context_prio_args_t* args){
+    rq_set_ums_context_prio_args_t args_san;
+
+    if(copy_from_user(&args_san, args, sizeof(args_san)))
+        return -EFAULT;
+
+    return rq_set_ums_context_prio_san(ums_process, args_san);
+}
+
+/**
+ * Same as rq_set_ums_context_prio(), with arguments already in kernel space (e.g. taken from a ums_ring)
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args_san Arguments of the request
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_set_ums_context_prio_san(ums_process_t* ums_process, rq_set_ums_context_prio_args_t args_san){
+    ums_context_sl_t* ums_context_sl;
+    ums_context_t* ums_context;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    pid_t pid_scheduler;
+
+    if(unlikely(!ums_context_valid_prio(args_san.prio)))
+        return -EINVAL;
+
+    rcu_read_lock();
+    ums_process_get_ums_context_sl(ums_process, args_san.ucd, ums_context_sl);
+    if(unlikely(ums_context_sl == NULL)){
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
+    }
+    ums_context = ums_context_sl->ums_context;
+
+    // the scheduler can change if a sibling steals the ums_context, retry until it is stable under its lock
+    for(;;){
+        pid_scheduler = READ_ONCE(ums_context->pid_scheduler);
+
+        ums_process_get_scheduler_sl(ums_process, pid_scheduler, ums_scheduler_sl);
+        if(ums_scheduler_sl == NULL){   // not managed by a scheduler, it cannot be in a ready list
+            WRITE_ONCE(ums_context->prio, args_san.prio);
+            ums_completion_list_state_update_of(ums_context_sl);
+            rcu_read_unlock();
+            return 0;
+        }
+
+        ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+        if(likely(ums_scheduler != NULL && ums_context->pid_scheduler == pid_scheduler))
+            break;
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    }
+
+    ums_scheduler_set_prio(ums_scheduler, ums_context, args_san.prio);
+
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
 
     return 0;
 }
@@ -109,45 +319,44 @@ static inline int rq_delete_ums_context(rq_create_delete_ums_context_args_t* arg
 /**
  * Request used by a ums thread to yield the control to the scheduler
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_yield_ums_context(rq_yield_ums_context_args_t* args){
+static inline int rq_yield_ums_context(ums_process_t* ums_process, rq_yield_ums_context_args_t* args){
     rq_yield_ums_context_args_t args_san;
-    ums_process_t* ums_process;
     ums_context_t* ums_context;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
 
     pid_t pid;
-    pid_t tgid;
 
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
     pid = current->pid;
-    tgid = current->tgid;
-
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
 
     ums_process_get_ums_thread(ums_process, pid, ums_context);
     if(unlikely(ums_context == NULL))
         return -ERR_INTERNAL;
 
+    rcu_read_lock();
     ums_process_get_scheduler_sl(ums_process, ums_context->pid_scheduler, ums_scheduler_sl);
-    if(unlikely(ums_scheduler_sl == NULL))
+    if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
+    }
 
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
     ums_scheduler->running_thread = NULL;
+    ums_scheduler_quantum_stop(ums_scheduler);
     
     ums_context_update_run_time_end_slot(ums_context);
 
@@ -158,14 +367,149 @@ static inline int rq_yield_ums_context(rq_yield_ums_context_args_t* args){
     // prepare arguments for the next call of entry_point function
     ums_scheduler->entry_point_args->reason = REASON_THREAD_YIELD;
     ums_scheduler->entry_point_args->activation_payload = ums_context->id;
+    ums_ring_post_event(ums_scheduler->ring, REASON_THREAD_YIELD, ums_context->id);
+    trace_ums_context_yield(ums_context->pid_scheduler, ums_context->id);
 
     set_current_state(TASK_INTERRUPTIBLE);
+    ums_scheduler_sl_handoff_start(ums_scheduler_sl);
     while(!wake_up_process(ums_scheduler->scheduler_task_struct));
 
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
     
     schedule();
+    ums_process_handoff_end(ums_process, ums_context);
+
+    return 0;
+}
+// ---------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+/**
+ * Request used by a ums thread to leave the CPU directly to another ums_context of the same scheduler,
+ * without waking up the scheduler thread
+ * 
+ * The target ums_context must be idle in the ready_list of the scheduler that manages the caller.
+ * The caller is put in the ready_list as for a yield
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_switch_to_ums_context(ums_process_t* ums_process, rq_switch_to_ums_context_args_t* args){
+    rq_switch_to_ums_context_args_t args_san;
+    ums_context_t* ums_context;
+    ums_context_sl_t* ums_context_sl_next;
+    ums_context_t* ums_context_next;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    pid_t pid;
+
+    if(copy_from_user(&args_san, args, sizeof(args_san)))
+        return -EFAULT;
+
+    pid = current->pid;
+
+    ums_process_get_ums_thread(ums_process, pid, ums_context);
+    if(unlikely(ums_context == NULL))
+        return -ERR_INTERNAL;
+
+    // the target is safe once it is found in the ready_list, under the spin_lock of the scheduler
+    rcu_read_lock();
+    ums_process_get_ums_context_sl(ums_process, args_san.ucd, ums_context_sl_next);
+    if(unlikely(ums_context_sl_next == NULL)){
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
+    }
+    ums_context_next = ums_context_sl_next->ums_context;
+
+    ums_process_get_scheduler_sl(ums_process, ums_context->pid_scheduler, ums_scheduler_sl);
+    if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
+        return -ERR_INTERNAL;
+    }
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(unlikely(ums_scheduler == NULL)){
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return -ERR_INTERNAL;
+    }
+
+    // the target must be a started ums_context parked in the ready_list of the same scheduler
+    if(unlikely(ums_context_next == ums_context ||
+                ums_context_next->task_struct == NULL ||
+                ums_context_next->pid_scheduler != ums_context->pid_scheduler ||
+                ums_context_next->state != UMS_THREAD_STATE_IDLE)){
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
+    }
+
+    // caller: running -> idle
+    ums_context_update_run_time_end_slot(ums_context);
+
+    ums_context->state = UMS_THREAD_STATE_IDLE;
+    ums_context->num_switch += 1;
+    ums_scheduler_ready_list_add(ums_scheduler, ums_context);
+
+    // target: idle -> running
+    ums_scheduler_ready_list_remove(ums_scheduler, ums_context_next);
+    ums_context_update_run_time_start_slot(ums_context_next);
+    trace_ums_context_switch_to(ums_context->pid_scheduler, ums_context_next->id);
+
+    ums_scheduler->num_switch += 1;
+    ums_scheduler_quantum_stop(ums_scheduler);
+    ums_scheduler->running_thread = ums_context_next;
+    ums_context_next->state = UMS_THREAD_STATE_RUNNING;
+    ums_scheduler_quantum_start(ums_scheduler, ums_context_next);
+
+    set_current_state(TASK_INTERRUPTIBLE);
+    WRITE_ONCE(ums_context_next->handoff_start_ns, ktime_get_ns());
+    while(!wake_up_process(ums_context_next->task_struct));
+
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
+
+    schedule();
+    ums_process_handoff_end(ums_process, ums_context);
 
     return 0;
 }
-// ---------------------------------------------------------------------------------------
\ No newline at end of file
+// ---------------------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------------------
+/**
+ * Request used by the thread of a ums_context from the handler of UMS_PARK_SIGNAL, sent by the LKM when it must leave the CPU
+ * 
+ * The thread is parked in the ready_list if it woke up after blocking, or preempted if its quantum expired.
+ * A thread woken up by the signal while it was parked goes back to sleep until a scheduler executes it
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_park_ums_context(ums_process_t* ums_process, rq_park_ums_context_args_t* args){
+    rq_park_ums_context_args_t args_san;
+    ums_context_t* ums_context;
+    int res = 0;
+
+    if(copy_from_user(&args_san, args, sizeof(args_san)))
+        return -EFAULT;
+
+    // the signal may arrive after RQ_END_THREAD, then the thread is no longer a ums thread
+    ums_process_get_ums_thread(ums_process, current->pid, ums_context);
+    if(unlikely(ums_context == NULL))
+        return -ERR_INTERNAL;
+
+    if(READ_ONCE(ums_context->unblock_pending))
+        res = ums_context_park_unblocked(ums_process, ums_context);
+    else if(READ_ONCE(ums_context->preempt_pending))
+        res = ums_context_park_preempted(ums_process, ums_context);
+
+    ums_context_wait_running(ums_context);
+    return res;
+}
+// ---------------------------------------------------------------------------------------
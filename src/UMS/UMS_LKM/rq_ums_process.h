@@ -21,32 +21,54 @@
 /**
  * Request used to create a new ums_process
  * 
+ * The ums_process is created and bound to the file by open(), this request only checks that the binding exists
+ * 
+ * @param file file of /dev/UMS used by the caller
  * @param args Arguments of the request (provided by user) 
  * 
- * @return Returns 0  
+ * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_create_process(rq_create_delete_process_args_t* args){
+static inline int rq_create_process(struct file* file, rq_create_delete_process_args_t* args){
     rq_create_delete_process_args_t args_san;
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_hashtable_create_process(args_san.tgid);    
+    if(unlikely(file->private_data == NULL))
+        return -ERR_INTERNAL;
     return 0;
 }
 
 /**
  * Request used to delete a ums_process
  * 
+ * The ums_process is destroyed by release() when the last reference to the file is dropped, namely when no other
+ * request can use it
+ * 
+ * @param file file of /dev/UMS used by the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0  
  */
-static inline int rq_delete_process(rq_create_delete_process_args_t* args){
+static inline int rq_delete_process(struct file* file, rq_create_delete_process_args_t* args){
     rq_create_delete_process_args_t args_san;
     if(copy_from_user(&args_san, args, sizeof(args_san)))
         return -EFAULT;
 
-    ums_hashtable_delete_process(args_san.tgid);
     return 0;
 }
 // -------------------------------------------------------------------------------
+
+// -------------------------------------------------------------------------------
+/**
+ * @brief get the ums_process bound to a file of /dev/UMS
+ * 
+ * @param p_file NON-NULL pointer to a struct file
+ * @param p_ums_process_OUT output, pointer to the ums_process, NULL if the caller isn't the process that opened the file
+ */
+#define ums_file_get_process(p_file, p_ums_process_OUT) \
+    do{ \
+        p_ums_process_OUT = (ums_process_t*)(p_file)->private_data; \
+        if(unlikely((p_ums_process_OUT) != NULL && (p_ums_process_OUT)->key != current->tgid))  \
+            p_ums_process_OUT = NULL;   \
+    }while(0)
+// -------------------------------------------------------------------------------
@@ -11,25 +11,28 @@
 #include <asm/uaccess.h> /* for put_user */
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 
 #include "../common/ums_requests.h"
 #include "../common/ums_types.h"
 
 #include "ums_hashtable.h"
 #include "ums_proc.h"
+#include "ums_trace.h"
+#include "ums_ioctl.h"
 
 
 // -------------------------------------------------------------------------------------------------
 /**
  * Request used to create a new ums_scheduler
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_create_ums_scheduler(rq_create_delete_ums_scheduler_args_t* rq_args){
+static inline int rq_create_ums_scheduler(ums_process_t* ums_process, rq_create_delete_ums_scheduler_args_t* rq_args){
     rq_create_delete_ums_scheduler_args_t rq_args_san;
-    ums_process_t* ums_process;
 
     ums_completion_list_sl_t* ums_completion_list_sl;
 
@@ -37,32 +40,46 @@ static inline int rq_create_ums_scheduler(rq_create_delete_ums_scheduler_args_t*
     ums_scheduler_sl_t* ums_scheduler_sl;
 
     pid_t pid;
-    pid_t tgid;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
     pid = current->pid;
-    tgid = current->tgid;
-    
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
+
+    // allocated before the lookup, in the RCU read section it cannot sleep
+    ums_scheduler = ums_cache_alloc(UMS_CACHE_SCHEDULER);
+    if(unlikely(ums_scheduler == NULL))
         return -ERR_INTERNAL;
-    
+    ums_scheduler_sl = ums_cache_alloc(UMS_CACHE_SCHEDULER_SL);
+    if(unlikely(ums_scheduler_sl == NULL)){
+        ums_cache_free(UMS_CACHE_SCHEDULER, ums_scheduler);
+        return -ERR_INTERNAL;
+    }
+
+    rcu_read_lock();
     ums_process_get_ums_completion_list_sl(ums_process, rq_args_san.completion_list_d, ums_completion_list_sl);
-    if(unlikely(ums_completion_list_sl == NULL))
+    if(unlikely(ums_completion_list_sl == NULL)){
+        rcu_read_unlock();
+        ums_cache_free(UMS_CACHE_SCHEDULER_SL, ums_scheduler_sl);
+        ums_cache_free(UMS_CACHE_SCHEDULER, ums_scheduler);
         return ERR_INVALID_CLD;
+    }
 
-    ums_scheduler = kmalloc(sizeof(ums_scheduler_t), GFP_KERNEL);
     INIT_UMS_SCHEDULER(ums_scheduler, current, ums_completion_list_sl);
     
     ums_scheduler->entry_point_args = rq_args_san.entry_point_args;
     ums_scheduler->cpu_core = rq_args_san.cpu_core;
+    ums_scheduler->quantum_ns = (u64)rq_args_san.quantum_us * NSEC_PER_USEC;
 
-    printk("set cpu_core = %d", ums_scheduler->cpu_core);
-    ums_scheduler_sl = kmalloc(sizeof(ums_scheduler_sl_t), GFP_KERNEL);
+    if(static_branch_unlikely(&ums_debug_requests))
+        printk(KERN_DEBUG "pid=%d, set cpu_core = %d\n", pid, ums_scheduler->cpu_core);
     INIT_UMS_SCHEDULER_SL(ums_scheduler_sl, pid, ums_scheduler);
     
+    // from now on, the siblings of the same ums_completion_list can steal from it and vice versa
+    ums_scheduler_sl_attach_completion_list(ums_scheduler_sl, ums_completion_list_sl);
+    rcu_read_unlock();
+
+    // it can sleep (entries in /proc)
     ums_process_add_scheduler_sl(ums_process, ums_scheduler_sl);
     return 0;
 }
@@ -70,14 +87,13 @@ static inline int rq_create_ums_scheduler(rq_create_delete_ums_scheduler_args_t*
 /**
  * Request used by a scheduler to terminate its execution
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user) 
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_exit_ums_scheduler(rq_create_delete_ums_scheduler_args_t* rq_args){
+static inline int rq_exit_ums_scheduler(ums_process_t* ums_process, rq_create_delete_ums_scheduler_args_t* rq_args){
     rq_create_delete_ums_scheduler_args_t rq_args_san;
-    ums_process_t* ums_process;
-    pid_t tgid;
     pid_t pid;
 
     ums_scheduler_t* ums_scheduler;
@@ -86,34 +102,37 @@ static inline int rq_exit_ums_scheduler(rq_create_delete_ums_scheduler_args_t* r
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    tgid = current->tgid;
     pid = current->pid;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
     if(unlikely(ums_scheduler_sl == NULL))
         return -ERR_INTERNAL;
 
     ums_process_remove_scheduler_sl(ums_process, ums_scheduler_sl);
+    ums_scheduler_sl_detach_completion_list(ums_scheduler_sl);
 
+    // a sibling that is still stealing sees a NULL ums_scheduler
     ums_scheduler_sl_remove_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL))
         return -ERR_INTERNAL;  // someone else is removing the scheduler
                     // this should never happen
     
+    // no one can start it again
+    hrtimer_cancel(&ums_scheduler->quantum_timer);
+
     // flag to stop while() loop in main function of the scheduler
     ums_scheduler->entry_point_args->reason = REASON_SPECIAL_END_SCHEDULER;
     // return value of the scheduler
     ums_scheduler->entry_point_args->activation_payload = rq_args_san.return_value;
 
     DESTROY_UMS_SCHEDULER(ums_scheduler);
-    kfree(ums_scheduler);
+    ums_cache_free(UMS_CACHE_SCHEDULER, ums_scheduler);
 
+    // concurrent lockless lookups may still hold it
     DESTROY_UMS_SCHEDULER_SL(ums_scheduler_sl);
-    kfree(ums_scheduler_sl);
+    ums_cache_free_rcu(UMS_CACHE_SCHEDULER_SL, ums_scheduler_sl);
     return SUCCESS;
 }
 // ------------------------------------------------------------------------------------------------
@@ -122,19 +141,129 @@ static inline int rq_exit_ums_scheduler(rq_create_delete_ums_scheduler_args_t* r
 /**
  * Request used to pause the execution of the current scheduler
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user), currently NOT USED
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_wait_next_scheduler_call(rq_wait_next_scheduler_call_args_t* rq_args){
+static inline int rq_wait_next_scheduler_call(ums_process_t* ums_process, rq_wait_next_scheduler_call_args_t* rq_args){
     rq_wait_next_scheduler_call_args_t rq_args_san;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+    bool notified;
+
+    pid_t pid;
     
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
     rq_args_san.ucd = 0;   //useless
+
+    pid = current->pid;
+
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL))
+        return -ERR_INTERNAL;
+
+    // requests queued by the entry_point, without a RQ_UMS_RING_ENTER
+    if(ums_scheduler_sl->ums_scheduler != NULL && ums_scheduler_sl->ums_scheduler->ring != NULL)
+        ums_ring_submit(ums_process, ums_scheduler_sl->ums_scheduler->ring, UMS_RING_SQ_ENTRIES, !READ_ONCE(ums_scheduler_sl->ums_scheduler->dispatched));
     
     set_current_state(TASK_INTERRUPTIBLE);
-    schedule();
+    // the running ums_context may have blocked before this call, its wake up would be lost
+    if(!ums_scheduler_blocked_pending(ums_scheduler_sl->ums_scheduler))
+        schedule();
+    __set_current_state(TASK_RUNNING);
+    ums_scheduler_sl_handoff_end(ums_scheduler_sl);
+    if(likely(ums_scheduler_sl->ums_scheduler != NULL))
+        WRITE_ONCE(ums_scheduler_sl->ums_scheduler->dispatched, false);
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(likely(ums_scheduler != NULL))
+        ums_scheduler_notify_blocked(ums_scheduler, &notified);
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+
+    return SUCCESS;
+}
+
+/**
+ * Request used by a scheduler to consume the submission queue of its ums_ring
+ * 
+ * The result of each entry is posted in the completion queue
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user) 
+ * 
+ * @return Returns the number of entries consumed, otherwise -errno  
+ */
+static inline int rq_ums_ring_enter(ums_process_t* ums_process, rq_ums_ring_enter_args_t* rq_args){
+    rq_ums_ring_enter_args_t rq_args_san;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
+        return -EFAULT;
+
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, current->pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL))
+        return -ERR_INTERNAL;
+
+    // only its thread removes the ums_scheduler and sets its ums_ring
+    ums_scheduler = ums_scheduler_sl->ums_scheduler;
+    if(unlikely(ums_scheduler == NULL || ums_scheduler->ring == NULL))
+        return -EINVAL;
+
+    return ums_ring_submit(ums_process, ums_scheduler->ring, rq_args_san.to_submit, !READ_ONCE(ums_scheduler->dispatched));
+}
+
+/**
+ * Request used to park the current scheduler until there is something to do
+ * 
+ * The scheduler sleeps on the wait queue of its ums_completion_list until a ums_context is added to it, or a 
+ * ums_context becomes ready in its ready_list or in the one of a sibling that it can steal from.
+ * It is called from the entry_point when both lists are empty, instead of spinning or exiting
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user), currently NOT USED
+ * 
+ * @return Returns 0 when there may be something to do, -EINTR if interrupted by a signal, otherwise -errno  
+ */
+static inline int rq_park_ums_scheduler(ums_process_t* ums_process, rq_park_ums_scheduler_args_t* rq_args){
+    rq_park_ums_scheduler_args_t rq_args_san;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_completion_list_sl_t* ums_completion_list_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    pid_t pid;
+
+    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
+        return -EFAULT;
+
+    pid = current->pid;
+
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL))
+        return -ERR_INTERNAL;
+
+    // only its thread removes the ums_scheduler, it can be used without the spin_lock
+    ums_scheduler = ums_scheduler_sl->ums_scheduler;
+    ums_completion_list_sl = ums_scheduler_sl->completion_list;
+    if(unlikely(ums_scheduler == NULL || ums_completion_list_sl == NULL))
+        return -ERR_INTERNAL;
+
+    ums_scheduler->num_parks += 1;
+    trace_ums_scheduler_park(pid, ums_completion_list_sl->id);
+
+    // not exclusive: a pinned scheduler may not be able to steal, a wake up must not be consumed by it
+    if(wait_event_interruptible(ums_completion_list_sl->idle_wait_queue, ums_scheduler_has_work(ums_scheduler_sl)))
+        return -EINTR;
+
+    trace_ums_scheduler_wake(pid, ums_completion_list_sl->id);
     return SUCCESS;
 }
 // ------------------------------------------------------------------------------------------------
@@ -144,24 +273,22 @@ static inline int rq_wait_next_scheduler_call(rq_wait_next_scheduler_call_args_t
 /**
  * Request used by the scheduler to execute the next available ums_context in the ums_completion_list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user)
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_execute_next_new_thread(rq_execute_next_new_thread_args_t* rq_args){
+static inline int rq_execute_next_new_thread(ums_process_t* ums_process, rq_execute_next_new_thread_args_t* rq_args){
     rq_execute_next_new_thread_args_t rq_args_san;
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
     ums_completion_list_sl_t* ums_completion_list_sl; 
-    ums_completion_list_item_t* cl_item;
 
     ums_context_sl_t* ums_context_sl;
     bool context_assigned;
 
     ums_context_t* ums_context;
     
-    pid_t tgid;
     pid_t pid;
 
     int ret = 0;
@@ -169,16 +296,13 @@ static inline int rq_execute_next_new_thread(rq_execute_next_new_thread_args_t*
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    tgid = current->tgid;   // indicates the process
     pid = current->pid; // indicates the scheduler
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        return -ERR_INTERNAL;
-    }
-
+    // until it is acquired, a ums_context taken from the completion_list can be deleted
+    rcu_read_lock();
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
     if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
@@ -192,18 +316,14 @@ static inline int rq_execute_next_new_thread(rq_execute_next_new_thread_args_t*
     ums_completion_list_sl = ums_scheduler->completion_list;
 
     while(1){
-        ums_completion_list_remove_first(ums_completion_list_sl, cl_item);
-        if(unlikely(cl_item == NULL)){  //EMPTY
-            printk("Empty completion list\n");
+        ums_completion_list_remove_first(ums_completion_list_sl, ums_context_sl);
+        if(unlikely(ums_context_sl == NULL)){  //EMPTY
+            if(static_branch_unlikely(&ums_debug_requests))
+                printk(KERN_DEBUG "pid=%d, empty completion list\n", pid);
             ret = -ERR_EMPTY_COMP_LIST;
             goto unlock;
         }
 
-        ums_process_get_ums_context_sl(ums_process, cl_item->ums_context_id, ums_context_sl);
-        if(unlikely(ums_context_sl==NULL)){
-            ret = -ERR_INTERNAL;
-            goto unlock;
-        }
         ums_context_sl_try_to_acquire(ums_context_sl, &context_assigned);
         if(likely(context_assigned==true)){    //success
             rq_args_san.routine = ums_context_sl->ums_context->routine;
@@ -214,51 +334,51 @@ static inline int rq_execute_next_new_thread(rq_execute_next_new_thread_args_t*
 
             ret = 0;
 
-            if(copy_to_user(rq_args, &rq_args_san, sizeof(rq_args_san)))
-                ret = -EFAULT;
-
             ums_context = ums_context_sl->ums_context;
             ums_context_update_run_time_start_slot(ums_context);
+            WRITE_ONCE(ums_scheduler->dispatched, true);    // its thread is started by the user
+            trace_ums_context_execute_cl(pid, ums_context_sl->id);
             goto unlock;
         }
-        else{
-            printk("pid=%d, ums context already assigned :(. I try to get the next one\n", current->pid);
+        else if(static_branch_unlikely(&ums_debug_requests)){
+            printk(KERN_DEBUG "pid=%d, ums context already assigned, try to get the next one\n", pid);
         }
     }
 
 unlock:    
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
+
+    // copied after releasing the spin_lock, it can fault
+    if(ret == 0 && copy_to_user(rq_args, &rq_args_san, sizeof(rq_args_san)))
+        ret = -EFAULT;
     return ret;
 }
 
 /**
  * Request used by the scheduler to execute the next ums_context in the ready list
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user)
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_execute_next_ready_thread(rq_execute_next_ready_thread_args_t* rq_args){
+static inline int rq_execute_next_ready_thread(ums_process_t* ums_process, rq_execute_next_ready_thread_args_t* rq_args){
     rq_execute_next_ready_thread_args_t rq_args_san;
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
     ums_context_t* ums_context;
 
     pid_t pid;
-    pid_t tgid;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
     pid = current->pid;
-    tgid = current->tgid;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
     if(unlikely(ums_scheduler_sl == NULL))
         return -ERR_INTERNAL;
 
@@ -270,15 +390,84 @@ static inline int rq_execute_next_ready_thread(rq_execute_next_ready_thread_args
 
     ums_scheduler_ready_list_remove_first(ums_scheduler, ums_context);
     if(unlikely(ums_context == NULL)){
+        // nothing to do, try to help a busy sibling
+        if(ums_scheduler_steal_ready_context(ums_scheduler_sl) == NULL){
+            ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+            return -ERR_EMPTY_READY_LIST; 
+        }
+        ums_scheduler_ready_list_remove_first(ums_scheduler, ums_context);
+    }
+
+    ums_context_update_run_time_start_slot(ums_context);
+    trace_ums_context_execute_rl(pid, ums_context->id);
+    WRITE_ONCE(ums_context->handoff_start_ns, ktime_get_ns());
+
+    ums_scheduler->num_switch += 1;
+    ums_scheduler->running_thread = ums_context;    
+    WRITE_ONCE(ums_scheduler->dispatched, true);
+    ums_context->state = UMS_THREAD_STATE_RUNNING;
+    ums_scheduler_quantum_start(ums_scheduler, ums_context);
+
+    while(!wake_up_process(ums_context->task_struct));
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    
+    return 0;
+}
+
+/**
+ * Request used by a scheduler to execute the ums_context with the highest priority of the ready list
+ * 
+ * Among ums_contexts with the same priority, the one that waits from more time is chosen
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param args Arguments of the request (provided by user)
+ * 
+ * @return Returns 0 on sucess, otherwise -errno  
+ */
+static inline int rq_execute_highest_prio_ready_thread(ums_process_t* ums_process, rq_execute_next_ready_thread_args_t* rq_args){
+    rq_execute_next_ready_thread_args_t rq_args_san;
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+    ums_context_t* ums_context;
+
+    pid_t pid;
+
+    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
+        return -EFAULT;
+
+    pid = current->pid;
+
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL))
+        return -ERR_INTERNAL;
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
-        return -ERR_EMPTY_READY_LIST; 
+        return -ERR_INTERNAL; 
+    }
+
+    ums_scheduler_ready_list_remove_highest_prio(ums_scheduler, ums_context);
+    if(unlikely(ums_context == NULL)){
+        // nothing to do, try to help a busy sibling
+        if(ums_scheduler_steal_ready_context(ums_scheduler_sl) == NULL){
+            ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+            return -ERR_EMPTY_READY_LIST; 
+        }
+        ums_scheduler_ready_list_remove_highest_prio(ums_scheduler, ums_context);
     }
 
     ums_context_update_run_time_start_slot(ums_context);
+    trace_ums_context_execute_rl(pid, ums_context->id);
+    WRITE_ONCE(ums_context->handoff_start_ns, ktime_get_ns());
 
     ums_scheduler->num_switch += 1;
     ums_scheduler->running_thread = ums_context;    
+    WRITE_ONCE(ums_scheduler->dispatched, true);
     ums_context->state = UMS_THREAD_STATE_RUNNING;
+    ums_scheduler_quantum_start(ums_scheduler, ums_context);
 
     while(!wake_up_process(ums_context->task_struct));
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
@@ -291,38 +480,36 @@ static inline int rq_execute_next_ready_thread(rq_execute_next_ready_thread_args
 /**
  * Request executed at startup of a ums_context
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user)
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_startup_new_thread(rq_startup_new_thread_args_t* rq_args){
+static inline int rq_startup_new_thread(ums_process_t* ums_process, rq_startup_new_thread_args_t* rq_args){
     rq_startup_new_thread_args_t rq_args_san;
-    ums_process_t* ums_process;
     ums_context_sl_t* ums_context_sl;
     ums_context_t* ums_context;
 
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
 
-    pid_t tgid;
     pid_t pid;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    tgid = current->tgid;
     pid = current->pid;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
+    rcu_read_lock();
     ums_process_get_scheduler_sl(ums_process, rq_args_san.pid_scheduler, ums_scheduler_sl);
-    if(unlikely(ums_scheduler_sl == NULL))
+    if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
+    }
 
     ums_process_get_ums_context_sl(ums_process, rq_args_san.ucd, ums_context_sl);
     if(unlikely(ums_context_sl==NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
     ums_context = ums_context_sl->ums_context;
@@ -330,26 +517,29 @@ static inline int rq_startup_new_thread(rq_startup_new_thread_args_t* rq_args){
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;  //should be a KERNEL PANIC
     }
 
     // fill fields of ums_context that represent an actual thread
-    ums_context_register_as_thread(ums_context, current, rq_args_san.pid_scheduler);
+    ums_context_register_as_thread(ums_context, current, rq_args_san.pid_scheduler, ums_scheduler->scheduler_task_struct);
+    // from now on, the scheduler is woken up if the thread blocks
+    ums_context_register_blocked_notify(ums_context);
     // register the new ums_context in the hashmap that map pid->ucd    
     ums_process_register_ums_thread(ums_process, ums_context);
 
-    // register the new thread in /proc
-    ums_proc_add_thread(ums_scheduler_sl->proc_entry_main_workers, ums_context->id, ums_context->proc_entry);
-
     ums_context_update_run_time_start_slot(ums_context);
 
     ums_scheduler->running_thread = ums_context;
     ums_context->state = UMS_THREAD_STATE_RUNNING;
     ums_context->num_switch += 1;
+    ums_scheduler_quantum_start(ums_scheduler, ums_context);
 
     ums_scheduler->num_switch += 1;
+    trace_ums_context_startup(rq_args_san.pid_scheduler, ums_context->id);
 
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
 
     return 0;
 }
@@ -357,13 +547,13 @@ static inline int rq_startup_new_thread(rq_startup_new_thread_args_t* rq_args){
 /**
  * Request used by a ums_context to terminate its execution
  * 
+ * @param ums_process ums_process bound to the file of the caller
  * @param args Arguments of the request (provided by user)
  * 
  * @return Returns 0 on sucess, otherwise -errno  
  */
-static inline int rq_end_thread(rq_end_thread_args_t* rq_args){
+static inline int rq_end_thread(ums_process_t* ums_process, rq_end_thread_args_t* rq_args){
     rq_end_thread_args_t rq_args_san;
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
     ums_context_sl_t* ums_context_sl;
@@ -372,23 +562,27 @@ static inline int rq_end_thread(rq_end_thread_args_t* rq_args){
     struct task_struct* sched_ts;
 
     pid_t pid;
-    pid_t tgid;
 
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
     pid = current->pid;
-    tgid = current->tgid;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        //printk(KERN_ALERT "invalid ums_process");
+    // the ums_context can be deleted as soon as it is released, below
+    rcu_read_lock();
+    ums_process_get_ums_context_sl(ums_process, rq_args_san.ucd, ums_context_sl);
+    if(unlikely(ums_context_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
-    ums_process_get_scheduler_sl(ums_process, rq_args_san.pid_scheduler, ums_scheduler_sl);
+    ums_context = ums_context_sl->ums_context;
+
+    // the ums_context may have been stolen, the scheduler known by the user can be stale
+    ums_process_get_scheduler_sl(ums_process, ums_context->pid_scheduler, ums_scheduler_sl);
     if(unlikely(ums_scheduler_sl == NULL)){
         //printk(KERN_ALERT "invalid ums_scheduler_sl");
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
@@ -396,17 +590,21 @@ static inline int rq_end_thread(rq_end_thread_args_t* rq_args){
     if(unlikely(ums_scheduler == NULL)){
         //printk(KERN_ALERT "invalid ums_scheduler");
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
-    ums_process_get_ums_context_sl(ums_process, rq_args_san.ucd, ums_context_sl);
-    if(unlikely(ums_context_sl == NULL))
-        return -ERR_INTERNAL;
-
-    ums_context = ums_context_sl->ums_context;
     ums_context_update_run_time_end_slot(ums_context);
 
     ums_context_sl->ums_context->state = UMS_THREAD_STATE_ENDED;
+    ums_scheduler->running_thread = NULL;
+    ums_scheduler_quantum_stop(ums_scheduler);
+    // a UMS_PARK_SIGNAL still in flight finds the thread unregistered, RQ_PARK_UMS_CONTEXT does nothing
+    WRITE_ONCE(ums_context->preempt_pending, false);
+    WRITE_ONCE(ums_context->unblock_pending, false);
+    ums_context_unregister_blocked_notify(ums_context);
+    // the thread can be reused for another ums_context (worker pool of libums)
+    ums_process_unregister_ums_thread(ums_process, ums_context);
     //ums_context_sl->assigned = false; //release
     ums_context_sl_set_assigned(ums_context_sl, false); //release
 
@@ -414,9 +612,13 @@ static inline int rq_end_thread(rq_end_thread_args_t* rq_args){
 
     ums_scheduler->entry_point_args->reason = REASON_THREAD_ENDED;
     ums_scheduler->entry_point_args->activation_payload = rq_args_san.ucd;
+    ums_ring_post_event(ums_scheduler->ring, REASON_THREAD_ENDED, rq_args_san.ucd);
+    trace_ums_context_end(ums_context->pid_scheduler, rq_args_san.ucd);
     
     ums_scheduler->num_switch += 1;
+    ums_scheduler_sl_handoff_start(ums_scheduler_sl);
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
 
     while(!wake_up_process(sched_ts));
     schedule();
@@ -428,26 +630,25 @@ static inline int rq_end_thread(rq_end_thread_args_t* rq_args){
 
 // -----------------------------------------------------------------------------------------------
 /**
- * @brief get a list of contexts from the completion_list
+ * @brief get a snapshot of the ums_contexts in the completion_list
  * 
+ * Nothing is held when it returns, the ums_contexts can be taken by siblings in the meantime:
+ * rq_execute() claims the chosen one and fails with -ERR_STALE or -ERR_ASSIGNED if it is gone
+ * NOTE: at most UMS_BATCH_MAX ums_contexts are read
  */
-static inline int rq_get_from_cl(rq_get_from_cl_args_t* rq_args){
+static inline int rq_get_from_cl(ums_process_t* ums_process, rq_get_from_cl_args_t* rq_args){
     rq_get_from_cl_args_t rq_args_san;
 
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
     ums_completion_list_sl_t* ums_completion_list_sl; 
-    ums_completion_list_item_t* cl_item;
-
 
     ums_context_sl_t* ums_context_sl;
-
-    ums_context_t* ums_context;
     
     info_ums_context_t* array_info_context;
+    size_t array_size;
+    bool empty;
 
-    pid_t tgid;
     pid_t pid;
 
     int idx;
@@ -456,61 +657,45 @@ static inline int rq_get_from_cl(rq_get_from_cl_args_t* rq_args){
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    tgid = current->tgid;   // indicates the process
     pid = current->pid; // indicates the scheduler
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        return -ERR_INTERNAL;
-    }
-
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
     if(unlikely(ums_scheduler_sl == NULL)){
         return -ERR_INTERNAL;
     }
 
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
-    if(unlikely(ums_scheduler == NULL)){
-        ret = -ERR_INTERNAL;  
-        goto unlock;
-    }
-
-    ums_completion_list_sl = ums_scheduler->completion_list;
-
-    ums_scheduler_completion_list_start_iteration(ums_scheduler, cl_item);
-
-    if(ums_scheduler_list_empty(&(ums_completion_list_sl->ums_context_list))){
-        ums_scheduler_completion_list_iterate_end(ums_scheduler);
-        ret = -ERR_EMPTY_COMP_LIST;
-        goto unlock;
-    }
-
-    array_info_context = kmalloc(rq_args_san.array_size*sizeof(info_ums_context_t), GFP_KERNEL);
-    for(idx=0; idx < rq_args_san.array_size; idx++){
-        if(likely(cl_item != NULL)){   
-            ums_process_get_ums_context_sl(ums_process, cl_item->ums_context_id, ums_context_sl);
-            ums_context = ums_context_sl->ums_context;
-
-            array_info_context[idx].ucd = ums_context->id;
-            array_info_context[idx].number_switch = ums_context->num_switch;
-            array_info_context[idx].run_time_ms = ums_context_get_run_time_ms(ums_context);
-            array_info_context[idx].user_reserved = ums_context->user_reserved;
-            array_info_context[idx].from_cl = true;
+    ums_completion_list_sl = likely(ums_scheduler != NULL)? ums_scheduler->completion_list : NULL;
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    if(unlikely(ums_completion_list_sl == NULL))
+        return -ERR_INTERNAL;
 
-            ums_scheduler_completion_list_iterate(ums_scheduler, cl_item);
+    // allocated before taking the spin_lock
+    array_size = min_t(size_t, rq_args_san.array_size, UMS_BATCH_MAX);
+    array_info_context = kvmalloc_array(max_t(size_t, array_size, 1), sizeof(info_ums_context_t), GFP_KERNEL);
+    if(unlikely(array_info_context == NULL))
+        return -ENOMEM;
+
+    idx = 0;
+    spin_lock(&ums_completion_list_sl->ums_context_list_spin_lock);
+        empty = list_empty(&ums_completion_list_sl->ums_context_list);
+        list_for_each_entry(ums_context_sl, &ums_completion_list_sl->ums_context_list, cl_list){
+            if(idx == array_size)
+                break;
+            ums_context_fill_info(ums_context_sl->ums_context, &array_info_context[idx], true);
+            idx++;
         }
-        else 
-            break;
-    }
+    spin_unlock(&ums_completion_list_sl->ums_context_list_spin_lock);
 
-    if(copy_to_user(rq_args_san.info_context_array, array_info_context, idx*sizeof(info_ums_context_t)))
+    if(empty)
+        ret = -ERR_EMPTY_COMP_LIST;
+    else if(copy_to_user(rq_args_san.info_context_array, array_info_context, idx*sizeof(info_ums_context_t)))
         ret = -EFAULT;
-    
-    ret = idx;
-    kfree(array_info_context);
-
-unlock:
-    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    else
+        ret = idx;
+    kvfree(array_info_context);
     
     return ret;
 }
@@ -518,11 +703,11 @@ unlock:
 /**
  * @brief get list of ums_context from the ready list
  * 
+ * NOTE: at most UMS_BATCH_MAX ums_contexts are read
  */
-static inline int rq_get_from_rl(rq_get_from_rl_args_t* rq_args){
+static inline int rq_get_from_rl(ums_process_t* ums_process, rq_get_from_rl_args_t* rq_args){
     rq_get_from_rl_args_t rq_args_san;
 
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
 
@@ -530,8 +715,8 @@ static inline int rq_get_from_rl(rq_get_from_rl_args_t* rq_args){
     ums_context_t* ums_context;
     
     info_ums_context_t* array_info_context;
+    size_t array_size;
 
-    pid_t tgid;
     pid_t pid;
 
     int idx;
@@ -540,19 +725,21 @@ static inline int rq_get_from_rl(rq_get_from_rl_args_t* rq_args){
     if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
         return -EFAULT;
 
-    tgid = current->tgid;   // indicates the process
     pid = current->pid; // indicates the scheduler
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        return -ERR_INTERNAL;
-    }
-
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
+    rcu_read_unlock();
     if(unlikely(ums_scheduler_sl == NULL)){
         return -ERR_INTERNAL;
     }
 
+    // allocated before taking the spin_lock
+    array_size = min_t(size_t, rq_args_san.array_size, UMS_BATCH_MAX);
+    array_info_context = kvmalloc_array(max_t(size_t, array_size, 1), sizeof(info_ums_context_t), GFP_KERNEL);
+    if(unlikely(array_info_context == NULL))
+        return -ENOMEM;
+
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL)){
         ret = -ERR_INTERNAL;  
@@ -560,6 +747,10 @@ static inline int rq_get_from_rl(rq_get_from_rl_args_t* rq_args){
     }
 
 
+    // nothing to do, try to help a busy sibling
+    if(ums_scheduler_list_empty(&(ums_scheduler->ready_list)))
+        ums_scheduler_steal_ready_context(ums_scheduler_sl);
+
     ums_scheduler_ready_list_start_iteration(ums_scheduler, ums_context);
 
     if(ums_scheduler_list_empty(&(ums_scheduler->ready_list))){
@@ -568,55 +759,48 @@ static inline int rq_get_from_rl(rq_get_from_rl_args_t* rq_args){
         goto unlock;
     }
 
-    array_info_context = kmalloc(rq_args_san.array_size*sizeof(info_ums_context_t), GFP_KERNEL);
-    for(idx=0; idx < rq_args_san.array_size; idx++){
+    for(idx=0; idx < array_size; idx++){
         if(likely(ums_context != NULL)){   
 
-            array_info_context[idx].ucd = ums_context->id;
-            array_info_context[idx].number_switch = ums_context->num_switch;
-            array_info_context[idx].run_time_ms = ums_context_get_run_time_ms(ums_context);
-            array_info_context[idx].user_reserved = ums_context->user_reserved;
-            array_info_context[idx].from_cl = false;
+            ums_context_fill_info(ums_context, &array_info_context[idx], false);
 
             ums_scheduler_ready_list_iterate(ums_scheduler, ums_context);
         }
         else 
             break;
     }
-
-    if(copy_to_user(rq_args_san.info_context_array, array_info_context, idx*sizeof(info_ums_context_t))){
-        ret = -EFAULT;
-    }
-    else{
-        ret = idx;
-    }
-    kfree(array_info_context);
+    ret = idx;
 
 unlock:
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+
+    // copied after releasing the spin_lock, it can fault
+    if(ret > 0 && copy_to_user(rq_args_san.info_context_array, array_info_context, ret*sizeof(info_ums_context_t)))
+        ret = -EFAULT;
+    kvfree(array_info_context);
     
     return ret;
 }
 
 /**
- * @brief execute a context extracted by the completion_list
+ * @brief execute a context of a snapshot of the completion_list (see rq_get_from_cl())
+ * 
+ * The ums_context is claimed atomically, it fails fast with -ERR_STALE if it is no longer in the completion_list
+ * or -ERR_ASSIGNED if a sibling got it first
  */
-static inline int rq_execute(rq_execute_args_t* rq_args){
+static inline int rq_execute(ums_process_t* ums_process, rq_execute_args_t* rq_args){
     rq_execute_args_t rq_args_san;
 
     info_ums_context_t info_san;
     
-    ums_process_t* ums_process;
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
+    ums_completion_list_sl_t* ums_completion_list_sl; 
 
     ums_context_sl_t* ums_context_sl;
-    bool context_assigned;
 
     ums_context_t* ums_context;
-    ums_completion_list_item_t* ums_completion_list_item;
 
-    pid_t tgid;
     pid_t pid;
     int ret = 0;
     
@@ -626,33 +810,35 @@ static inline int rq_execute(rq_execute_args_t* rq_args){
     if(copy_from_user(&info_san, rq_args_san.info_context, sizeof(info_san)))
         return -EFAULT;
 
+    if(unlikely(!info_san.from_cl))
+        return -EINVAL; // see rq_execute_ready_list()
 
-    tgid = current->tgid;   // indicates the process
     pid = current->pid; // indicates the scheduler
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        return -ERR_INTERNAL;
-    }
-
-    ums_process_get_ums_context_sl(ums_process, rq_args_san.info_context->ucd, ums_context_sl);
+    // until it is claimed, the ums_context can be deleted
+    rcu_read_lock();
+    ums_process_get_ums_context_sl(ums_process, info_san.ucd, ums_context_sl);
     if(unlikely(ums_context_sl==NULL)){
-        return -ERR_INTERNAL;
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
     }
 
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
     if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;  
     }
+    ums_completion_list_sl = ums_scheduler->completion_list;
 
-    ums_context_sl_try_to_acquire(ums_context_sl, &context_assigned);
-    if(likely(context_assigned==true)){ // ums_context acquired
+    ums_completion_list_claim_ums_context_sl(ums_completion_list_sl, ums_context_sl, &ret);
+    if(likely(ret == 0)){ // ums_context acquired
         rq_args_san.routine = ums_context_sl->ums_context->routine;
         rq_args_san.args = ums_context_sl->ums_context->args;
         rq_args_san.ucd = ums_context_sl->id;
@@ -660,27 +846,16 @@ static inline int rq_execute(rq_execute_args_t* rq_args){
 
         rq_args_san.cpu_core = ums_scheduler->cpu_core;
 
-        if(copy_to_user(rq_args, &rq_args_san, sizeof(rq_args_san)))
-            return -EFAULT;
-
         ums_context = ums_context_sl->ums_context;
         ums_context_update_run_time_start_slot(ums_context);
+        WRITE_ONCE(ums_scheduler->dispatched, true);    // its thread is started by the user
+        trace_ums_context_execute_cl(pid, ums_context_sl->id);
     }
-    else{
-        printk("pid= %d exec, ums context already assigned :( \n", current->pid);
-        ret = -ERR_ASSIGNED;
-    }
-
-    if(info_san.from_cl){
-        ums_completion_list_remove_item_by_descriptor_no_sl(ums_scheduler->completion_list, ums_context_sl->id, ums_completion_list_item);
-        ums_scheduler_completion_list_iterate_end(ums_scheduler);
-    }
-    else{
-        printk("ERROR from_cl");
-       // ums_scheduler_ready_list_iterate_end(ums_scheduler);
-    }
-
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
+
+    if(likely(ret == 0) && copy_to_user(rq_args, &rq_args_san, sizeof(rq_args_san)))
+        ret = -EFAULT;
     return ret;
 }
 // -----------------------------------------------------------------------------------------------
@@ -691,75 +866,99 @@ static inline int rq_execute(rq_execute_args_t* rq_args){
  * @param rq_args 
  * @return int 
  */
-static inline int rq_execute_ready_list(rq_execute_args_t* rq_args){
+static inline int rq_execute_ready_list_san(ums_process_t* ums_process, info_ums_context_t info_san);
+
+static inline int rq_execute_ready_list(ums_process_t* ums_process, rq_execute_args_t* rq_args){
     rq_execute_args_t rq_args_san;
 
     info_ums_context_t info_san;
     
-    ums_process_t* ums_process;
+    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
+        return -EFAULT;
+
+    if(copy_from_user(&info_san, rq_args_san.info_context, sizeof(info_san)))
+        return -EFAULT;
+
+    return rq_execute_ready_list_san(ums_process, info_san);
+}
+
+/**
+ * Same as rq_execute_ready_list(), with arguments already in kernel space (e.g. taken from a ums_ring)
+ * 
+ * @param ums_process ums_process bound to the file of the caller
+ * @param info_san info of the ums_context to execute, only ucd and from_cl are used
+ * 
+ * @return Returns 0 on sucess, -EBUSY if a ums_context is already running on the scheduler, otherwise -errno  
+ */
+static inline int rq_execute_ready_list_san(ums_process_t* ums_process, info_ums_context_t info_san){
     ums_scheduler_sl_t* ums_scheduler_sl;
     ums_scheduler_t* ums_scheduler;
 
     ums_context_sl_t* ums_context_sl;
 
     ums_context_t* ums_context;
-    //ums_completion_list_item_t* ums_completion_list_item;
 
-    pid_t tgid;
     pid_t pid;
-    
-    if(copy_from_user(&rq_args_san, rq_args, sizeof(rq_args_san)))
-        return -EFAULT;
-
-    if(copy_from_user(&info_san, rq_args_san.info_context, sizeof(info_san)))
-        return -EFAULT;
 
+    if(unlikely(info_san.from_cl))
+        return -EINVAL; // see rq_execute()
 
-    tgid = current->tgid;   // indicates the process
     pid = current->pid; // indicates the scheduler
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL)){
-        return -ERR_INTERNAL;
-    }
-
+    // until it is found in the ready_list, the ums_context can be deleted
+    rcu_read_lock();
     ums_process_get_scheduler_sl(ums_process, pid, ums_scheduler_sl);
     if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
     ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
     if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;  
     }
 
-    ums_process_get_ums_context_sl(ums_process, rq_args_san.info_context->ucd, ums_context_sl);
+    // a ums_context is already running on this scheduler
+    if(unlikely(ums_scheduler->running_thread != NULL)){
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return -EBUSY;
+    }
+
+    ums_process_get_ums_context_sl(ums_process, info_san.ucd, ums_context_sl);
     if(unlikely(ums_context_sl==NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
         return -ERR_INTERNAL;
     }
 
     ums_context = ums_context_sl->ums_context;
-    
-    if(info_san.from_cl){
-        printk("ERROR from_cl");
-        //ums_completion_list_remove_item_by_descriptor_no_sl(ums_scheduler->completion_list, ums_context_sl->id, ums_completion_list_item);
-        //ums_scheduler_completion_list_iterate_end(ums_scheduler);
-    }
-    else{
-        ums_scheduler_ready_list_remove(ums_scheduler, ums_context);
-        ums_scheduler_ready_list_iterate_end(ums_scheduler);
+
+    // it must still wait in this ready_list, a sibling may have stolen it
+    if(unlikely(ums_context->pid_scheduler != pid || ums_context->state != UMS_THREAD_STATE_IDLE)){
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return -ERR_INVALID_UCD;
     }
+    
+    ums_scheduler_ready_list_remove(ums_scheduler, ums_context);
+    ums_scheduler_ready_list_iterate_end(ums_scheduler);
 
     ums_context_update_run_time_start_slot(ums_context);
+    trace_ums_context_execute_rl(pid, ums_context->id);
+    WRITE_ONCE(ums_context->handoff_start_ns, ktime_get_ns());
 
     ums_scheduler->num_switch += 1;
     ums_scheduler->running_thread = ums_context;    
+    WRITE_ONCE(ums_scheduler->dispatched, true);
     ums_context->state = UMS_THREAD_STATE_RUNNING;
+    ums_scheduler_quantum_start(ums_scheduler, ums_context);
 
     while(!wake_up_process(ums_context->task_struct));
     ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
     return 0;
 }
 // -----------------------------------------------------------------------------------------------
@@ -6,6 +6,11 @@
 #include <asm/uaccess.h> /* for put_user */
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/jump_label.h>
+#include <linux/nospec.h>
+
+#define CREATE_TRACE_POINTS
+#include "ums_trace.h"
 
 #include "../common/ums_requests.h"
 #include "../common/ums_types.h"
@@ -15,27 +20,98 @@
 #include "rq_ums_completion_list.h"
 #include "rq_ums_scheduler.h"
 #include "rq_ums_context.h"
+#include "ums_ioctl.h"
 
 #include "ums_proc.h"
 struct proc_dir_entry* ums_proc_ums_folder;
+struct proc_dir_entry* ums_proc_caches_file;
+struct proc_dir_entry* ums_proc_ioctl_stats_file;
 
 #define MODULE_NAME_LOG "UMS Log: "
 
 #define DEVICE_NAME "UMS"
 #define BUF_LEN 80
 
-#define DEBUG_REQUEST
-
 MODULE_LICENSE("GPL");
 
+// limits of the descriptors, clamped to [1, INT_MAX]: the descriptors are int and the xa_limit ends at limit - 1
+static int ums_max_ids_set(const char* val, const struct kernel_param* kp){
+    unsigned int max;
+    int res;
+
+    res = kstrtouint(val, 0, &max);
+    if(res != 0)
+        return res;
+
+    WRITE_ONCE(*(unsigned int*)kp->arg, clamp_t(unsigned int, max, 1, INT_MAX));
+    return 0;
+}
+
+static const struct kernel_param_ops ums_max_ids_ops = {
+    .set = ums_max_ids_set,
+    .get = param_get_uint,
+};
+
+unsigned int ums_max_contexts = 1 << 22;
+module_param_cb(ums_max_contexts, &ums_max_ids_ops, &ums_max_contexts, 0644);
+MODULE_PARM_DESC(ums_max_contexts, "Maximum number of ums_contexts of a process, in [1, INT_MAX]");
+
+unsigned int ums_max_completion_lists = 1 << 16;
+module_param_cb(ums_max_completion_lists, &ums_max_ids_ops, &ums_max_completion_lists, 0644);
+MODULE_PARM_DESC(ums_max_completion_lists, "Maximum number of ums_completion_lists of a process, in [1, INT_MAX]");
+
+bool ums_proc_objects = true;
+module_param(ums_proc_objects, bool, 0444);
+MODULE_PARM_DESC(ums_proc_objects, "Create the entries of processes and schedulers in /proc/ums");
+
+// debug output of the requests, static keys cost nothing when off
+DEFINE_STATIC_KEY_FALSE(ums_debug_requests);
+DEFINE_STATIC_KEY_FALSE(ums_debug_hashtable);
+
+static int ums_debug_key_set(const char* val, const struct kernel_param* kp){
+    struct static_key_false* key = (struct static_key_false*)kp->arg;
+    bool enable;
+    int res;
+
+    res = kstrtobool(val, &enable);
+    if(res != 0)
+        return res;
+
+    if(enable)
+        static_branch_enable(key);
+    else
+        static_branch_disable(key);
+    return 0;
+}
+
+static int ums_debug_key_get(char* buffer, const struct kernel_param* kp){
+    return sysfs_emit(buffer, "%c\n", static_key_enabled((struct static_key_false*)kp->arg)? 'Y' : 'N');
+}
+
+static const struct kernel_param_ops ums_debug_key_ops = {
+    .set = ums_debug_key_set,
+    .get = ums_debug_key_get,
+};
+
+module_param_cb(ums_debug_requests, &ums_debug_key_ops, &ums_debug_requests, 0644);
+MODULE_PARM_DESC(ums_debug_requests, "printk the result of each request");
+module_param_cb(ums_debug_hashtable, &ums_debug_key_ops, &ums_debug_hashtable, 0644);
+MODULE_PARM_DESC(ums_debug_hashtable, "printk the whole ums_hashtable after each request (slow)");
+
 int init_module(void);
 void cleanup_module(void);
+static int ums_open(struct inode *inode, struct file *file);
+static int ums_release(struct inode *inode, struct file *file);
 static long ums_ioctl(struct file *file, unsigned int request, unsigned long data);
+static int ums_mmap(struct file *file, struct vm_area_struct *vma);
 
 
 
 static struct file_operations fops = {
-    .unlocked_ioctl = ums_ioctl
+    .open = ums_open,
+    .release = ums_release,
+    .unlocked_ioctl = ums_ioctl,
+    .mmap = ums_mmap
 };
 
 static struct miscdevice mdev = {
@@ -48,157 +124,157 @@ static struct miscdevice mdev = {
 
 
 
-static long ums_ioctl(struct file *file, unsigned int request, unsigned long data){
-    // Each request will use copy_from_user and copy_to_user if needed
+/**
+ * @brief creates the ums_process of the caller and binds it to the file, 
+ * every request made through this file reaches its ums_process without the ums_hashtable
+ * 
+ */
+static int ums_open(struct inode *inode, struct file *file){
+    ums_process_t* ums_process;
     int res;
-    switch(request){
-        // ---------------------------------------------------------------------
-        case RQ_CREATE_PROCESS:
-            res = rq_create_process((rq_create_delete_process_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Created new process: res=%d\n", res);
-        #endif
-        break;
-        
-        case RQ_DELETE_PROCESS:
-            res = rq_delete_process((rq_create_delete_process_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Deleted a process: res=%d\n", res);
-        #endif
-        break;
-        // ---------------------------------------------------------------------
-        case RQ_CREATE_UMS_CONTEXT:
-            res = rq_create_ums_context((rq_create_delete_ums_context_args_t*)data);
-        #ifdef DEBUG_REQUEST            
-            printk(KERN_DEBUG "Created new ums_context: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_DELETE_UMS_CONTEXT:
-            res = rq_delete_ums_context((rq_create_delete_ums_context_args_t*)data);
-        #ifdef DEBUG_REQUEST            
-            printk(KERN_DEBUG "Deleted a ums_context: res=%d\n", res);
-        #endif
-        break;
-        // ---------------------------------------------------------------------
-
-       // ---------------------------------------------------------------------
-        case RQ_CREATE_COMPLETION_LIST:
-            res = rq_create_completion_list((rq_create_delete_completion_list_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Created new completion list: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_DELETE_COMPLETION_LIST:
-            res = rq_delete_completion_list((rq_create_delete_completion_list_args_t*)data);
-        #ifdef DEBUG_REQUEST            
-            printk(KERN_DEBUG "Deleted a completion list: res=%d\n", res);
-        #endif
-        break;
-        // ---------------------------------------------------------------------
-
-        case RQ_COMPLETION_LIST_ADD_UMS_CONTEXT:
-            res = rq_completion_list_add_ums_context((rq_completion_list_add_remove_ums_context_args_t*)data);
-        #ifdef DEBUG_REQUEST            
-            printk(KERN_DEBUG "Add ums_context=%d to the completion_list=%d: res=%d\n", 
-                            ((rq_completion_list_add_remove_ums_context_args_t*)data)->ums_context_d,
-                            ((rq_completion_list_add_remove_ums_context_args_t*)data)->completion_list_d,
-                            res);
-        #endif
-        break;
-
-        case RQ_COMPLETION_LIST_REMOVE_UMS_CONTEXT:
-            res = rq_completion_list_remove_ums_context((rq_completion_list_add_remove_ums_context_args_t*)data);
-        #ifdef DEBUG_REQUEST            
-            printk(KERN_DEBUG "Removed ums_context=%d from the completion_list=%d: res=%d\n", 
-                            ((rq_completion_list_add_remove_ums_context_args_t*)data)->ums_context_d,
-                            ((rq_completion_list_add_remove_ums_context_args_t*)data)->completion_list_d,
-                            res);
-        #endif
-        break;
-
-        case RQ_CREATE_UMS_SCHEDULER:
-            res = rq_create_ums_scheduler((rq_create_delete_ums_scheduler_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Created a new scheduler: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_EXIT_UMS_SCHEDULER:
-            res = rq_exit_ums_scheduler((rq_create_delete_ums_scheduler_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Deleted a scheduler: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_EXECUTE_NEXT_NEW_THREAD:
-            res = rq_execute_next_new_thread((rq_execute_next_new_thread_args_t*)data);
-        #ifdef DEBUG_REQUEST          
-            printk(KERN_DEBUG "Execute next new thread: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_STARTUP_NEW_THREAD:
-            res = rq_startup_new_thread((rq_startup_new_thread_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "Startup new thread: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_END_THREAD:
-            res = rq_end_thread((rq_end_thread_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "End thread: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_WAIT_NEXT_SCHEDULER_CALL:
-            res = rq_wait_next_scheduler_call((rq_wait_next_scheduler_call_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "rq_wait_next_scheduler_call: res=%d\n", res);
-        #endif
-        break;
-
-        case RQ_YIELD_UMS_CONTEXT:
-            res = rq_yield_ums_context((rq_yield_ums_context_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "rq_yield_ums_context: res=%d\n", res);
-        #endif       
-        break;
-
-        case RQ_EXECUTE_NEXT_READY_THREAD:
-            res = rq_execute_next_ready_thread((rq_execute_next_ready_thread_args_t*)data);
-        #ifdef DEBUG_REQUEST
-            printk(KERN_DEBUG "rq_execute_next_ready_thread: res=%d\n", res);
-        #endif       
-        break;
-
-        case RQ_GET_FROM_CL:
-            res = rq_get_from_cl((rq_get_from_cl_args_t*)data);
-        break;
-
-        case RQ_EXECUTE:
-            res = rq_execute((rq_execute_args_t*)data);
-        break;
-
-        case RQ_GET_FROM_RL:
-            res = rq_get_from_rl((rq_get_from_rl_args_t*)data);
-        break;
-
-        case RQ_EXECUTE_READY_LIST:
-            res = rq_execute_ready_list((rq_execute_args_t*)data);
-        break;
-
-        default:    //BAD REQUEST
-            //kernel sets automaticaly errno by reading this return value!
-            res = -EINVAL;      
-        break;    
+
+    ums_hashtable_create_process(current->tgid, ums_process, res);
+    if(unlikely(res != 0))
+        return res;  // -EBUSY if already opened by this process
+
+    file->private_data = ums_process;
+    return 0;
+}
+
+/**
+ * @brief destroys the ums_process bound to the file
+ * 
+ */
+static int ums_release(struct inode *inode, struct file *file){
+    ums_process_t* ums_process = (ums_process_t*)file->private_data;
+
+    if(likely(ums_process != NULL)){
+        file->private_data = NULL;
+        // threads that exited or have been killed without RQ_END_THREAD
+        ums_process_detach_blocked_notify(ums_process);
+        ums_hashtable_destroy_process(ums_process);
+    }
+    return 0;
+}
+
+/**
+ * @brief maps the ums_ring (offset 0, see ../common/ums_ring.h) or the state pages (see ../common/ums_state.h) of the calling scheduler
+ * 
+ */
+static int ums_mmap(struct file *file, struct vm_area_struct *vma){
+    ums_process_t* ums_process;
+
+    ums_file_get_process(file, ums_process);
+    if(unlikely(ums_process == NULL))
+        return -ERR_INTERNAL;
+
+    if(vma->vm_pgoff == (UMS_STATE_MMAP_OFFSET >> PAGE_SHIFT))
+        return ums_state_mmap(ums_process, vma);
+    return ums_ring_mmap(ums_process, vma);
+}
+
+/** defines ums_ioctl_<fn>(), handler of the dispatch table that calls the request fn with its args */
+#define DEFINE_UMS_IOCTL(fn, args_type) \
+    static long ums_ioctl_##fn(struct file* file, ums_process_t* ums_process, unsigned long data){   \
+        return fn(ums_process, (args_type*)data);   \
     }
 
-    #ifdef DEBUG_PRINTK_HASHTABLE
+/** entry of the dispatch table of a request, handled by ums_ioctl_<fn>() */
+#define UMS_IOCTL_ENTRY(request, fn)    \
+    [UMS_IOCTL_INDEX(request)] = { .name = #fn, .handler = ums_ioctl_##fn }
+
+// Each request will use copy_from_user and copy_to_user if needed
+static long ums_ioctl_rq_create_process(struct file* file, ums_process_t* ums_process, unsigned long data){
+    return rq_create_process(file, (rq_create_delete_process_args_t*)data);
+}
+static long ums_ioctl_rq_delete_process(struct file* file, ums_process_t* ums_process, unsigned long data){
+    return rq_delete_process(file, (rq_create_delete_process_args_t*)data);
+}
+DEFINE_UMS_IOCTL(rq_create_ums_context, rq_create_delete_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_delete_ums_context, rq_create_delete_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_create_completion_list, rq_create_delete_completion_list_args_t)
+DEFINE_UMS_IOCTL(rq_delete_completion_list, rq_create_delete_completion_list_args_t)
+DEFINE_UMS_IOCTL(rq_completion_list_add_ums_context, rq_completion_list_add_remove_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_completion_list_remove_ums_context, rq_completion_list_add_remove_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_create_ums_scheduler, rq_create_delete_ums_scheduler_args_t)
+DEFINE_UMS_IOCTL(rq_exit_ums_scheduler, rq_create_delete_ums_scheduler_args_t)
+DEFINE_UMS_IOCTL(rq_execute_next_new_thread, rq_execute_next_new_thread_args_t)
+DEFINE_UMS_IOCTL(rq_startup_new_thread, rq_startup_new_thread_args_t)
+DEFINE_UMS_IOCTL(rq_end_thread, rq_end_thread_args_t)
+DEFINE_UMS_IOCTL(rq_wait_next_scheduler_call, rq_wait_next_scheduler_call_args_t)
+DEFINE_UMS_IOCTL(rq_yield_ums_context, rq_yield_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_switch_to_ums_context, rq_switch_to_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_park_ums_context, rq_park_ums_context_args_t)
+DEFINE_UMS_IOCTL(rq_execute_next_ready_thread, rq_execute_next_ready_thread_args_t)
+DEFINE_UMS_IOCTL(rq_execute_highest_prio_ready_thread, rq_execute_next_ready_thread_args_t)
+DEFINE_UMS_IOCTL(rq_create_ums_context_batch, rq_create_ums_context_batch_args_t)
+DEFINE_UMS_IOCTL(rq_completion_list_add_ums_context_batch, rq_completion_list_add_ums_context_batch_args_t)
+DEFINE_UMS_IOCTL(rq_ums_ring_enter, rq_ums_ring_enter_args_t)
+DEFINE_UMS_IOCTL(rq_park_ums_scheduler, rq_park_ums_scheduler_args_t)
+DEFINE_UMS_IOCTL(rq_set_ums_context_prio, rq_set_ums_context_prio_args_t)
+DEFINE_UMS_IOCTL(rq_get_from_cl, rq_get_from_cl_args_t)
+DEFINE_UMS_IOCTL(rq_execute, rq_execute_args_t)
+DEFINE_UMS_IOCTL(rq_get_from_rl, rq_get_from_rl_args_t)
+DEFINE_UMS_IOCTL(rq_execute_ready_list, rq_execute_args_t)
+
+const ums_ioctl_entry_t ums_ioctl_table[UMS_IOCTL_NUM] = {
+    UMS_IOCTL_ENTRY(RQ_CREATE_PROCESS, rq_create_process),
+    UMS_IOCTL_ENTRY(RQ_DELETE_PROCESS, rq_delete_process),
+    UMS_IOCTL_ENTRY(RQ_CREATE_UMS_CONTEXT, rq_create_ums_context),
+    UMS_IOCTL_ENTRY(RQ_DELETE_UMS_CONTEXT, rq_delete_ums_context),
+    UMS_IOCTL_ENTRY(RQ_CREATE_COMPLETION_LIST, rq_create_completion_list),
+    UMS_IOCTL_ENTRY(RQ_DELETE_COMPLETION_LIST, rq_delete_completion_list),
+    UMS_IOCTL_ENTRY(RQ_COMPLETION_LIST_ADD_UMS_CONTEXT, rq_completion_list_add_ums_context),
+    UMS_IOCTL_ENTRY(RQ_COMPLETION_LIST_REMOVE_UMS_CONTEXT, rq_completion_list_remove_ums_context),
+    UMS_IOCTL_ENTRY(RQ_CREATE_UMS_SCHEDULER, rq_create_ums_scheduler),
+    UMS_IOCTL_ENTRY(RQ_EXIT_UMS_SCHEDULER, rq_exit_ums_scheduler),
+    UMS_IOCTL_ENTRY(RQ_EXECUTE_NEXT_NEW_THREAD, rq_execute_next_new_thread),
+    UMS_IOCTL_ENTRY(RQ_STARTUP_NEW_THREAD, rq_startup_new_thread),
+    UMS_IOCTL_ENTRY(RQ_END_THREAD, rq_end_thread),
+    UMS_IOCTL_ENTRY(RQ_WAIT_NEXT_SCHEDULER_CALL, rq_wait_next_scheduler_call),
+    UMS_IOCTL_ENTRY(RQ_YIELD_UMS_CONTEXT, rq_yield_ums_context),
+    UMS_IOCTL_ENTRY(RQ_SWITCH_TO_UMS_CONTEXT, rq_switch_to_ums_context),
+    UMS_IOCTL_ENTRY(RQ_PARK_UMS_CONTEXT, rq_park_ums_context),
+    UMS_IOCTL_ENTRY(RQ_EXECUTE_NEXT_READY_THREAD, rq_execute_next_ready_thread),
+    UMS_IOCTL_ENTRY(RQ_EXECUTE_HIGHEST_PRIO_READY_THREAD, rq_execute_highest_prio_ready_thread),
+    UMS_IOCTL_ENTRY(RQ_CREATE_UMS_CONTEXT_BATCH, rq_create_ums_context_batch),
+    UMS_IOCTL_ENTRY(RQ_COMPLETION_LIST_ADD_UMS_CONTEXT_BATCH, rq_completion_list_add_ums_context_batch),
+    UMS_IOCTL_ENTRY(RQ_UMS_RING_ENTER, rq_ums_ring_enter),
+    UMS_IOCTL_ENTRY(RQ_PARK_UMS_SCHEDULER, rq_park_ums_scheduler),
+    UMS_IOCTL_ENTRY(RQ_SET_UMS_CONTEXT_PRIO, rq_set_ums_context_prio),
+    UMS_IOCTL_ENTRY(RQ_GET_FROM_CL, rq_get_from_cl),
+    UMS_IOCTL_ENTRY(RQ_EXECUTE, rq_execute),
+    UMS_IOCTL_ENTRY(RQ_GET_FROM_RL, rq_get_from_rl),
+    UMS_IOCTL_ENTRY(RQ_EXECUTE_READY_LIST, rq_execute_ready_list),
+};
+
+static long ums_ioctl(struct file *file, unsigned int request, unsigned long data){
+    const ums_ioctl_entry_t* entry;
+    ums_process_t* ums_process;
+    unsigned int index;
+    cycles_t start;
+    long res;
+
+    ums_file_get_process(file, ums_process);
+    if(unlikely(ums_process == NULL))
+        return -ERR_INTERNAL;
+
+    index = UMS_IOCTL_INDEX(request);
+    if(unlikely(index >= UMS_IOCTL_NUM))
+        return -EINVAL;     //BAD REQUEST: kernel sets automaticaly errno by reading this return value!
+    index = array_index_nospec(index, UMS_IOCTL_NUM);   // the index comes from the user
+    entry = &ums_ioctl_table[index];
+    if(unlikely(entry->handler == NULL))
+        return -EINVAL;
+
+    start = get_cycles();
+    res = entry->handler(file, ums_process, data);
+    ums_ioctl_stats_add(index, get_cycles() - start, res);
+
+    if(static_branch_unlikely(&ums_debug_requests))
+        printk(KERN_DEBUG "%s: res=%ld\n", entry->name, res);
+    if(static_branch_unlikely(&ums_debug_hashtable))
         PRINTK_UMS_HASHTABLE(0);
-    #endif
 
     return res;
 }
@@ -208,15 +284,25 @@ int init_module(void){
     int ret;
     printk(KERN_DEBUG MODULE_NAME_LOG "init\n");
 
+    ret = ums_cache_init();
+    if (ret < 0){
+        printk(KERN_ALERT MODULE_NAME_LOG "Creating UMS kmem_caches failed\n");
+        return ret;
+    }
+
     ret = misc_register(&mdev);
 
     if (ret < 0){
         printk(KERN_ALERT MODULE_NAME_LOG "Registering UMS Module failed\n");
+        ums_cache_destroy();
         return ret;
     }
 
     UMS_HASHTABLE_INIT();
     ums_proc_mount();
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+    preempt_notifier_inc(); // used to detect blocked ums_contexts
+#endif
     //test();
     printk(KERN_DEBUG MODULE_NAME_LOG "UMS Module registered successfully\n");
 
@@ -224,8 +310,12 @@ int init_module(void){
 }
 
 void cleanup_module(void){
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+    preempt_notifier_dec();
+#endif
     ums_proc_unmount();
     misc_deregister(&mdev);
+    ums_cache_destroy();
     
     
     printk(KERN_DEBUG MODULE_NAME_LOG "UMS Module un-registered successfully\n");
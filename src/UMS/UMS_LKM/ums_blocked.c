@@ -0,0 +1,176 @@
+#include "ums_blocked.h"
+#include "ums_context.h"
+#include "ums_process.h"
+#include <linux/sched.h>
+#include <linux/delay.h>
+#include <linux/module.h>
+
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+// ---------------------------------------------------------------------------------------------
+/**
+ * @brief called when the thread of a ums_context leaves the CPU
+ *
+ * The thread blocked if it is not runnable anymore while its ums_context is running: yield, switch_to and end_thread
+ * change the state of the ums_context before sleeping, so they are not reported. It also stops the on-CPU time of the slot
+ * NOTE: the runqueue lock is held, the scheduler is woken up by an irq_work
+ */
+static void ums_context_sched_out(struct preempt_notifier* notifier, struct task_struct* next){
+    ums_context_t* ums_context = container_of(notifier, ums_context_t, preempt_notifier);
+
+    ums_context_cpu_time_stop(ums_context);
+
+    if(task_is_running(current) || READ_ONCE(ums_context->state) != UMS_THREAD_STATE_RUNNING)
+        return;
+    if(READ_ONCE(ums_context->blocked) || READ_ONCE(ums_context->unblock_pending))
+        return;
+
+    WRITE_ONCE(ums_context->blocked, true);
+    irq_work_queue(&ums_context->blocked_work);
+}
+
+/**
+ * @brief called when the thread of a ums_context gets the CPU
+ *
+ * If the thread has been blocked, it must not go on with the user's routine: it waits in the ready_list until
+ * a scheduler executes it. Here it cannot sleep, the handler of UMS_PARK_SIGNAL parks it (RQ_PARK_UMS_CONTEXT).
+ * Otherwise the on-CPU time of the running slot restarts
+ * NOTE: the runqueue lock is held, the signal is sent by an irq_work
+ */
+static void ums_context_sched_in(struct preempt_notifier* notifier, int cpu){
+    ums_context_t* ums_context = container_of(notifier, ums_context_t, preempt_notifier);
+
+    ums_context_cpu_time_start(ums_context);
+
+    if(READ_ONCE(ums_context->unblock_pending))
+        return;
+    if(!READ_ONCE(ums_context->blocked) && READ_ONCE(ums_context->state) != UMS_THREAD_STATE_BLOCKED)
+        return;
+
+    WRITE_ONCE(ums_context->unblock_pending, true);
+    irq_work_queue(&ums_context->unblocked_work);
+}
+
+struct preempt_ops ums_context_preempt_ops = {
+    .sched_in = ums_context_sched_in,
+    .sched_out = ums_context_sched_out,
+};
+// ---------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------
+void ums_context_blocked_work(struct irq_work* work){
+    ums_context_t* ums_context = container_of(work, ums_context_t, blocked_work);
+    struct task_struct* scheduler_task_struct = READ_ONCE(ums_context->scheduler_task_struct);
+
+    if(likely(scheduler_task_struct != NULL))
+        wake_up_process(scheduler_task_struct);
+}
+
+void ums_context_unblocked_work(struct irq_work* work){
+    ums_context_t* ums_context = container_of(work, ums_context_t, unblocked_work);
+
+    // without a handler the thread goes on with the user's routine, as without preempt notifiers
+    if(unlikely(!ums_context_send_park_signal(ums_context))){
+        WRITE_ONCE(ums_context->blocked, false);
+        WRITE_ONCE(ums_context->unblock_pending, false);
+    }
+}
+// ---------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------
+/**
+ * @brief true if a task has done its last context switch, it will never run its preempt_notifiers again
+ * 
+ */
+static inline bool ums_task_switched_out_dead(struct task_struct* task_struct){
+    if(READ_ONCE(task_struct->__state) != TASK_DEAD || READ_ONCE(task_struct->on_rq))
+        return false;   // alive, or preempted before its last schedule()
+#ifdef CONFIG_SMP
+    if(smp_load_acquire(&task_struct->on_cpu))
+        return false;
+#endif
+    return true;
+}
+
+int ums_context_detach_blocked_notify(struct ums_context_t* ums_context){
+    struct task_struct* task_struct = ums_context->notify_task;
+
+    if(task_struct == NULL)
+        goto sync;
+    if(task_struct == current){
+        ums_context_unregister_blocked_notify(ums_context);
+        goto sync;
+    }
+
+    while((task_struct->flags & PF_EXITING) && !ums_task_switched_out_dead(task_struct))
+        msleep(1);
+    if(!ums_task_switched_out_dead(task_struct))
+        return -EBUSY;
+
+    // no one walks the preempt_notifiers of a dead task, the reference keeps it allocated
+    irq_work_sync(&ums_context->blocked_work);
+    irq_work_sync(&ums_context->unblocked_work);
+    preempt_notifier_unregister(&ums_context->preempt_notifier);
+    ums_context->notify_task = NULL;
+    put_task_struct(task_struct);
+    return 0;
+
+sync:
+    ums_context_sync_blocked_notify(ums_context);
+    return 0;
+}
+
+void ums_process_detach_blocked_notify(struct ums_process_t* ums_process){
+    ums_context_sl_t* ums_context_sl;
+    unsigned long id;
+
+    xa_for_each(&ums_process->xa_ums_context, id, ums_context_sl){
+        if(unlikely(ums_context_detach_blocked_notify(ums_context_sl->ums_context) != 0)){
+            pr_warn_once("UMS: the thread %d of a ums_context is alive at the release of its process, the module is pinned\n",
+                            ums_context_sl->ums_context->pid);
+            __module_get(THIS_MODULE);
+        }
+    }
+}
+// ---------------------------------------------------------------------------------------------
+#endif
+
+// ---------------------------------------------------------------------------------------------
+int ums_context_park_unblocked(struct ums_process_t* ums_process, struct ums_context_t* ums_context){
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    // it is neither in a ready_list nor running, no one can steal it
+    rcu_read_lock();
+    ums_process_get_scheduler_sl(ums_process, ums_context->pid_scheduler, ums_scheduler_sl);
+    if(unlikely(ums_scheduler_sl == NULL)){
+        rcu_read_unlock();
+        goto end;   // the scheduler exited, go on without it
+    }
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(unlikely(ums_scheduler == NULL)){
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        goto end;
+    }
+
+    if(ums_context->state == UMS_THREAD_STATE_BLOCKED){ // the scheduler has been already notified
+        ums_context->state = UMS_THREAD_STATE_IDLE;
+        ums_scheduler_ready_list_add(ums_scheduler, ums_context);
+    }
+    else    // ums_scheduler_notify_blocked() will put it in the ready_list
+        ums_context->unblocked = true;
+
+    set_current_state(TASK_INTERRUPTIBLE);
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
+
+    schedule(); // until a scheduler executes it again
+    ums_process_handoff_end(ums_process, ums_context);
+
+end:
+    WRITE_ONCE(ums_context->blocked, false);
+    WRITE_ONCE(ums_context->unblock_pending, false);
+    return 0;
+}
+// ---------------------------------------------------------------------------------------------
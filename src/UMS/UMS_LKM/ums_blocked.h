@@ -0,0 +1,64 @@
+#pragma once
+/// @file
+/// This file contains the functions used to notify a scheduler when one of its ums_contexts blocks in the kernel
+///
+
+#include <linux/kernel.h>
+#include <linux/preempt.h>
+#include <linux/irq_work.h>
+
+struct ums_context_t;
+struct ums_process_t;
+
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+/**
+ * @brief preempt_ops registered by the thread of a running ums_context
+ *
+ * sched_out detects the thread going to sleep while running and wakes up the scheduler (REASON_THREAD_BLOCKED),
+ * sched_in detects the thread woken up and parks it in the ready_list before it returns to user space
+ */
+extern struct preempt_ops ums_context_preempt_ops;
+
+/**
+ * @brief irq_work queued by sched_out, wakes up the scheduler of the blocked ums_context
+ *
+ */
+void ums_context_blocked_work(struct irq_work* work);
+
+/**
+ * @brief irq_work queued by sched_in, sends UMS_PARK_SIGNAL to the unblocked thread
+ *
+ */
+void ums_context_unblocked_work(struct irq_work* work);
+
+/**
+ * @brief unregister the preempt_notifier of a ums_context from a thread other than the one that registered it
+ * (delete of the ums_context, release of the process), then wait its pending irq_works
+ *
+ * The preempt_notifiers of a task are not locked, they can be changed only when the task cannot run them:
+ * it is current or it is dead. A thread that is exiting is waited for
+ * NOTE: it can sleep
+ * @return 0 if the preempt_notifier is no longer registered, -EBUSY if its thread is alive
+ */
+int ums_context_detach_blocked_notify(struct ums_context_t* ums_context);
+
+/**
+ * @brief ums_context_detach_blocked_notify() on each ums_context of a process that is being released
+ *
+ * If a thread is still alive, its ums_context is not freed anyway: the module is pinned until reboot,
+ * since the preempt_notifier keeps using ums_context_preempt_ops
+ * NOTE: it can sleep
+ */
+void ums_process_detach_blocked_notify(struct ums_process_t* ums_process);
+#else
+static inline int ums_context_detach_blocked_notify(struct ums_context_t* ums_context){ return 0; }
+static inline void ums_process_detach_blocked_notify(struct ums_process_t* ums_process){}
+#endif
+
+/**
+ * @brief called by the thread of an unblocked ums_context (RQ_PARK_UMS_CONTEXT), it puts the ums_context in the
+ * ready_list and waits to be executed
+ *
+ * @return 0, also if the scheduler exited: the thread goes on without it
+ */
+int ums_context_park_unblocked(struct ums_process_t* ums_process, struct ums_context_t* ums_context);
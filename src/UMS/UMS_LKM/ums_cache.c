@@ -0,0 +1,67 @@
+#include "ums_cache.h"
+#include "ums_hashtable.h"
+
+#define UMS_CACHE_ENTRY(name_in, type, flags_in)    \
+    { .name = name_in, .obj_size = sizeof(type), .flags = flags_in, .rcu_offset = 0, .rcu_free = NULL, .cache = NULL, .in_use = ATOMIC_INIT(0), .max_in_use = ATOMIC_INIT(0) }
+
+#define UMS_CACHE_ENTRY_RCU(name_in, type, flags_in)    \
+    { .name = name_in, .obj_size = sizeof(type), .flags = flags_in, .rcu_offset = offsetof(type, rcu), .rcu_free = type##_rcu_free, .cache = NULL, .in_use = ATOMIC_INIT(0), .max_in_use = ATOMIC_INIT(0) }
+
+/** defines the call_rcu() callback of the objects allocated from cache_id */
+#define DEFINE_UMS_CACHE_RCU_FREE(cache_id, type) \
+    static void type##_rcu_free(struct rcu_head* head){  \
+        ums_cache_free(cache_id, container_of(head, type, rcu));    \
+    }
+
+DEFINE_UMS_CACHE_RCU_FREE(UMS_CACHE_PROCESS,                ums_process_t)
+DEFINE_UMS_CACHE_RCU_FREE(UMS_CACHE_SCHEDULER_SL,           ums_scheduler_sl_t)
+DEFINE_UMS_CACHE_RCU_FREE(UMS_CACHE_CONTEXT,                ums_context_t)
+DEFINE_UMS_CACHE_RCU_FREE(UMS_CACHE_CONTEXT_SL,             ums_context_sl_t)
+DEFINE_UMS_CACHE_RCU_FREE(UMS_CACHE_COMPLETION_LIST_SL,     ums_completion_list_sl_t)
+
+// small objects created in large numbers are packed, the others start on a cache line
+ums_cache_t ums_caches[UMS_CACHE_NUM] = {
+    [UMS_CACHE_PROCESS]                 = UMS_CACHE_ENTRY_RCU("ums_process",                ums_process_t,              SLAB_HWCACHE_ALIGN),
+    [UMS_CACHE_SCHEDULER]               = UMS_CACHE_ENTRY(    "ums_scheduler",              ums_scheduler_t,            SLAB_HWCACHE_ALIGN),
+    [UMS_CACHE_SCHEDULER_SL]            = UMS_CACHE_ENTRY_RCU("ums_scheduler_sl",           ums_scheduler_sl_t,         SLAB_HWCACHE_ALIGN),
+    [UMS_CACHE_CONTEXT]                 = UMS_CACHE_ENTRY_RCU("ums_context",                ums_context_t,              SLAB_HWCACHE_ALIGN),
+    [UMS_CACHE_CONTEXT_SL]              = UMS_CACHE_ENTRY_RCU("ums_context_sl",             ums_context_sl_t,           0),
+    [UMS_CACHE_COMPLETION_LIST_SL]      = UMS_CACHE_ENTRY_RCU("ums_completion_list_sl",     ums_completion_list_sl_t,   SLAB_HWCACHE_ALIGN),
+};
+
+int ums_cache_init(void){
+    int i;
+    for(i=0; i<UMS_CACHE_NUM; i++){
+        ums_caches[i].cache = kmem_cache_create(ums_caches[i].name, ums_caches[i].obj_size, 0, ums_caches[i].flags, NULL);
+        if(unlikely(ums_caches[i].cache == NULL)){
+            ums_cache_destroy();
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+void ums_cache_destroy(void){
+    int i;
+    rcu_barrier();  // pending ums_cache_free_rcu() use the caches
+    for(i=0; i<UMS_CACHE_NUM; i++){
+        // NULL is ignored by kmem_cache_destroy()
+        kmem_cache_destroy(ums_caches[i].cache);
+        ums_caches[i].cache = NULL;
+    }
+}
+
+int ums_cache_seq_show_info(struct seq_file* m){
+    int i;
+
+    seq_printf(m, "%-26s %8s %10s %10s\n", "name", "objsize", "in_use", "max_in_use");
+    for(i=0; i<UMS_CACHE_NUM; i++){
+        seq_printf(m, "%-26s %8u %10d %10d\n",
+                    ums_caches[i].name,
+                    ums_caches[i].obj_size,
+                    atomic_read(&ums_caches[i].in_use),
+                    atomic_read(&ums_caches[i].max_in_use)
+                    );
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+#pragma once
+/// @file
+/// This file contains the kmem_caches used to allocate all UMS objects
+///
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/atomic.h>
+#include <linux/rcupdate.h>
+#include <linux/seq_file.h>
+
+#define UMS_CACHE_PROCESS               0   /** ums_process_t */
+#define UMS_CACHE_SCHEDULER             1   /** ums_scheduler_t */
+#define UMS_CACHE_SCHEDULER_SL          2   /** ums_scheduler_sl_t */
+#define UMS_CACHE_CONTEXT               3   /** ums_context_t */
+#define UMS_CACHE_CONTEXT_SL            4   /** ums_context_sl_t */
+#define UMS_CACHE_COMPLETION_LIST_SL    5   /** ums_completion_list_sl_t */
+#define UMS_CACHE_NUM                   6
+
+/**
+ * @brief a kmem_cache with its usage counters
+ *
+ */
+typedef struct ums_cache_t{
+    const char* name;   /** name of the kmem_cache (see /proc/slabinfo) */
+    unsigned int obj_size;  /** size of an object */
+    unsigned long flags;    /** flags of the kmem_cache */
+
+    size_t rcu_offset;  /** offset of the struct rcu_head in the object, used by ums_cache_free_rcu() */
+    rcu_callback_t rcu_free;    /** callback of call_rcu(), NULL if the object cannot be freed with ums_cache_free_rcu() */
+
+    struct kmem_cache* cache;   /** the actual kmem_cache */
+    atomic_t in_use;    /** objects currently allocated */
+    atomic_t max_in_use;    /** highest value of in_use */
+}ums_cache_t;
+
+extern ums_cache_t ums_caches[UMS_CACHE_NUM];
+
+/**
+ * @brief create all the kmem_caches, to be called by init_module()
+ *
+ * @return Returns 0 on sucess, otherwise -ENOMEM
+ */
+int ums_cache_init(void);
+
+/**
+ * @brief destroy all the kmem_caches, to be called by cleanup_module()
+ * 
+ * NOTE: waits the pending ums_cache_free_rcu()
+ *
+ */
+void ums_cache_destroy(void);
+
+/**
+ * @brief show the usage of the kmem_caches in /proc/ums/caches
+ *
+ */
+int ums_cache_seq_show_info(struct seq_file* m);
+
+// -------------------------------------------------------------------
+/**
+ * @brief allocate an object from a kmem_cache
+ *
+ * @param cache_id one of UMS_CACHE_*
+ * @return pointer to the new object, NULL on failure
+ */
+static inline void* ums_cache_alloc(int cache_id){
+    ums_cache_t* ums_cache = &ums_caches[cache_id];
+    int in_use;
+    int max_in_use;
+    void* obj = kmem_cache_alloc(ums_cache->cache, GFP_KERNEL);
+
+    if(likely(obj)){
+        in_use = atomic_inc_return(&ums_cache->in_use);
+        max_in_use = atomic_read(&ums_cache->max_in_use);
+        while(unlikely(in_use > max_in_use) && !atomic_try_cmpxchg(&ums_cache->max_in_use, &max_in_use, in_use));
+    }
+    return obj;
+}
+
+/**
+ * @brief allocate several objects from a kmem_cache, all or nothing
+ *
+ * @param cache_id one of UMS_CACHE_*
+ * @param num number of objects
+ * @param objs output, array of at least num pointers
+ * @return true on success, false if no object has been allocated
+ */
+static inline bool ums_cache_alloc_bulk(int cache_id, size_t num, void** objs){
+    ums_cache_t* ums_cache = &ums_caches[cache_id];
+    int in_use;
+    int max_in_use;
+
+    if(unlikely(kmem_cache_alloc_bulk(ums_cache->cache, GFP_KERNEL, num, objs) == 0))
+        return false;
+
+    in_use = atomic_add_return(num, &ums_cache->in_use);
+    max_in_use = atomic_read(&ums_cache->max_in_use);
+    while(unlikely(in_use > max_in_use) && !atomic_try_cmpxchg(&ums_cache->max_in_use, &max_in_use, in_use));
+    return true;
+}
+
+/**
+ * @brief give back an object to its kmem_cache
+ *
+ * @param cache_id one of UMS_CACHE_*, the same used to allocate the object
+ * @param obj object to free
+ */
+static inline void ums_cache_free(int cache_id, void* obj){
+    kmem_cache_free(ums_caches[cache_id].cache, obj);
+    atomic_dec(&ums_caches[cache_id].in_use);
+}
+
+/**
+ * @brief give back several objects to their kmem_cache
+ *
+ * @param cache_id one of UMS_CACHE_*, the same used to allocate the objects
+ * @param num number of objects
+ * @param objs array of objects to free
+ */
+static inline void ums_cache_free_bulk(int cache_id, size_t num, void** objs){
+    kmem_cache_free_bulk(ums_caches[cache_id].cache, num, objs);
+    atomic_sub(num, &ums_caches[cache_id].in_use);
+}
+
+/**
+ * @brief give back an object to its kmem_cache after a grace period, 
+ * used for objects that can be reached by lockless (RCU) lookups
+ *
+ * @param cache_id one of UMS_CACHE_*, its objects must have a "struct rcu_head rcu" field
+ * @param obj object to free
+ */
+static inline void ums_cache_free_rcu(int cache_id, void* obj){
+    call_rcu((struct rcu_head*)((char*)obj + ums_caches[cache_id].rcu_offset), ums_caches[cache_id].rcu_free);
+}
+// -------------------------------------------------------------------
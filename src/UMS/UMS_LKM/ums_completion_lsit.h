@@ -15,45 +15,13 @@
 #include <stdbool.h>
 #include <linux/list.h>
 #include <linux/rwlock.h>
+#include <linux/rcupdate.h>
+#include <linux/cache.h>
+#include <linux/wait.h>
 
 #include "../common/ums_types.h"
 #include "ums_context.h"
-
-// ums_completion_list_item_t ########################################################################################
-/**
- * @brief element of completion_list
- * 
- */
-typedef struct ums_completion_list_item_t{
-    struct list_head list;  /** list field */
-    int ums_context_id; /** descriptor of the referred ums_context */
-}ums_completion_list_item_t;
-
-// -------------------------------------------------------------------
-/**
- * @brief constructor ums_completion_list_item
- * 
- * @param p_ums_completion_list_item object to init
- * @param ums_context_id_in id of the referred ums_context
- * 
- */
-#define INIT_UMS_COMPLETION_LIST_ITEM(p_ums_completion_list_item, ums_context_id_in) \
-    do{ \
-        (p_ums_completion_list_item)->ums_context_id = ums_context_id_in;   \
-    }while(0)
-
-/**
- * @brief destructor ums_completion_list_item
- * 
- * @param p_ums_completion_list_item object to destroy
- * 
- */
-#define DESTROY_UMS_COMPLETION_LIST_ITEM(p_ums_completion_list_item) \
-    do{ \
-        (p_ums_completion_list_item)->ums_context_id = -1;   \
-    }while(0)
-// -------------------------------------------------------------------
-// ########################################################################################
+#include "ums_state.h"
 
 // ums_completion_list_sl_t ########################################################################################
 /**
@@ -62,9 +30,18 @@ typedef struct ums_completion_list_item_t{
  */
 typedef struct ums_completion_list_sl_t{
     int id; /** descriptor */
+    struct rcu_head rcu; /** used to free it after a grace period */
+
+    spinlock_t ums_context_list_spin_lock ____cacheline_aligned_in_smp;  /** used to protect the ums_completion_list, shared by several schedulers */
+    struct list_head ums_context_list;  /** ums_completion_list, list of ums_context_sl linked by their cl_list field */
+    int num;    /** number of ums_context_sl in ums_context_list. Protected by ums_context_list_spin_lock */
+
+    spinlock_t schedulers_spin_lock;    /** serializes writers of schedulers, readers use RCU */
+    struct list_head schedulers;    /** ums_scheduler_sl that use this ums_completion_list, siblings for the work stealing */
 
-    spinlock_t ums_context_list_spin_lock;  /** used to protect the ums_completion_list */
-    struct list_head ums_context_list;  /** ums_completion_list */
+    wait_queue_head_t idle_wait_queue;  /** schedulers parked until a ums_context is added or becomes ready */
+
+    ums_state_t* state; /** state page of the ums_completion_list, created by the first scheduler that maps its state pages. Protected by ums_context_list_spin_lock */
 }ums_completion_list_sl_t;
 
 // -------------------------------------------------------------------
@@ -79,6 +56,14 @@ typedef struct ums_completion_list_sl_t{
         \
         spin_lock_init(&(p_ums_completion_list_sl)->ums_context_list_spin_lock);  \
         INIT_LIST_HEAD(&(p_ums_completion_list_sl)->ums_context_list); \
+        (p_ums_completion_list_sl)->num = 0; \
+        \
+        spin_lock_init(&(p_ums_completion_list_sl)->schedulers_spin_lock);  \
+        INIT_LIST_HEAD(&(p_ums_completion_list_sl)->schedulers); \
+        \
+        init_waitqueue_head(&(p_ums_completion_list_sl)->idle_wait_queue); \
+        \
+        (p_ums_completion_list_sl)->state = NULL; \
     }while(0)
 
 /**
@@ -89,180 +74,311 @@ typedef struct ums_completion_list_sl_t{
 #define DESTROY_UMS_COMPLETION_LIST_SL(p_ums_completion_list_sl)   \
     do{ \
         (p_ums_completion_list_sl)->id = -1; \
+        \
+        if((p_ums_completion_list_sl)->state != NULL){    \
+            ums_state_put((p_ums_completion_list_sl)->state);  \
+            (p_ums_completion_list_sl)->state = NULL; \
+        }   \
     }while(0)
 // -------------------------------------------------------------------
 
 // -------------------------------------------------------------------
 /**
- * @brief add a ums_completion_list item to the ums_completion_list
+ * @brief wake up the schedulers parked on the ums_completion_list, if any
  * 
- * @param p_ums_completion_list pointer to ums_context_list (ums_completion_list)
- * @param p_ums_completion_list_item pointer to the element to add
+ * @param p_ums_completion_list pointer to ums_completion_list_sl, it can be NULL
  * 
+ * NOTE: wq_has_sleeper() orders the update of the lists before the check of the wait queue
  */
-#define ums_completion_list_add_item(p_ums_completion_list, p_ums_completion_list_item) \
+#define ums_completion_list_wake_up_idle(p_ums_completion_list) \
     do{ \
-        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
-            list_add_tail(&((p_ums_completion_list_item)->list), &((p_ums_completion_list)->ums_context_list));  \
-        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+        if(likely((p_ums_completion_list) != NULL) && wq_has_sleeper(&((p_ums_completion_list)->idle_wait_queue)))    \
+            wake_up_interruptible(&((p_ums_completion_list)->idle_wait_queue));    \
     }while(0)
 
 /**
- * @brief remove a ums_completion_list item to the ums_completion_list
+ * @brief rewrite the state page of the ums_completion_list, if mapped
  * 
- * @param p_ums_completion_list pointer to ums_context_list (ums_completion_list)
- * @param p_ums_completion_list_item pointer to the element to remove
+ * @param p_ums_completion_list NON-NULL pointer to ums_completion_list_sl
  * 
+ * NOTE: This function assumes that spin_lock has been already called
  */
-#define ums_completion_list_remove_item(p_ums_completion_list, p_ums_completion_list_item) \
+#define ums_completion_list_state_update(p_ums_completion_list) \
     do{ \
-        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
-            list_del(&((p_ums_completion_list_item)->list));  \
-        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+        ums_state_list_t* __shared; \
+        ums_context_sl_t* __ucsl;   \
+        int __n = 0;    \
+        if((p_ums_completion_list)->state != NULL){ \
+            __shared = (p_ums_completion_list)->state->shared;  \
+            ums_state_write_begin(__shared);    \
+            list_for_each_entry(__ucsl, &((p_ums_completion_list)->ums_context_list), cl_list){  \
+                if(unlikely(__n == UMS_STATE_LIST_MAX)) \
+                    break;  \
+                ums_state_fill_context(&__shared->contexts[__n], __ucsl->ums_context);   \
+                __n++;  \
+            }   \
+            WRITE_ONCE(__shared->num, (p_ums_completion_list)->num); \
+            WRITE_ONCE(__shared->num_shown, __n);  \
+            ums_state_write_end(__shared);  \
+        }   \
     }while(0)
-// -------------------------------------------------------------------
 
-// -------------------------------------------------------------------
 /**
- * @brief get and lock the ums_completion_list
+ * @brief a ums_context_sl has been added or removed: the state page is rewritten
  * 
- * @param p_ums_completion_list_sl  pointer to ums_completion_list_sl
- * @param p_list_head pointer to the actual ums_completion_list
+ * @param p_ums_completion_list NON-NULL pointer to ums_completion_list_sl
  * 
+ * NOTE: This function assumes that spin_lock has been already called
  */
-#define ums_completion_list_sl_lock_get_list(p_ums_completion_list_sl, p_list_head)   \
+#define ums_completion_list_changed(p_ums_completion_list) \
     do{ \
-        spin_lock(&((p_ums_completion_list_sl)->ums_context_list_spin_lock));  \
-        p_list_head = &((p_ums_completion_list_sl)->ums_context_list);  \
+        ums_completion_list_state_update(p_ums_completion_list);   \
     }while(0)
+// -------------------------------------------------------------------
 
+// -------------------------------------------------------------------
 /**
- * @brief unlock the ums_completion_list
+ * @brief add a ums_context_sl to the ums_completion_list
+ * 
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to add
+ * @param p_res output, pointer to a bool, false if the ums_context_sl already belongs to a ums_completion_list
  * 
- * @param p_ums_completion_list_sl  pointer to ums_context_list_sl
- *   
  */
-#define ums_completion_list_sl_unlock_list(p_ums_completion_list_sl)    \
+#define ums_completion_list_add_ums_context_sl(p_ums_completion_list, p_ums_context_sl, p_res) \
     do{ \
-        spin_unlock(&((p_ums_completion_list_sl)->ums_context_list_spin_lock));  \
+        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+            *(p_res) = (READ_ONCE((p_ums_context_sl)->completion_list) == NULL);    \
+            if(likely(*(p_res))){   \
+                list_add_tail(&((p_ums_context_sl)->cl_list), &((p_ums_completion_list)->ums_context_list));  \
+                WRITE_ONCE((p_ums_context_sl)->completion_list, p_ums_completion_list);    \
+                (p_ums_completion_list)->num += 1;  \
+                ums_completion_list_changed(p_ums_completion_list);   \
+            }   \
+        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+        if(likely(*(p_res)))    \
+            ums_completion_list_wake_up_idle(p_ums_completion_list);    \
     }while(0)
-// ----------------------------------------------------------------------------
 
-// ----------------------------------------------------------------------------
 /**
- * @brief remove a ums_completion_list_item by the ums_context descriptor to which it refers to
+ * @brief add several ums_context_sl to the ums_completion_list, taking its spin_lock once, all or nothing
+ * 
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * @param array_ums_context_sl NON-NULL array of pointers to the ums_context_sl to add
+ * @param num_sl number of ums_context_sl
+ * @param p_res output, pointer to a bool, false if a ums_context_sl already belongs to a ums_completion_list
+ *              (or appears twice), in that case none is added
  * 
- * @param  p_ums_completion_list pointer to ums_completion_list_sl
- * @param ums_context_descriptor descriptor of the ums_context
- * @param p_ums_completion_list_item output, ums_completion_list_item removed
  */
-#define ums_completion_list_remove_item_by_descriptor(p_ums_completion_list, ums_context_descriptor, p_ums_completion_list_item) \
+#define ums_completion_list_add_ums_context_sl_batch(p_ums_completion_list, array_ums_context_sl, num_sl, p_res) \
     do{ \
-        struct list_head* current_item_list;    \
-        ums_completion_list_item_t* current_item;   \
-        \
+        int __i, __j;   \
         spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
-        list_for_each(current_item_list, &((p_ums_completion_list)->ums_context_list)){ \
-            current_item = list_entry(current_item_list, ums_completion_list_item_t, list); \
-            if(unlikely(current_item->ums_context_id == ums_context_descriptor)){   \
-                list_del(&((current_item)->list));  \
-                p_ums_completion_list_item = current_item; \
-                break;  \
+            for(__i = 0; __i < (num_sl); __i++){   \
+                if(unlikely(READ_ONCE((array_ums_context_sl)[__i]->completion_list) != NULL))    \
+                    break;  \
+                list_add_tail(&((array_ums_context_sl)[__i]->cl_list), &((p_ums_completion_list)->ums_context_list));  \
+                WRITE_ONCE((array_ums_context_sl)[__i]->completion_list, p_ums_completion_list);    \
+            }   \
+            *(p_res) = (__i == (num_sl));  \
+            for(__j = 0; unlikely(!*(p_res)) && __j < __i; __j++){    /* roll back */ \
+                list_del_init(&((array_ums_context_sl)[__j]->cl_list));  \
+                WRITE_ONCE((array_ums_context_sl)[__j]->completion_list, NULL);    \
+            }   \
+            if(likely(*(p_res))){   \
+                (p_ums_completion_list)->num += (num_sl);  \
+                ums_completion_list_changed(p_ums_completion_list);   \
             }   \
-        }   \
         spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+        if(likely(*(p_res)))    \
+            ums_completion_list_wake_up_idle(p_ums_completion_list);    \
     }while(0)
 
 /**
- * @brief without ue of spin_lock, remove a ums_completion_list_item by the ums_context descriptor to which it refers to
+ * @brief without use of spin_lock, remove a ums_context_sl from the ums_completion_list
  * 
- * @param  p_ums_completion_list pointer to ums_completion_list_sl
- * @param ums_context_descriptor descriptor of the ums_context
- * @param p_ums_completion_list_item output, ums_completion_list_item removed
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to remove
+ * @param p_res output, pointer to a bool, false if the ums_context_sl doesn't belong to this ums_completion_list
  * 
  * NOTE: This function assumes that spin_lock has been already called
  */
-#define ums_completion_list_remove_item_by_descriptor_no_sl(p_ums_completion_list, ums_context_descriptor, p_ums_completion_list_item) \
+#define ums_completion_list_remove_ums_context_sl_no_sl(p_ums_completion_list, p_ums_context_sl, p_res) \
     do{ \
-        struct list_head* current_item_list;    \
-        ums_completion_list_item_t* current_item;   \
-        \
-        list_for_each(current_item_list, &((p_ums_completion_list)->ums_context_list)){ \
-            current_item = list_entry(current_item_list, ums_completion_list_item_t, list); \
-            if(unlikely(current_item->ums_context_id == ums_context_descriptor)){   \
-                list_del(&((current_item)->list));  \
-                p_ums_completion_list_item = current_item; \
-                break;  \
-            }   \
+        *(p_res) = ((p_ums_context_sl)->completion_list == (p_ums_completion_list));    \
+        if(likely(*(p_res))){   \
+            list_del_init(&((p_ums_context_sl)->cl_list));  \
+            WRITE_ONCE((p_ums_context_sl)->completion_list, NULL);    \
+            (p_ums_completion_list)->num -= 1;  \
+            ums_completion_list_changed(p_ums_completion_list);   \
         }   \
     }while(0)
-// ------------------------------------------------------------------------------
 
-// --------------------------------------------------------------------------------
 /**
- * @brief remove first element from the ums_completion_list
+ * @brief remove a ums_context_sl from the ums_completion_list
  * 
  * @param p_ums_completion_list pointer to ums_completion_list_sl
- * @param p_ums_completion_list_item_OUT, output, removed element
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to remove
+ * @param p_res output, pointer to a bool, false if the ums_context_sl doesn't belong to this ums_completion_list
  * 
- * NOTE: If the list is empty, it return NULL
  */
-#define ums_completion_list_remove_first(p_ums_completion_list, p_ums_completion_list_item_OUT) \
+#define ums_completion_list_remove_ums_context_sl(p_ums_completion_list, p_ums_context_sl, p_res) \
     do{ \
         spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
-        p_ums_completion_list_item_OUT = list_first_entry_or_null(&(p_ums_completion_list)->ums_context_list, ums_completion_list_item_t, list);    \
-        if(likely((p_ums_completion_list_item_OUT) != NULL))   \
-            list_del(&((p_ums_completion_list_item_OUT)->list));  \
+            ums_completion_list_remove_ums_context_sl_no_sl(p_ums_completion_list, p_ums_context_sl, p_res);    \
         spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
     }while(0)
-// --------------------------------------------------------------------------------
 
-// ########################################################################################
 /**
- * @brief snprintf for a ums_completion_list_item
+ * @brief remove a ums_context_sl from the ums_completion_list that contains it, if any
  * 
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to remove
+ * 
+ * NOTE: the ums_completion_list must not be deleted concurrently
  */
-static inline int snprintf_ums_completion_list_item(char* buff, ssize_t size_buff, ums_completion_list_item_t* ums_completion_list_item){
-    return snprintf(buff, size_buff, "\t\t\t\t\tums_context_id=%d\n", ums_completion_list_item->ums_context_id);
-}
+#define ums_completion_list_detach_ums_context_sl(p_ums_context_sl) \
+    do{ \
+        struct ums_completion_list_sl_t* __cl = READ_ONCE((p_ums_context_sl)->completion_list);    \
+        bool __removed; \
+        if(__cl != NULL)    \
+            ums_completion_list_remove_ums_context_sl(__cl, p_ums_context_sl, &__removed);  \
+    }while(0)
 
 /**
- * @brief printK ums_completion_list_item
+ * @brief rewrite the state page of the ums_completion_list that contains a ums_context_sl, if any and mapped
+ * 
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl, its ums_context has been changed
  * 
+ * NOTE: the ums_completion_list must not be deleted concurrently
  */
-#define PRINTK_UMS_COMPLETION_LIST_ITEM(p_obj, PREFIX)   \
+#define ums_completion_list_state_update_of(p_ums_context_sl) \
     do{ \
-        char* __buff = kmalloc(512, GFP_KERNEL);    \
-        if( snprintf_ums_completion_list_item(__buff, 512, p_obj) > 512-4)   \
-            printk(KERN_DEBUG "\n PRINTK_UMS_COMPLETION_LIST_ITEM() overflow!!!\n");    \
-        else printk(PREFIX "ums_completion_list_item_t = \n{\n%s}\n", __buff); \
-        kfree(__buff);  \
+        struct ums_completion_list_sl_t* __cl = READ_ONCE((p_ums_context_sl)->completion_list);    \
+        if(__cl != NULL && READ_ONCE(__cl->state) != NULL){ \
+            spin_lock(&(__cl->ums_context_list_spin_lock));  \
+                if(likely((p_ums_context_sl)->completion_list == __cl))  \
+                    ums_completion_list_state_update(__cl);    \
+            spin_unlock(&(__cl->ums_context_list_spin_lock));  \
+        }   \
     }while(0)
 
-// --------------------------------------------------------------------------------------
+/**
+ * @brief remove all the ums_context_sl from the ums_completion_list, to be called before deleting it
+ * 
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * 
+ */
+#define ums_completion_list_remove_all(p_ums_completion_list) \
+    do{ \
+        ums_context_sl_t* __current, *__next;   \
+        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+            list_for_each_entry_safe(__current, __next, &((p_ums_completion_list)->ums_context_list), cl_list){  \
+                list_del_init(&__current->cl_list); \
+                WRITE_ONCE(__current->completion_list, NULL);   \
+            }   \
+            (p_ums_completion_list)->num = 0;   \
+            ums_completion_list_changed(p_ums_completion_list);   \
+        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+    }while(0)
+// -------------------------------------------------------------------
 
+// -------------------------------------------------------------------
+/**
+ * @brief claim a ums_context_sl seen in a snapshot of the ums_completion_list: it is acquired and removed atomically
+ * 
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to claim
+ * @param p_res output, pointer to an int: 0 on success, -ERR_STALE if it is no longer in this ums_completion_list,
+ *              -ERR_ASSIGNED if it is already assigned to a scheduler
+ * 
+ * NOTE: the spin_lock is held only for the claim, never across requests
+ */
+#define ums_completion_list_claim_ums_context_sl(p_ums_completion_list, p_ums_context_sl, p_res) \
+    do{ \
+        bool __acquired;    \
+        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+            if(unlikely((p_ums_context_sl)->completion_list != (p_ums_completion_list)))  \
+                *(p_res) = -ERR_STALE;  \
+            else{   \
+                ums_context_sl_try_to_acquire(p_ums_context_sl, &__acquired);  \
+                *(p_res) = likely(__acquired)? 0 : -ERR_ASSIGNED;   \
+                list_del_init(&((p_ums_context_sl)->cl_list));  \
+                WRITE_ONCE((p_ums_context_sl)->completion_list, NULL);    \
+                (p_ums_completion_list)->num -= 1;  \
+                ums_completion_list_changed(p_ums_completion_list);   \
+            }   \
+        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+    }while(0)
+// -------------------------------------------------------------------
 
+// -------------------------------------------------------------------
+/**
+ * @brief get and lock the ums_completion_list
+ * 
+ * @param p_ums_completion_list_sl  pointer to ums_completion_list_sl
+ * @param p_list_head pointer to the actual ums_completion_list
+ * 
+ */
+#define ums_completion_list_sl_lock_get_list(p_ums_completion_list_sl, p_list_head)   \
+    do{ \
+        spin_lock(&((p_ums_completion_list_sl)->ums_context_list_spin_lock));  \
+        p_list_head = &((p_ums_completion_list_sl)->ums_context_list);  \
+    }while(0)
+
+/**
+ * @brief unlock the ums_completion_list
+ * 
+ * @param p_ums_completion_list_sl  pointer to ums_context_list_sl
+ *   
+ */
+#define ums_completion_list_sl_unlock_list(p_ums_completion_list_sl)    \
+    do{ \
+        spin_unlock(&((p_ums_completion_list_sl)->ums_context_list_spin_lock));  \
+    }while(0)
+// ----------------------------------------------------------------------------
+
+// --------------------------------------------------------------------------------
+/**
+ * @brief remove first ums_context_sl from the ums_completion_list
+ * 
+ * @param p_ums_completion_list pointer to ums_completion_list_sl
+ * @param p_ums_context_sl_OUT, output, removed ums_context_sl
+ * 
+ * NOTE: If the list is empty, it return NULL
+ */
+#define ums_completion_list_remove_first(p_ums_completion_list, p_ums_context_sl_OUT) \
+    do{ \
+        spin_lock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+        p_ums_context_sl_OUT = list_first_entry_or_null(&(p_ums_completion_list)->ums_context_list, ums_context_sl_t, cl_list);    \
+        if(likely((p_ums_context_sl_OUT) != NULL)){   \
+            list_del_init(&((p_ums_context_sl_OUT)->cl_list));  \
+            WRITE_ONCE((p_ums_context_sl_OUT)->completion_list, NULL);    \
+            (p_ums_completion_list)->num -= 1;  \
+            ums_completion_list_changed(p_ums_completion_list);   \
+        }   \
+        spin_unlock(&((p_ums_completion_list)->ums_context_list_spin_lock));  \
+    }while(0)
+// --------------------------------------------------------------------------------
+
+// ########################################################################################
 // ------------------------------------------------------------------------------------------
 /**
  * @brief snprintf for ums_completion_list, print it as a list of IDs
  * 
  */
 static inline int snprintf_completion_list_as_ids(char* buff, ssize_t size_buff, struct list_head* list_of){
-    struct list_head* current_item_list;
-    ums_completion_list_item_t* current_item;
+    ums_context_sl_t* current_item;
     int offset = 0;
 
     if(unlikely(list_empty(list_of))){
         offset += snprintf(buff+offset, size_buff-offset, "%s", "-");
     }
     else{
-        list_for_each(current_item_list, list_of){
-            current_item = list_entry(current_item_list, ums_completion_list_item_t, list);
-            //printk("id=%d\n", current_item->ums_context_id);
+        list_for_each_entry(current_item, list_of, cl_list){
             if(unlikely(offset)==0)
-                offset += snprintf(buff+offset, size_buff-offset, "%d", current_item->ums_context_id);
+                offset += snprintf(buff+offset, size_buff-offset, "%d", current_item->id);
             else
-                offset += snprintf(buff+offset, size_buff-offset, ",%d", current_item->ums_context_id);
+                offset += snprintf(buff+offset, size_buff-offset, ",%d", current_item->id);
         }
     }
     return offset;
@@ -275,17 +391,13 @@ static inline int snprintf_completion_list_as_ids(char* buff, ssize_t size_buff,
  * 
  */
 static inline int snprintf_ums_completion_list_sl(char* buff, ssize_t size_buff, ums_completion_list_sl_t* ums_completion_list_sl){
-    struct list_head* current_item_list;
-    ums_completion_list_item_t* current_item;
+    ums_context_sl_t* current_item;
     int offset = 0;
     offset += snprintf(buff+offset, size_buff-offset, "\t\t\tid=%d\n", ums_completion_list_sl->id);
     offset += snprintf(buff+offset, size_buff-offset, "\t\t\tums_context_list=\n\t\t\t{\n");
     if(spin_trylock(&ums_completion_list_sl->ums_context_list_spin_lock)){
-        list_for_each(current_item_list, &ums_completion_list_sl->ums_context_list){
-            current_item = list_entry(current_item_list, ums_completion_list_item_t, list);
-            offset += snprintf(buff+offset, size_buff-offset, "\t\t\t\tums_completion_list_item=\n""\t\t\t\t{\n");
-            offset += snprintf_ums_completion_list_item(buff+offset, size_buff-offset, current_item);
-            offset += snprintf(buff+offset, size_buff-offset, "\t\t\t\t}\n");
+        list_for_each_entry(current_item, &ums_completion_list_sl->ums_context_list, cl_list){
+            offset += snprintf(buff+offset, size_buff-offset, "\t\t\t\tums_context_id=%d\n", current_item->id);
         }
         spin_unlock(&ums_completion_list_sl->ums_context_list_spin_lock);
     }
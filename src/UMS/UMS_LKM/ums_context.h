@@ -14,16 +14,26 @@
 #include <stdbool.h>
 #include <linux/list.h>
 #include <linux/rwlock.h>
+#include <linux/rcupdate.h>
+#include <linux/rhashtable.h>
 
 #include "../common/ums_types.h"
+#include "ums_blocked.h"
+#include "ums_preemption.h"
 
 #include <linux/proc_fs.h>
 #include <linux/jiffies.h>
+#include <linux/timekeeping.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/preempt.h>
+#include <linux/irq_work.h>
 
 
 #define UMS_THREAD_STATE_IDLE       0
 #define UMS_THREAD_STATE_RUNNING    1
 #define UMS_THREAD_STATE_ENDED      2
+#define UMS_THREAD_STATE_BLOCKED    3
 // ums_context_t ########################################################################################
 /**
  * @brief Represents a ums_context
@@ -31,26 +41,108 @@
  */
 typedef struct ums_context_t{
     struct list_head list; /** used to arrange ums_context in ready_list */
-    struct hlist_node hlist; /** used by the hashtable of ums_threads, used to map thread's pid to the ums_context_descriptor*/
+    struct list_head prio_list; /** used to arrange ums_context in the ready_queue of its priority, empty if not ready */
+    struct rhash_head rhnode; /** used by the rhashtable of ums_threads, used to map thread's pid to the ums_context_descriptor*/
+    struct rcu_head rcu; /** used to free it after a grace period */
     
     pid_t pid;  /** thread's pid used*/
     int id; /** descriptor */
     void* task_struct;  /** pointer to task_struct of thread used */
     pid_t pid_scheduler;    /** pid of the scheduler that manage the ums_context */
+    void* scheduler_task_struct;    /** task_struct of the scheduler that manage the ums_context */
 
-    struct proc_dir_entry* proc_entry; /** entry in /proc associated to this ums_context*/
     int num_switch; /** number of switches from running to idle and viceversa */
     int state; /** state of the ums_context: UMS_THREAD_STATE_IDLE, UMS_THREAD_STATE_RUNNING, UMS_THREAD_STATE_ENDED*/
+    int prio;   /** priority, from UMS_PRIO_HIGHEST to UMS_PRIO_LOWEST. Protected by the spin_lock of its scheduler, if any */
   
     void* (*routine)(void* args);   /** routine of the user */
     void* args; /** args of user's routine */
 
     void* user_reserved; /** user can use it as he wants, (e.g. store some characteristics of the ums_context:  CPU or I/O BURST, and prio ) */
 
-    u64 start_time_last_slot; /** uses jiffies */
-    u64 ums_run_time;   /** uses jiffies */
+    u64 start_time_last_slot; /** ns (ktime_get_ns), beginning of the current running slot */
+    u64 on_cpu_since;   /** ns (ktime_get_ns), when the thread got a CPU in the current running slot, 0 if it is not on a CPU.
+                            Without preempt notifiers, sum_exec_runtime of the thread at the beginning of the slot */
+    u64 ums_run_time;   /** ns, wall-clock time spent running, including time blocked or preempted by other tasks */
+    u64 ums_cpu_time;   /** ns, time actually spent on a CPU while running */
+    u64 ready_since;    /** ns (ktime_get_ns), when it has been added to the ready_list */
+    u64 ums_ready_wait_time;    /** ns, time spent in the ready_list */
+    u64 handoff_start_ns;   /** ns (ktime_get_ns), when a scheduler woke it up from the ready_list, 0 if none */
+
+    bool preempt_pending;   /** UMS_PARK_SIGNAL has been sent at the end of the quantum, the thread has not yet parked */
+    unsigned int preempted_seq; /** quantum_seq of the scheduler when UMS_PARK_SIGNAL has been sent */
+
+    bool blocked;   /** the thread slept in the kernel while running, set until its scheduler is notified */
+    bool unblocked; /** the thread woke up before its scheduler has been notified. Protected by the spin_lock of its scheduler */
+    bool unblock_pending;   /** the thread woke up after blocking and has not yet parked in the ready_list */
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+    struct preempt_notifier preempt_notifier;   /** detects when the thread blocks and wakes up */
+    struct irq_work blocked_work;   /** wakes up the scheduler, it cannot be done in the preempt_notifier */
+    struct irq_work unblocked_work; /** sends UMS_PARK_SIGNAL to the thread, it cannot be done in the preempt_notifier */
+    struct task_struct* notify_task;    /** thread that registered preempt_notifier (a reference is held), NULL if none */
+#endif
 }ums_context_t;
 
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+
+/**
+ * @brief init the fields used to notify the scheduler when the thread blocks
+ * 
+ * @param p_ums_context pointer to a NON-NULL ums_context
+ */
+#define INIT_UMS_CONTEXT_BLOCKED_NOTIFY(p_ums_context)  \
+    do{ \
+        init_irq_work(&(p_ums_context)->blocked_work, ums_context_blocked_work);    \
+        init_irq_work(&(p_ums_context)->unblocked_work, ums_context_unblocked_work);    \
+        (p_ums_context)->notify_task = NULL;    \
+    }while(0)
+
+/**
+ * @brief start to notify the scheduler when the thread blocks, to be called by the thread used
+ * 
+ * @param p_ums_context pointer to a NON-NULL ums_context, registered as current
+ */
+#define ums_context_register_blocked_notify(p_ums_context)  \
+    do{ \
+        get_task_struct(current);   \
+        (p_ums_context)->notify_task = current; \
+        preempt_notifier_init(&(p_ums_context)->preempt_notifier, &ums_context_preempt_ops);   \
+        preempt_notifier_register(&(p_ums_context)->preempt_notifier);  \
+    }while(0)
+
+/**
+ * @brief stop to notify the scheduler when the thread blocks, to be called by the thread used
+ * 
+ * @param p_ums_context pointer to a NON-NULL ums_context, registered as current
+ * 
+ * NOTE: the other threads use ums_context_detach_blocked_notify()
+ */
+#define ums_context_unregister_blocked_notify(p_ums_context)  \
+    do{ \
+        if(likely((p_ums_context)->notify_task != NULL)){   \
+            preempt_notifier_unregister(&(p_ums_context)->preempt_notifier);    \
+            put_task_struct((p_ums_context)->notify_task);  \
+            (p_ums_context)->notify_task = NULL;    \
+        }   \
+    }while(0)
+
+/**
+ * @brief wait the end of a pending wake up of the scheduler or of the thread, to be called before freeing the ums_context
+ * 
+ * @param p_ums_context pointer to a NON-NULL ums_context
+ */
+#define ums_context_sync_blocked_notify(p_ums_context)  \
+    do{ \
+        irq_work_sync(&(p_ums_context)->blocked_work);  \
+        irq_work_sync(&(p_ums_context)->unblocked_work);    \
+    }while(0)
+#else
+#define INIT_UMS_CONTEXT_BLOCKED_NOTIFY(p_ums_context)  do{}while(0)
+#define ums_context_register_blocked_notify(p_ums_context)  do{}while(0)
+#define ums_context_unregister_blocked_notify(p_ums_context)  do{}while(0)
+#define ums_context_sync_blocked_notify(p_ums_context)  do{}while(0)
+#endif
+
 // -------------------------------------------------------------------
 /**
  * @brief ums_context's constructor
@@ -64,13 +156,27 @@ typedef struct ums_context_t{
     do{ \
         (p_ums_context)->id = -1;    \
         (p_ums_context)->task_struct = NULL;    \
+        (p_ums_context)->pid_scheduler = 0; \
+        INIT_LIST_HEAD(&(p_ums_context)->prio_list);    \
+        (p_ums_context)->prio = UMS_PRIO_DEFAULT;   \
         (p_ums_context)->routine = p_routine;   \
         (p_ums_context)->args = p_args; \
-        (p_ums_context)->proc_entry = NULL; \
         (p_ums_context)->num_switch = 0; \
         (p_ums_context)->state = UMS_THREAD_STATE_IDLE; \
         (p_ums_context)->ums_run_time = 0; \
         (p_ums_context)->start_time_last_slot = 0; \
+        (p_ums_context)->on_cpu_since = 0; \
+        (p_ums_context)->ums_cpu_time = 0; \
+        (p_ums_context)->ready_since = 0; \
+        (p_ums_context)->handoff_start_ns = 0; \
+        (p_ums_context)->ums_ready_wait_time = 0; \
+        (p_ums_context)->scheduler_task_struct = NULL; \
+        (p_ums_context)->preempt_pending = false; \
+        (p_ums_context)->preempted_seq = 0; \
+        (p_ums_context)->blocked = false; \
+        (p_ums_context)->unblocked = false; \
+        (p_ums_context)->unblock_pending = false; \
+        INIT_UMS_CONTEXT_BLOCKED_NOTIFY(p_ums_context); \
     }while(0)
 
 /**
@@ -83,13 +189,19 @@ typedef struct ums_context_t{
     do{ \
         (p_ums_context)->id = -1;    \
         (p_ums_context)->task_struct = NULL;    \
+        (p_ums_context)->pid_scheduler = 0; \
+        (p_ums_context)->prio = UMS_PRIO_DEFAULT;   \
         (p_ums_context)->routine = NULL;   \
         (p_ums_context)->args = NULL; \
-        (p_ums_context)->proc_entry = NULL; \
         (p_ums_context)->num_switch = 0; \
         (p_ums_context)->state = UMS_THREAD_STATE_IDLE; \
         (p_ums_context)->ums_run_time = 0; \
         (p_ums_context)->start_time_last_slot = 0; \
+        (p_ums_context)->on_cpu_since = 0; \
+        (p_ums_context)->ums_cpu_time = 0; \
+        (p_ums_context)->ready_since = 0; \
+        (p_ums_context)->handoff_start_ns = 0; \
+        (p_ums_context)->ums_ready_wait_time = 0; \
     }while(0)
 // --------------------------------------------------------
 
@@ -99,13 +211,15 @@ typedef struct ums_context_t{
  * @param p_ums_context pointer to a NON-NULL ums_context
  * @param p_task_struct pointer to thread's task_struct
  * @param pid_sched pid of the scheduler that manages the ums_context
+ * @param p_sched_task_struct pointer to the task_struct of the scheduler that manages the ums_context
  * 
  */
-#define ums_context_register_as_thread(p_ums_context, p_task_struct, pid_sched) \
+#define ums_context_register_as_thread(p_ums_context, p_task_struct, pid_sched, p_sched_task_struct) \
     do{ \
         (p_ums_context)->task_struct = p_task_struct;   \
         (p_ums_context)->pid = (p_task_struct)->pid;    \
         (p_ums_context)->pid_scheduler = pid_sched; \
+        WRITE_ONCE((p_ums_context)->scheduler_task_struct, p_sched_task_struct); \
     }while(0)
 
 /**
@@ -118,6 +232,26 @@ typedef struct ums_context_t{
         (p_ums_context)->task_struct = NULL;   \
         (p_ums_context)->pid = 0;    \
         (p_ums_context)->pid_scheduler = 0; \
+        WRITE_ONCE((p_ums_context)->scheduler_task_struct, NULL); \
+    }while(0)
+
+/**
+ * @brief the thread of a ums_context idle in a ready_list sleeps until a scheduler executes it
+ * 
+ * To be called by the thread itself. A thread woken up by UMS_PARK_SIGNAL while it was parked (e.g. in rq_yield_ums_context())
+ * goes back to sleep here, from the handler of the signal. Another pending signal wakes it up
+ * 
+ * @param p_ums_context pointer to a NON-NULL ums_context, registered as current
+ */
+#define ums_context_wait_running(p_ums_context)    \
+    do{ \
+        for(;;){    \
+            set_current_state(TASK_INTERRUPTIBLE);  \
+            if(READ_ONCE((p_ums_context)->state) != UMS_THREAD_STATE_IDLE || signal_pending(current))  \
+                break;  \
+            schedule(); \
+        }   \
+        __set_current_state(TASK_RUNNING);  \
     }while(0)
 
 static inline char* _ums_context_printable_state(ums_context_t* uc){
@@ -131,6 +265,9 @@ static inline char* _ums_context_printable_state(ums_context_t* uc){
         case UMS_THREAD_STATE_IDLE:
             return "idle";
         break;
+        case UMS_THREAD_STATE_BLOCKED:
+            return "blocked";
+        break;
 
         default:
             return "unknown";
@@ -148,22 +285,36 @@ static inline char* _ums_context_printable_state(ums_context_t* uc){
 #define ums_context_printable_state(p_ums_context)  \
     _ums_context_printable_state(p_ums_context)
 
+/**
+ * @brief check if a priority is valid
+ * 
+ * @param prio_in priority to check
+ */
+#define ums_context_valid_prio(prio_in) \
+    ((prio_in) >= UMS_PRIO_HIGHEST && (prio_in) <= UMS_PRIO_LOWEST)
+
 // -------------------------------------------------------------------
 // ######################################################################################################
 
 
 // ums_context_sl_t ########################################################################################
+struct ums_completion_list_sl_t;
+
 /**
  * @brief ums_context_SpinLock is used to protect a ums_context between several ums_schedulers
  * 
  */
 typedef struct ums_context_sl_t{
     int id; /** descriptor, the same of the ums_context managed*/
+    struct rcu_head rcu; /** used to free it after a grace period */
     
     bool assigned; /** (IN USE) indicates the managed ums_context has been already assigned to another scheduler*/
     spinlock_t assigned_spin_lock; /** used to protect "assigned" field */
     
     ums_context_t* ums_context; /** pointer to the ums_context managed*/
+
+    struct list_head cl_list; /** used to arrange it in a ums_completion_list */
+    struct ums_completion_list_sl_t* completion_list; /** ums_completion_list that contains it, NULL if none. Protected by the spin_lock of that list */
 }ums_context_sl_t;
 
 // -------------------------------------------------------------------
@@ -181,6 +332,9 @@ typedef struct ums_context_sl_t{
         spin_lock_init(&(p_ums_context_sl)->assigned_spin_lock);  \
         \
         (p_ums_context_sl)->ums_context = p_ums_context_in;   \
+        \
+        INIT_LIST_HEAD(&(p_ums_context_sl)->cl_list);  \
+        (p_ums_context_sl)->completion_list = NULL;   \
     }while(0)
 
 /**
@@ -195,6 +349,7 @@ typedef struct ums_context_sl_t{
         (p_ums_context_sl)->assigned = false;   \
         \
         (p_ums_context_sl)->ums_context = NULL;   \
+        (p_ums_context_sl)->completion_list = NULL;   \
     }while(0)
 // -------------------------------------------------------------------
 
@@ -249,28 +404,142 @@ typedef struct ums_context_sl_t{
 
 
 // ---------------------------------------------------------------------
+#ifdef CONFIG_PREEMPT_NOTIFIERS
+/**
+ * @brief the thread of a running ums_context got a CPU, to be called by the thread or by its sched_in
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ * 
+ * NOTE: only during a running slot, while the thread has not been reported as blocked
+ */
+#define ums_context_cpu_time_start(p_ums_context)  \
+    do{ \
+        if(READ_ONCE((p_ums_context)->state) == UMS_THREAD_STATE_RUNNING && !READ_ONCE((p_ums_context)->blocked) &&  \
+            READ_ONCE((p_ums_context)->start_time_last_slot) != 0 && READ_ONCE((p_ums_context)->on_cpu_since) == 0)  \
+            WRITE_ONCE((p_ums_context)->on_cpu_since, ktime_get_ns());  \
+    }while(0)
+
 /**
- * @brief update "ums_run_time" field of the ums_context 
+ * @brief the thread of a ums_context leaves the CPU or its running slot ends, the time since
+ * ums_context_cpu_time_start() is added to "ums_cpu_time"
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ */
+#define ums_context_cpu_time_stop(p_ums_context)  \
+    do{ \
+        u64 __since = READ_ONCE((p_ums_context)->on_cpu_since);  \
+        if(__since != 0){   \
+            u64 __now = ktime_get_ns();   \
+            if(likely(__now > __since)) \
+                WRITE_ONCE((p_ums_context)->ums_cpu_time, (p_ums_context)->ums_cpu_time + (__now - __since));  \
+            WRITE_ONCE((p_ums_context)->on_cpu_since, 0);  \
+        }   \
+    }while(0)
+
+/**
+ * @brief the thread of a ums_context runs again after schedule(), to be called by the thread
+ * 
+ * If it has been executed before it left the CPU, there is no sched_in
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ */
+#define ums_context_update_run_time_resume(p_ums_context)  \
+    do{ \
+        preempt_disable();  \
+        ums_context_cpu_time_start(p_ums_context);  \
+        preempt_enable();   \
+    }while(0)
+
+/**
+ * @brief update "ums_run_time" and "ums_cpu_time" fields of the ums_context 
+ * To be called at the beginning of the slot
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ * 
+ * NOTE: the on-CPU time is accumulated by the preempt_notifier of the thread (sched_in/sched_out), in ns
+ */
+#define ums_context_update_run_time_start_slot(p_ums_context)  \
+    do{ \
+        u64 __now = ktime_get_ns();   \
+        WRITE_ONCE((p_ums_context)->start_time_last_slot, __now);    \
+        WRITE_ONCE((p_ums_context)->on_cpu_since, ((p_ums_context)->task_struct == current)? __now : 0);    \
+    }while(0)
+
+/**
+ * @brief update "ums_run_time" and "ums_cpu_time" fields of the ums_context 
+ * To be called at the end of the slot
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ */
+#define ums_context_update_run_time_end_slot(p_ums_context)  \
+    do{ \
+        (p_ums_context)->ums_run_time += ktime_get_ns()-(p_ums_context)->start_time_last_slot; \
+        ums_context_cpu_time_stop(p_ums_context);   \
+        WRITE_ONCE((p_ums_context)->start_time_last_slot, 0); \
+    }while(0)
+#else
+/**
+ * @brief CPU time consumed by the thread of the ums_context, in ns
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ * 
+ * NOTE: sum_exec_runtime of a thread in execution is updated at each tick, of a sleeping thread it is exact
+ */
+#define ums_context_exec_runtime(p_ums_context)  \
+    (((p_ums_context)->task_struct != NULL)? READ_ONCE(((struct task_struct*)(p_ums_context)->task_struct)->se.sum_exec_runtime) : 0)
+
+#define ums_context_update_run_time_resume(p_ums_context)  do{}while(0)
+
+/**
+ * @brief update "ums_run_time" and "ums_cpu_time" fields of the ums_context 
  * To be called at the beginning of the slot
  * 
  * @param p_ums_context NON-NULL pointer to ums_context
  */
 #define ums_context_update_run_time_start_slot(p_ums_context)  \
     do{ \
-        (p_ums_context)->start_time_last_slot = get_jiffies_64();    \
+        (p_ums_context)->start_time_last_slot = ktime_get_ns();    \
+        (p_ums_context)->on_cpu_since = ums_context_exec_runtime(p_ums_context);    \
     }while(0)
 
 /**
- * @brief update "ums_run_time" field of the ums_context 
+ * @brief update "ums_run_time" and "ums_cpu_time" fields of the ums_context 
  * To be called at the end of the slot
  * 
  * @param p_ums_context NON-NULL pointer to ums_context
  */
 #define ums_context_update_run_time_end_slot(p_ums_context)  \
     do{ \
-        u64 time_now = get_jiffies_64();    \
+        u64 time_now = ktime_get_ns();    \
+        u64 exec_runtime_now = ums_context_exec_runtime(p_ums_context);    \
         (p_ums_context)->ums_run_time += time_now-(p_ums_context)->start_time_last_slot; \
+        if(likely((p_ums_context)->on_cpu_since != 0 && exec_runtime_now > (p_ums_context)->on_cpu_since))   \
+            (p_ums_context)->ums_cpu_time += exec_runtime_now-(p_ums_context)->on_cpu_since;   \
         (p_ums_context)->start_time_last_slot = 0; \
+        (p_ums_context)->on_cpu_since = 0; \
+    }while(0)
+#endif
+
+/**
+ * @brief update "ums_ready_wait_time" field of the ums_context, to be called when it is added to a ready_list
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ */
+#define ums_context_update_ready_wait_start(p_ums_context)  \
+    do{ \
+        (p_ums_context)->ready_since = ktime_get_ns();    \
+    }while(0)
+
+/**
+ * @brief update "ums_ready_wait_time" field of the ums_context, to be called when it is removed from a ready_list
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ */
+#define ums_context_update_ready_wait_end(p_ums_context)  \
+    do{ \
+        if(likely((p_ums_context)->ready_since != 0))   \
+            (p_ums_context)->ums_ready_wait_time += ktime_get_ns()-(p_ums_context)->ready_since;    \
+        (p_ums_context)->ready_since = 0;    \
     }while(0)
 // ---------------------------------------------------------------------
 
@@ -284,7 +553,27 @@ typedef struct ums_context_sl_t{
  * 
  */
 #define ums_context_get_run_time_ms(p_ums_context)  \
-    jiffies_to_msecs((p_ums_context)->ums_run_time)
+    ((unsigned int)div_u64((p_ums_context)->ums_run_time, NSEC_PER_MSEC))
+
+/**
+ * @brief fill the info_ums_context_t given to the user
+ * 
+ * @param p_ums_context NON-NULL pointer to ums_context
+ * @param p_info NON-NULL pointer to info_ums_context_t
+ * @param from_cl_in true if the ums_context comes from the ums_completion_list
+ */
+#define ums_context_fill_info(p_ums_context, p_info, from_cl_in) \
+    do{ \
+        (p_info)->ucd = (p_ums_context)->id;    \
+        (p_info)->number_switch = (p_ums_context)->num_switch;  \
+        (p_info)->run_time_ms = ums_context_get_run_time_ms(p_ums_context); \
+        (p_info)->user_reserved = (p_ums_context)->user_reserved;   \
+        (p_info)->from_cl = from_cl_in; \
+        (p_info)->prio = (p_ums_context)->prio; \
+        (p_info)->run_time_ns = (p_ums_context)->ums_run_time;  \
+        (p_info)->cpu_time_ns = (p_ums_context)->ums_cpu_time;  \
+        (p_info)->ready_wait_ns = (p_ums_context)->ums_ready_wait_time;  \
+    }while(0)
 // --------------------------------------------------------------------
 // ######################################################################################################
 
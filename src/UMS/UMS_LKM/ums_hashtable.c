@@ -19,7 +19,7 @@
 
 DEFINE_HASHTABLE(ums_hashtable, UMS_HASHTABLE_HASH_BITS);
 
-rwlock_t ums_hashtable_rwlock = __RW_LOCK_UNLOCKED(ums_hashtable_rwlock);
+DEFINE_SPINLOCK(ums_hashtable_lock);
 
 
 
@@ -39,12 +39,6 @@ ums_context_sl_t* ums_context_sl_2;
 ums_context_sl_t* ums_context_sl_3;
 ums_context_sl_t* ums_context_sl_4;
 
-ums_completion_list_item_t* ums_completion_list_item_0;
-ums_completion_list_item_t* ums_completion_list_item_1;
-ums_completion_list_item_t* ums_completion_list_item_2;
-ums_completion_list_item_t* ums_completion_list_item_3;
-ums_completion_list_item_t* ums_completion_list_item_4;
-ums_completion_list_item_t* ums_completion_list_item_5;
 
 ums_completion_list_sl_t* ums_completion_list_sl_0;
 ums_completion_list_sl_t* ums_completion_list_sl_1;
@@ -61,7 +55,7 @@ void init_test(void);
 void end_test(void);
 
 int test(void){
-    //    ums_completion_list_item_t* item;
+    //    ums_context_sl_t* item;
     ums_context_t* context;
     int i;
     init_test();
@@ -76,7 +70,7 @@ int test(void){
    // PRINTK_UMS_HASHTABLE(KERN_DEBUG);
     
     //ums_scheduler_completion_list_start_iteration(ums_scheduler_0, item);
-    //PRINTK_UMS_COMPLETION_LIST_ITEM(item, KERN_DEBUG);
+    //PRINTK_UMS_CONTEXT_SL(item, KERN_DEBUG);
     ums_scheduler_ready_list_add(ums_scheduler_0, ums_context_0);
     ums_scheduler_ready_list_add(ums_scheduler_0, ums_context_1);
     ums_scheduler_ready_list_add(ums_scheduler_0, ums_context_2);
@@ -93,7 +87,7 @@ int test(void){
         if(!context) break;
                 PRINTK_UMS_SCHEDULER(ums_scheduler_0, KERN_DEBUG);
 
-        //PRINTK_UMS_COMPLETION_LIST_ITEM(item, KERN_DEBUG);
+        //PRINTK_UMS_CONTEXT_SL(item, KERN_DEBUG);
         //PRINTK_UMS_HASHTABLE(KERN_DEBUG);
         //PRINTK_UMS_CONTEXT(context, KERN_DEBUG);
     }
@@ -113,6 +107,8 @@ int test(void){
 
 
 void init_test(void){
+    int i;
+    bool added;
     ums_context_0 = kmalloc(sizeof(ums_context_t), GFP_KERNEL);
     INIT_UMS_CONTEXT(ums_context_0, &routine_example, &args_test);
     ums_context_sl_0 = kmalloc(sizeof(ums_context_sl_t), GFP_KERNEL);
@@ -140,33 +136,17 @@ void init_test(void){
 
 
 
-    ums_completion_list_item_0 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_0, 0);
-    ums_completion_list_item_1 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_1, 1);
-    ums_completion_list_item_2 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_2, 2);
-
-    ums_completion_list_item_3 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_3, 0);
-    ums_completion_list_item_4 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_4, 3);
-    ums_completion_list_item_5 = kmalloc(sizeof(ums_completion_list_item_t), GFP_KERNEL);
-    INIT_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_5, 4);
-
-
     ums_completion_list_sl_0 =  kmalloc(sizeof(ums_completion_list_sl_t), GFP_KERNEL);
     INIT_UMS_COMPLETION_LIST_SL(ums_completion_list_sl_0);
-    ums_completion_list_add_item(ums_completion_list_sl_0, ums_completion_list_item_0);
-    ums_completion_list_add_item(ums_completion_list_sl_0, ums_completion_list_item_1);
-    ums_completion_list_add_item(ums_completion_list_sl_0, ums_completion_list_item_2);
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl_0, ums_context_sl_0, &added);
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl_0, ums_context_sl_1, &added);
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl_0, ums_context_sl_2, &added);
 
 
     ums_completion_list_sl_1 =  kmalloc(sizeof(ums_completion_list_sl_t), GFP_KERNEL);
     INIT_UMS_COMPLETION_LIST_SL(ums_completion_list_sl_1);
-    ums_completion_list_add_item(ums_completion_list_sl_1, ums_completion_list_item_3);
-    ums_completion_list_add_item(ums_completion_list_sl_1, ums_completion_list_item_4);
-    ums_completion_list_add_item(ums_completion_list_sl_1, ums_completion_list_item_5);
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl_1, ums_context_sl_3, &added);
+    ums_completion_list_add_ums_context_sl(ums_completion_list_sl_1, ums_context_sl_4, &added);
 
 
 
@@ -182,7 +162,7 @@ void init_test(void){
 
 
     ums_process = kmalloc(sizeof(ums_process_t), GFP_KERNEL);
-    INIT_UMS_PROCESS(ums_process, 1234);
+    INIT_UMS_PROCESS(ums_process, 1234, i);
 
     ums_process_add_scheduler_sl(ums_process, ums_scheduler_sl_0);
     ums_process_add_scheduler_sl(ums_process, ums_scheduler_sl_1);
@@ -232,24 +212,6 @@ void end_test(void){
     DESTROY_UMS_CONTEXT_SL(ums_context_sl_4);
     kfree(ums_context_sl_4);
     //###############################
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_0);
-    kfree(ums_completion_list_item_0);
-    
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_1);
-    kfree(ums_completion_list_item_1);
-
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_2);
-    kfree(ums_completion_list_item_2);
-    
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_3);
-    kfree(ums_completion_list_item_3);
-
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_4);
-    kfree(ums_completion_list_item_4);
-
-    DESTROY_UMS_COMPLETION_LIST_ITEM(ums_completion_list_item_5);
-    kfree(ums_completion_list_item_5);
-    //################################
     DESTROY_UMS_COMPLETION_LIST_SL(ums_completion_list_sl_0);
     kfree(ums_completion_list_sl_0);
 
@@ -34,6 +34,8 @@
 
 #include "ums_process.h"
 
+#include "ums_cache.h"
+
 
 
 
@@ -42,7 +44,7 @@
 #define UMS_HASHTABLE_HASH_BITS 10 /** size of hashtable = 2^HASH_BITS */
 
 extern DECLARE_HASHTABLE(ums_hashtable, UMS_HASHTABLE_HASH_BITS);
-extern rwlock_t ums_hashtable_rwlock;
+extern spinlock_t ums_hashtable_lock;  /** serializes writers, readers use RCU */
 
 /** init ums_hashtable */
 #define UMS_HASHTABLE_INIT()   hash_init(ums_hashtable);  
@@ -56,9 +58,9 @@ extern rwlock_t ums_hashtable_rwlock;
  * NOTE: The key will be (p_ums_process)->key
  */
 #define ums_hashtable_add_process(p_ums_process)    \
-    write_lock(&ums_hashtable_rwlock);  \
-	    hash_add(ums_hashtable, &((p_ums_process)->hlist), (p_ums_process)->key);   \
-	write_unlock(&ums_hashtable_rwlock);    \
+    spin_lock(&ums_hashtable_lock);  \
+	    hash_add_rcu(ums_hashtable, &((p_ums_process)->hlist), (p_ums_process)->key);   \
+	spin_unlock(&ums_hashtable_lock);    \
 
 /**
  * @brief remove a ums_process from the ums_hashtable
@@ -66,9 +68,9 @@ extern rwlock_t ums_hashtable_rwlock;
  * @param p_ums_process NON-NULL pointer to a ums_process
  */
 #define ums_hashtable_remove_process(p_ums_process)    \
-    write_lock(&ums_hashtable_rwlock);  \
-	    hash_del(&((p_ums_process)->hlist));   \
-	write_unlock(&ums_hashtable_rwlock);    \
+    spin_lock(&ums_hashtable_lock);  \
+	    hash_del_rcu(&((p_ums_process)->hlist));   \
+	spin_unlock(&ums_hashtable_lock);    \
 // -------------------------------------------------------------------
 
 
@@ -78,18 +80,18 @@ extern rwlock_t ums_hashtable_rwlock;
  * 
  * @param tgid ums_process's tgid (key in the hashtable)
  * @param p_ums_process output, pointer to a ums_process
+ * 
+ * NOTE: the lookup is lockless, the caller must hold rcu_read_lock() while it uses the ums_process:
+ * it is freed after a grace period
  */
 #define ums_hashtable_get_process(tgid, p_ums_process)    \
     do{ \
     ums_process_t* current_ums_process = NULL;  \
-	read_lock(&ums_hashtable_rwlock);   \
         /*iterate a bucket*/    \
-        hash_for_each_possible(ums_hashtable, current_ums_process, hlist, tgid){    \
+        hash_for_each_possible_rcu(ums_hashtable, current_ums_process, hlist, tgid){    \
             if(likely(current_ums_process && current_ums_process->key == tgid))    break;\
         }   \
-    read_unlock(&ums_hashtable_rwlock); \
-    \
-    p_ums_process = (likely(current_ums_process && current_ums_process->key == tgid)) ? current_ums_process : NULL; \
+        p_ums_process = (likely(current_ums_process && current_ums_process->key == tgid)) ? current_ums_process : NULL; \
     }while(0)
 
 
@@ -99,18 +101,59 @@ extern rwlock_t ums_hashtable_rwlock;
 /**
  * @brief create a new ums_process and add it to the ums_hashtable
  * @param tgid ums_process's tgid, namely the tgid of the actual Linux process
+ * @param p_ums_process_OUT output, pointer to the new ums_process, NULL on failure
+ * @param res_OUT output, 0 on success, -EBUSY if the tgid has already a ums_process, otherwise -errno (e.g. -ENOMEM)
+ * 
+ */
+#define ums_hashtable_create_process(tgid, p_ums_process_OUT, res_OUT)  \
+    do{ \
+        ums_process_t* current_ums_process = NULL;  \
+        ums_process_t* item = ums_cache_alloc(UMS_CACHE_PROCESS);   \
+        p_ums_process_OUT = NULL;   \
+        res_OUT = -ENOMEM;  \
+        if(unlikely(item == NULL))  break;  \
+        INIT_UMS_PROCESS(item, tgid, res_OUT);   \
+        if(unlikely(res_OUT != 0)){   \
+            ums_cache_free(UMS_CACHE_PROCESS, item);    \
+            break;  \
+        }   \
+        \
+        spin_lock(&ums_hashtable_lock);  \
+            hash_for_each_possible(ums_hashtable, current_ums_process, hlist, tgid){    \
+                if(unlikely(current_ums_process->key == tgid))    break;\
+            }   \
+            if(likely(current_ums_process == NULL)){   \
+                hash_add_rcu(ums_hashtable, &item->hlist, item->key);   \
+                p_ums_process_OUT = item;   \
+            }   \
+        spin_unlock(&ums_hashtable_lock);    \
+        \
+        if(unlikely(p_ums_process_OUT == NULL)){    \
+            res_OUT = -EBUSY;   \
+            DESTROY_UMS_PROCESS(item);  \
+            ums_cache_free(UMS_CACHE_PROCESS, item);    \
+            break;  \
+        }   \
+        ums_proc_add_process(item, item->proc_entry, item->proc_entry_main_scheds, item->proc_entry_workers, tgid); \
+    }while(0)
+
+/**
+ * @brief remove a ums_process from the hashtable and destroy it
+ * 
+ * @param p_ums_process NON-NULL pointer to the ums_process to destroy
  * 
+ * NOTE: This function must be used only if the ums_process has been created by ums_hashtable_create_process()
  */
-#define ums_hashtable_create_process(tgid)  \
+#define ums_hashtable_destroy_process(p_ums_process)  \
     do{ \
-        ums_process_t* item = kmalloc(sizeof(ums_process_t), GFP_KERNEL);   \
-        INIT_UMS_PROCESS(item, tgid);   \
+        ums_proc_remove_process((p_ums_process)->proc_entry, (p_ums_process)->proc_entry_main_scheds, (p_ums_process)->proc_entry_workers);    \
         \
-        write_lock(&ums_hashtable_rwlock);  \
-            hash_add(ums_hashtable, &item->hlist, item->key);   \
-        write_unlock(&ums_hashtable_rwlock);    \
+        spin_lock(&ums_hashtable_lock);  \
+            hash_del_rcu(&(p_ums_process)->hlist);  \
+        spin_unlock(&ums_hashtable_lock);    \
         \
-        ums_proc_add_process(item->proc_entry, item->proc_entry_main_scheds, tgid); \
+        DESTROY_UMS_PROCESS(p_ums_process);   \
+        ums_cache_free_rcu(UMS_CACHE_PROCESS, p_ums_process); \
     }while(0)
 
 /**
@@ -123,16 +166,12 @@ extern rwlock_t ums_hashtable_rwlock;
 #define ums_hashtable_delete_process(tgid)  \
     do{ \
         ums_process_t* ums_process; \
+        rcu_read_lock();    \
         ums_hashtable_get_process(tgid, ums_process);   \
+        rcu_read_unlock();  \
+        /* only the owner destroys it, it cannot be freed in the meantime */  \
         if(likely(ums_process != NULL)){    \
-            ums_proc_remove_process(ums_process->proc_entry, ums_process->proc_entry_main_scheds);    \
-            \
-            write_lock(&ums_hashtable_rwlock);  \
-                hash_del(&ums_process->hlist);  \
-            write_unlock(&ums_hashtable_rwlock);    \
-            \
-            DESTROY_UMS_PROCESS(ums_process);   \
-            kfree(ums_process); \
+            ums_hashtable_destroy_process(ums_process);  \
         }   \
     }while(0)
 // ------------------------------------------------------------------------------
@@ -150,8 +189,8 @@ static inline int printk_ums_hashtable(void){
     ums_process_t* current_item = NULL;                                  
 
 
-    read_lock(&ums_hashtable_rwlock);
-        hash_for_each(ums_hashtable, current_bucket, current_item, hlist){
+    rcu_read_lock();
+        hash_for_each_rcu(ums_hashtable, current_bucket, current_item, hlist){
             printk(KERN_DEBUG 
                         "\t |||||||||||||||||||||||||||||||||||| KEY = %d |||| VALUE = %p |||||||||||||||||||||||||||||||||||| \n"
                         , 
@@ -164,7 +203,7 @@ static inline int printk_ums_hashtable(void){
                          "\t ||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||| \n"
                         );             
         }  
-    read_unlock(&ums_hashtable_rwlock);
+    rcu_read_unlock();
 
     return 0;
 }
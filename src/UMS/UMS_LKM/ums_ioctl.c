@@ -0,0 +1,50 @@
+#include "ums_ioctl.h"
+#include <linux/string.h>
+
+DEFINE_PER_CPU(ums_ioctl_stats_t, ums_ioctl_stats[UMS_IOCTL_NUM]);
+
+// ---------------------------------------------------------------------------------------------
+int ums_ioctl_seq_show_stats(struct seq_file* m){
+    ums_ioctl_stats_t sum;
+    ums_ioctl_stats_t* stats;
+    int index, cpu, i;
+
+    seq_printf(m, "%-40s %10s %10s %12s %14s %14s %14s\n",
+                "request", "calls", "errors", "avg_cycles", "p50_cycles<=", "p99_cycles<=", "max_cycles");
+
+    for(index = 0; index < UMS_IOCTL_NUM; index++){
+        if(ums_ioctl_table[index].handler == NULL)
+            continue;
+
+        memset(&sum, 0, sizeof(sum));
+        for_each_possible_cpu(cpu){
+            stats = per_cpu_ptr(&ums_ioctl_stats[index], cpu);
+            sum.calls += READ_ONCE(stats->calls);
+            sum.errors += READ_ONCE(stats->errors);
+            sum.cycles += READ_ONCE(stats->cycles);
+            sum.max_cycles = max_t(u64, sum.max_cycles, READ_ONCE(stats->max_cycles));
+            for(i = 0; i < UMS_IOCTL_BUCKETS; i++)
+                sum.buckets[i] += READ_ONCE(stats->buckets[i]);
+        }
+
+        seq_printf(m, "%-40s %10llu %10llu %12llu %14llu %14llu %14llu\n",
+                    ums_ioctl_table[index].name,
+                    sum.calls,
+                    sum.errors,
+                    (sum.calls > 0)? div64_u64(sum.cycles, sum.calls) : 0,
+                    ums_log2_hist_percentile(sum.buckets, sum.calls, sum.max_cycles, 500),
+                    ums_log2_hist_percentile(sum.buckets, sum.calls, sum.max_cycles, 990),
+                    sum.max_cycles);
+    }
+    return 0;
+}
+
+void ums_ioctl_reset_stats(void){
+    int index, cpu;
+
+    for_each_possible_cpu(cpu){
+        for(index = 0; index < UMS_IOCTL_NUM; index++)
+            memset(per_cpu_ptr(&ums_ioctl_stats[index], cpu), 0, sizeof(ums_ioctl_stats_t));
+    }
+}
+// ---------------------------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+#pragma once
+/// @file
+/// This file contains the dispatch table of the requests of /dev/UMS and their statistics, exposed in /proc/ums/ioctl_stats
+///
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/seq_file.h>
+#include <linux/jump_label.h>
+#include <asm/timex.h>
+
+#include "../common/ums_requests.h"
+
+#include "ums_log2_hist.h"
+
+struct ums_process_t;
+
+// ums_ioctl_entry_t ########################################################################################
+#define UMS_IOCTL_NUM   28  /** number of requests, from REQUEST_0 down to REQUEST_27. A new request out of it does not compile in ums_ioctl_table */
+
+/**
+ * @brief index in the dispatch table of a request, UMS_IOCTL_NUM or more if it is not a request of UMS
+ *
+ */
+#define UMS_IOCTL_INDEX(request)    ((unsigned int)REQUEST_0 - (unsigned int)(request))
+
+/**
+ * @brief entry of the dispatch table
+ *
+ */
+typedef struct ums_ioctl_entry_t{
+    const char* name;   /** name of the request, used by /proc/ums/ioctl_stats and by the debug printk */
+    long (*handler)(struct file* file, struct ums_process_t* ums_process, unsigned long data);  /** NULL if the request is not supported */
+}ums_ioctl_entry_t;
+
+extern const ums_ioctl_entry_t ums_ioctl_table[UMS_IOCTL_NUM];  /** dispatch table, indexed by UMS_IOCTL_INDEX() */
+DECLARE_STATIC_KEY_FALSE(ums_debug_requests);   /** module parameter, printk the result of each request and the details of the handlers */
+// ########################################################################################
+
+// ums_ioctl_stats_t ########################################################################################
+#define UMS_IOCTL_BUCKETS   UMS_LOG2_HIST_BUCKETS  /** bucket i counts the requests that took [2^i, 2^(i+1)) cycles, the last one also the longer ones */
+
+/**
+ * @brief statistics of a request on a CPU
+ *
+ * Updated only by the CPU that owns them, with preemption disabled. The cycles are measured with get_cycles()
+ * (TSC on x86), the requests that sleep (yield, wait_next_scheduler_call, park...) include the time spent sleeping
+ */
+typedef struct ums_ioctl_stats_t{
+    u64 calls;  /** number of requests */
+    u64 errors; /** number of requests that returned an error */
+    u64 cycles; /** sum of the cycles of the requests */
+    u64 max_cycles; /** cycles of the longest request */
+    u64 buckets[UMS_IOCTL_BUCKETS]; /** log2 histogram of the cycles */
+}ums_ioctl_stats_t;
+
+DECLARE_PER_CPU(ums_ioctl_stats_t, ums_ioctl_stats[UMS_IOCTL_NUM]);
+
+// -------------------------------------------------------------------
+/**
+ * @brief account a request in the statistics of the current CPU
+ *
+ * @param index index of the request in the dispatch table
+ * @param cycles_in cycles spent in the handler of the request
+ * @param res_in value returned by the handler, negative if error
+ */
+#define ums_ioctl_stats_add(index, cycles_in, res_in)   \
+    do{ \
+        ums_ioctl_stats_t* __stats; \
+        u64 __cycles = (cycles_in); \
+        preempt_disable();  \
+        __stats = this_cpu_ptr(&ums_ioctl_stats[index]);    \
+        __stats->calls += 1;    \
+        if((res_in) < 0)    \
+            __stats->errors += 1;   \
+        __stats->cycles += __cycles;    \
+        if(__cycles > __stats->max_cycles)  \
+            __stats->max_cycles = __cycles; \
+        __stats->buckets[ums_log2_hist_bucket(__cycles)] += 1;   \
+        preempt_enable();   \
+    }while(0)
+// -------------------------------------------------------------------
+
+/**
+ * @brief show the statistics of the requests, summed over the CPUs, in /proc/ums/ioctl_stats
+ *
+ */
+int ums_ioctl_seq_show_stats(struct seq_file* m);
+
+/**
+ * @brief reset the statistics of the requests
+ *
+ * NOTE: the requests in progress on other CPUs may be partially accounted
+ */
+void ums_ioctl_reset_stats(void);
+// ########################################################################################
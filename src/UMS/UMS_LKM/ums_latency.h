@@ -0,0 +1,90 @@
+#pragma once
+/// @file
+/// This file contains the latency histograms of the handoffs of a scheduler, exposed in /proc/ums/<tgid>/schedulers/<pid>/latency
+///
+
+#include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+
+#include "ums_log2_hist.h"
+
+// ums_latency_hist_t ########################################################################################
+#define UMS_LATENCY_BUCKETS     UMS_LOG2_HIST_BUCKETS  /** bucket i counts latencies in [2^i, 2^(i+1)) ns, the last one also the longer ones */
+
+/**
+ * @brief log2 histogram of latencies in ns
+ *
+ * Counters are atomic, they are updated without the spin_lock of the scheduler and read without stopping the updates
+ */
+typedef struct ums_latency_hist_t{
+    atomic64_t buckets[UMS_LATENCY_BUCKETS];
+    atomic64_t count;
+    atomic64_t sum_ns;
+    atomic64_t max_ns;
+}ums_latency_hist_t;
+
+// -------------------------------------------------------------------
+/**
+ * @brief ums_latency_hist constructor, also used to reset it
+ *
+ * @param p_hist NON-NULL pointer to the histogram
+ */
+#define INIT_UMS_LATENCY_HIST(p_hist)   \
+    do{ \
+        int __i;    \
+        for(__i = 0; __i < UMS_LATENCY_BUCKETS; __i++)  \
+            atomic64_set(&(p_hist)->buckets[__i], 0);   \
+        atomic64_set(&(p_hist)->count, 0);  \
+        atomic64_set(&(p_hist)->sum_ns, 0); \
+        atomic64_set(&(p_hist)->max_ns, 0); \
+    }while(0)
+// -------------------------------------------------------------------
+
+// -------------------------------------------------------------------
+/**
+ * @brief add a latency to the histogram
+ *
+ * @param hist NON-NULL pointer to the histogram
+ * @param ns latency in ns
+ */
+static inline void ums_latency_hist_add(ums_latency_hist_t* hist, u64 ns){
+    s64 max = atomic64_read(&hist->max_ns);
+
+    atomic64_inc(&hist->buckets[ums_log2_hist_bucket(ns)]);
+    atomic64_inc(&hist->count);
+    atomic64_add(ns, &hist->sum_ns);
+    while(unlikely((s64)ns > max) && !atomic64_try_cmpxchg(&hist->max_ns, &max, ns))
+        ;
+}
+
+/**
+ * @brief show the histogram in a seq_file: summary line and then a line for each bucket not empty
+ *
+ * NOTE: the buckets are read once, the percentiles and the lines are computed on the same values
+ */
+static inline void seq_ums_latency_hist(struct seq_file* m, const char* name, ums_latency_hist_t* hist){
+    u64 buckets[UMS_LATENCY_BUCKETS];
+    u64 count = atomic64_read(&hist->count);
+    u64 max_ns = atomic64_read(&hist->max_ns);
+    int i;
+
+    for(i = 0; i < UMS_LATENCY_BUCKETS; i++)
+        buckets[i] = atomic64_read(&hist->buckets[i]);
+
+    seq_printf(m, "%s: count=%llu avg_ns=%llu p50_ns<=%llu p99_ns<=%llu max_ns=%llu\n",
+                name,
+                count,
+                (count > 0)? div64_u64(atomic64_read(&hist->sum_ns), count) : 0,
+                ums_log2_hist_percentile(buckets, count, max_ns, 500),
+                ums_log2_hist_percentile(buckets, count, max_ns, 990),
+                max_ns);
+
+    for(i = 0; i < UMS_LATENCY_BUCKETS; i++){
+        if(buckets[i] != 0)
+            seq_printf(m, "\t[%llu, %llu) %llu\n", (i > 0)? 1ULL << i : 0, 2ULL << i, buckets[i]);
+    }
+}
+// -------------------------------------------------------------------
+// ########################################################################################
@@ -0,0 +1,50 @@
+#pragma once
+/// @file
+/// This file contains the helpers of the log2 histograms, shared by the latency histograms of the schedulers
+/// and by the statistics of the requests
+///
+
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+
+#define UMS_LOG2_HIST_BUCKETS   40  /** bucket i counts the values in [2^i, 2^(i+1)), the last one also the greater ones */
+
+// -------------------------------------------------------------------
+/**
+ * @brief bucket of a value
+ *
+ * @param value value to account (ns, cycles...)
+ *
+ * @return Returns the index of the bucket, in [0, UMS_LOG2_HIST_BUCKETS)
+ */
+static inline int ums_log2_hist_bucket(u64 value){
+    return (value > 1)? min_t(int, ilog2(value), UMS_LOG2_HIST_BUCKETS - 1) : 0;
+}
+
+/**
+ * @brief upper bound of a percentile, the end of the bucket that contains it
+ *
+ * @param buckets NON-NULL array of UMS_LOG2_HIST_BUCKETS counters
+ * @param count number of values in the histogram
+ * @param max greatest value in the histogram, returned if the percentile falls in the last bucket
+ * @param permille percentile in thousandths (e.g. 990 for p99)
+ *
+ * @return Returns the upper bound, 0 if the histogram is empty
+ */
+static inline u64 ums_log2_hist_percentile(const u64* buckets, u64 count, u64 max, unsigned int permille){
+    u64 target, seen = 0;
+    int i;
+
+    if(count == 0)
+        return 0;
+
+    target = max_t(u64, div_u64(count * permille + 999, 1000), 1);
+    for(i = 0; i < UMS_LOG2_HIST_BUCKETS - 1; i++){
+        seen += buckets[i];
+        if(seen >= target)
+            return (2ULL << i) - 1;
+    }
+    return max;
+}
+// -------------------------------------------------------------------
@@ -0,0 +1,104 @@
+#include "ums_preemption.h"
+#include "ums_context.h"
+#include "ums_process.h"
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+
+// ---------------------------------------------------------------------------------------------
+enum hrtimer_restart ums_scheduler_quantum_expired(struct hrtimer* timer){
+    ums_scheduler_t* ums_scheduler = container_of(timer, ums_scheduler_t, quantum_timer);
+    ums_context_t* ums_context = READ_ONCE(ums_scheduler->quantum_context);
+
+    if(unlikely(ums_context == NULL || READ_ONCE(ums_context->preempt_pending)))
+        return HRTIMER_NORESTART;
+
+    // set before sending, the handler may run on another CPU before we return
+    ums_context->preempted_seq = ums_scheduler->quantum_seq;
+    WRITE_ONCE(ums_context->preempt_pending, true);
+    // the signal kicks the thread out of user space, also if it runs on another CPU
+    if(unlikely(!ums_context_send_park_signal(ums_context)))
+        WRITE_ONCE(ums_context->preempt_pending, false);
+
+    return HRTIMER_NORESTART;
+}
+
+bool ums_context_send_park_signal(struct ums_context_t* ums_context){
+    struct task_struct* task_struct = ums_context->task_struct;
+    struct sighand_struct* sighand;
+    __sighandler_t handler = SIG_DFL;
+
+    if(unlikely(task_struct == NULL))
+        return false;
+
+    rcu_read_lock();
+    sighand = rcu_dereference(task_struct->sighand);
+    if(likely(sighand != NULL))
+        handler = READ_ONCE(sighand->action[UMS_PARK_SIGNAL - 1].sa.sa_handler);
+    rcu_read_unlock();
+
+    // the default action of a real-time signal terminates the process
+    if(unlikely(handler == SIG_DFL || handler == SIG_IGN))
+        return false;
+
+    return send_sig(UMS_PARK_SIGNAL, task_struct, 1) == 0;
+}
+
+int ums_context_park_preempted(struct ums_process_t* ums_process, struct ums_context_t* ums_context){
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+
+    rcu_read_lock();
+    ums_process_get_scheduler_sl(ums_process, ums_context->pid_scheduler, ums_scheduler_sl);
+    if(unlikely(ums_scheduler_sl == NULL)){
+        WRITE_ONCE(ums_context->preempt_pending, false);
+        rcu_read_unlock();
+        return -ERR_INTERNAL;
+    }
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(unlikely(ums_scheduler == NULL)){
+        WRITE_ONCE(ums_context->preempt_pending, false);
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return -ERR_INTERNAL;
+    }
+
+    // it yielded, blocked or ended in the meantime, or this is the quantum of a previous execution
+    if(ums_scheduler->running_thread != ums_context || ums_context->state != UMS_THREAD_STATE_RUNNING ||
+        ums_context->preempted_seq != ums_scheduler->quantum_seq){
+        WRITE_ONCE(ums_context->preempt_pending, false);
+        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+        rcu_read_unlock();
+        return 0;
+    }
+
+    // as rq_yield_ums_context()
+    ums_scheduler->running_thread = NULL;
+    WRITE_ONCE(ums_scheduler->quantum_context, NULL);
+    ums_scheduler->num_preemptions += 1;
+
+    ums_context_update_run_time_end_slot(ums_context);
+
+    ums_context->state = UMS_THREAD_STATE_IDLE;
+    ums_context->num_switch += 1;
+    ums_scheduler_ready_list_add(ums_scheduler, ums_context);
+
+    // prepare arguments for the next call of entry_point function
+    ums_scheduler->entry_point_args->reason = REASON_THREAD_PREEMPTED;
+    ums_scheduler->entry_point_args->activation_payload = ums_context->id;
+    ums_ring_post_event(ums_scheduler->ring, REASON_THREAD_PREEMPTED, ums_context->id);
+
+    WRITE_ONCE(ums_context->preempt_pending, false);
+
+    set_current_state(TASK_INTERRUPTIBLE);
+    ums_scheduler_sl_handoff_start(ums_scheduler_sl);
+    while(!wake_up_process(ums_scheduler->scheduler_task_struct));
+
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+    rcu_read_unlock();
+
+    schedule(); // until a scheduler executes it again
+    ums_process_handoff_end(ums_process, ums_context);
+    return 0;
+}
+// ---------------------------------------------------------------------------------------------
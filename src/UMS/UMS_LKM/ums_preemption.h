@@ -0,0 +1,33 @@
+#pragma once
+/// @file
+/// This file contains the functions used to preempt a ums_context at the end of the quantum of its scheduler
+///
+
+#include <linux/kernel.h>
+#include <linux/hrtimer.h>
+
+struct ums_context_t;
+struct ums_process_t;
+
+/**
+ * @brief hrtimer callback of a ums_scheduler, the quantum of its running ums_context expired
+ *
+ * NOTE: it runs in hardirq context, the thread of the ums_context is forced to enter the kernel by UMS_PARK_SIGNAL
+ */
+enum hrtimer_restart ums_scheduler_quantum_expired(struct hrtimer* timer);
+
+/**
+ * @brief send UMS_PARK_SIGNAL to the thread of a ums_context, its handler (libums) requests RQ_PARK_UMS_CONTEXT
+ *
+ * @return true if it has been sent, false if the process does not handle UMS_PARK_SIGNAL (it would be killed)
+ * NOTE: it can be called in hardirq context, but not with the runqueue lock held
+ */
+bool ums_context_send_park_signal(struct ums_context_t* ums_context);
+
+/**
+ * @brief called by the thread of a preempted ums_context (RQ_PARK_UMS_CONTEXT), it leaves the CPU to its scheduler
+ * (REASON_THREAD_PREEMPTED), as for a yield
+ *
+ * @return 0 also if the preemption is stale (it yielded, blocked or ended in the meantime), otherwise -errno
+ */
+int ums_context_park_preempted(struct ums_process_t* ums_process, struct ums_context_t* ums_context);
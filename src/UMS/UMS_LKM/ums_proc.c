@@ -3,104 +3,209 @@
 #include "ums_process.h"
 #include "ums_hashtable.h"
 #include <linux/jiffies.h>
-
-#define __USS_INFO_BUFF_SIZE    128
-ssize_t ums_scheduler_snprintf_info(pid_t tgid, pid_t sched_pid, char* buff, size_t buff_size){
-    ums_process_t* ums_process;
+#include <linux/slab.h>
+
+#define __USS_INFO_IDS_MIN    32
+/**
+ * @brief copy the descriptors of the ready_list and of the ums_completion_list of a scheduler
+ *
+ * Only the copy is done under the spin_locks, the printing is done by the caller after. If a list is longer
+ * than its array, the arrays are grown and the copy is retried, so the lists are never truncated.
+ *
+ * @param ums_scheduler_sl NON-NULL pointer to the ums_scheduler_sl
+ * @param p_rl output, kvmalloc'd array of the ready_list, to free with kvfree()
+ * @param p_num_rl output, number of elements of *p_rl
+ * @param p_cl output, kvmalloc'd array of the ums_completion_list, to free with kvfree()
+ * @param p_num_cl output, number of elements of *p_cl
+ *
+ * @return Returns 0 on sucess, otherwise -ENOMEM or -ERR_INTERNAL
+ */
+static int ums_scheduler_copy_lists(ums_scheduler_sl_t* ums_scheduler_sl, int** p_rl, int* p_num_rl, int** p_cl, int* p_num_cl){
     ums_scheduler_t* ums_scheduler;
-    ums_scheduler_sl_t* ums_scheduler_sl;
     ums_completion_list_sl_t* ums_completion_list_sl;
     struct list_head* completion_list;
-    char buff_cl[__USS_INFO_BUFF_SIZE];
-    char buff_rl[__USS_INFO_BUFF_SIZE];
-    ssize_t len = 0;
+    ums_context_t* ums_context;
+    ums_context_sl_t* ums_context_sl;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
-    ums_process_get_scheduler_sl(ums_process, sched_pid, ums_scheduler_sl);
-    if(unlikely(ums_scheduler_sl == NULL))
-        return -ERR_INTERNAL;
+    int cap_rl = __USS_INFO_IDS_MIN;
+    int cap_cl = __USS_INFO_IDS_MIN;
+    int num_rl, num_cl;
+    int* rl;
+    int* cl;
+
+    ums_scheduler = READ_ONCE(ums_scheduler_sl->ums_scheduler);
+    if(likely(ums_scheduler != NULL))
+        cap_rl = max(cap_rl, READ_ONCE(ums_scheduler->num_ready));
+
+    while(true){
+        rl = kvmalloc_array(cap_rl, sizeof(int), GFP_KERNEL);
+        cl = kvmalloc_array(cap_cl, sizeof(int), GFP_KERNEL);
+        if(unlikely(rl == NULL || cl == NULL)){
+            kvfree(rl);
+            kvfree(cl);
+            return -ENOMEM;
+        }
+
+        num_rl = 0;
+        num_cl = 0;
+        ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+        if(unlikely(ums_scheduler == NULL)){
+            ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+            kvfree(rl);
+            kvfree(cl);
+            return -ERR_INTERNAL;  //should be a KERNEL PANIC
+        }
+
+        list_for_each_entry(ums_context, &ums_scheduler->ready_list, list){
+            if(num_rl < cap_rl)
+                rl[num_rl] = ums_context->id;
+            num_rl++;
+        }
+
+        ums_completion_list_sl = ums_scheduler->completion_list;
+        ums_completion_list_sl_lock_get_list(ums_completion_list_sl, completion_list);
+            list_for_each_entry(ums_context_sl, completion_list, cl_list){
+                if(num_cl < cap_cl)
+                    cl[num_cl] = ums_context_sl->id;
+                num_cl++;
+            }
+        ums_completion_list_sl_unlock_list(ums_completion_list_sl);
 
-    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
-    if(unlikely(ums_scheduler == NULL)){
         ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
-        return -ERR_INTERNAL;  //should be a KERNEL PANIC
+
+        if(likely(num_rl <= cap_rl && num_cl <= cap_cl))
+            break;
+
+        // a list is longer than its array, retry with the sizes seen (plus room for some more)
+        kvfree(rl);
+        kvfree(cl);
+        cap_rl = max(cap_rl, num_rl + num_rl/4);
+        cap_cl = max(cap_cl, num_cl + num_cl/4);
     }
 
-    ums_completion_list_sl = ums_scheduler->completion_list;
-    ums_completion_list_sl_lock_get_list(ums_completion_list_sl, completion_list);    
-        snprintf_completion_list_as_ids(buff_cl, __USS_INFO_BUFF_SIZE, completion_list);
-    ums_completion_list_sl_unlock_list(ums_completion_list_sl);
+    *p_rl = rl;
+    *p_num_rl = num_rl;
+    *p_cl = cl;
+    *p_num_cl = num_cl;
+    return 0;
+}
 
-    snprintf_list_of_ums_context_as_ids(buff_rl, __USS_INFO_BUFF_SIZE, &(ums_scheduler->ready_list));
+/**
+ * @brief print a list of descriptors as "1,2,3", "-" if empty
+ *
+ */
+static void seq_list_of_ids(struct seq_file* m, int* ids, int num){
+    int i;
 
-    len += snprintf(buff, buff_size,
-                        "ns=%d\n"
-                        "cl=%s\n"
-                        "rl=%s\n"
-                        "run=%d\n"
-                        , 
-                        ums_scheduler->num_switch,
-                        buff_cl,
-                        buff_rl,
-                        (ums_scheduler->running_thread)?ums_scheduler->running_thread->id:-1
-                        );
+    if(num == 0){
+        seq_putc(m, '-');
+        return;
+    }
+    for(i = 0; i < num; i++)
+        seq_printf(m, (i == 0)? "%d" : ",%d", ids[i]);
+}
 
-    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+int ums_scheduler_seq_show_info(struct seq_file* m, ums_scheduler_sl_t* ums_scheduler_sl){
+    ums_scheduler_t* ums_scheduler;
+    ums_context_t* running_thread;
+    int* rl;
+    int* cl;
+    int num_rl, num_cl;
+    int res;
+
+    res = ums_scheduler_copy_lists(ums_scheduler_sl, &rl, &num_rl, &cl, &num_cl);
+    if(unlikely(res != 0))
+        return res;
+
+    // NOTE: the ums_scheduler is destroyed after the removal of this file, the counters are read without its spin_lock:
+    // each one is consistent, the set of them is not a snapshot of a single instant
+    ums_scheduler = READ_ONCE(ums_scheduler_sl->ums_scheduler);
+    if(unlikely(ums_scheduler == NULL)){
+        kvfree(rl);
+        kvfree(cl);
+        return -ERR_INTERNAL;
+    }
 
-    return len;
+    seq_printf(m, "ns=%d\n", READ_ONCE(ums_scheduler->num_switch));
+    seq_puts(m, "cl=");
+    seq_list_of_ids(m, cl, num_cl);
+    seq_puts(m, "\nrl=");
+    seq_list_of_ids(m, rl, num_rl);
+
+    // ums_contexts are freed after a grace period
+    rcu_read_lock();
+    running_thread = READ_ONCE(ums_scheduler->running_thread);
+    seq_printf(m, "\nrun=%d\n", (running_thread)?running_thread->id:-1);
+    rcu_read_unlock();
+
+    seq_printf(m,
+                "steal_attempts=%d\n"
+                "steals=%d\n"
+                "stolen=%d\n"
+                "quantum_us=%llu\n"
+                "preemptions=%d\n"
+                "parks=%d\n"
+                ,
+                READ_ONCE(ums_scheduler->num_steal_attempts),
+                READ_ONCE(ums_scheduler->num_steals),
+                READ_ONCE(ums_scheduler->num_stolen),
+                READ_ONCE(ums_scheduler->quantum_ns) / NSEC_PER_USEC,
+                READ_ONCE(ums_scheduler->num_preemptions),
+                READ_ONCE(ums_scheduler->num_parks)
+                );
+
+    kvfree(rl);
+    kvfree(cl);
+    return 0;
 }
 
 
 
 
 
-#define __USS_WORKER_BUFF_SIZE    128
-ssize_t ums_scheduler_snprintf_worker(pid_t tgid, pid_t sched_pid, ums_context_descriptor_t ucd, char* buff, size_t buff_size){
-    ums_process_t* ums_process;
-    
-    ums_scheduler_sl_t* ums_scheduler_sl;
-    ums_scheduler_t* ums_scheduler;
+int ums_scheduler_seq_show_latency(struct seq_file* m, ums_scheduler_sl_t* ums_scheduler_sl){
+    // the histograms are atomic, the spin_lock of the scheduler is not needed
+    seq_ums_latency_hist(m, "wake_scheduler", &ums_scheduler_sl->latency_wake);
+    seq_ums_latency_hist(m, "execute_context", &ums_scheduler_sl->latency_execute);
+    return 0;
+}
 
-    ums_context_sl_t* ums_context_sl;
-    ums_context_t* ums_context;
+void ums_scheduler_reset_latency(ums_scheduler_sl_t* ums_scheduler_sl){
+    INIT_UMS_LATENCY_HIST(&ums_scheduler_sl->latency_wake);
+    INIT_UMS_LATENCY_HIST(&ums_scheduler_sl->latency_execute);
+}
 
 
-    ssize_t len = 0;
 
-    ums_hashtable_get_process(tgid, ums_process);
-    if(unlikely(ums_process == NULL))
-        return -ERR_INTERNAL;
-    
-    ums_process_get_scheduler_sl(ums_process, sched_pid, ums_scheduler_sl);
-    if(unlikely(ums_scheduler_sl == NULL))
-        return -ERR_INTERNAL;
 
-    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
-    if(unlikely(ums_scheduler == NULL)){
-        ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
-        return -ERR_INTERNAL;  //should be a KERNEL PANIC
+int ums_process_seq_show_workers(struct seq_file* m, ums_process_t* ums_process){
+    ums_context_sl_t* ums_context_sl;
+    ums_context_t* ums_context;
+    unsigned long ucd;
+
+    seq_printf(m, "%6s %10s %8s %5s %8s %12s %14s %14s %14s\n",
+                "ucd", "scheduler", "state", "prio", "ns", "ums_run_time", "run_time_ns", "cpu_time_ns", "ready_wait_ns");
+
+    // NOTE: ums_context_sl and ums_context are freed after a grace period. Their fields are written only by
+    // the scheduler that manages them, here they are read without its spin_lock
+    rcu_read_lock();
+    xa_for_each(&ums_process->xa_ums_context, ucd, ums_context_sl){
+        ums_context = READ_ONCE(ums_context_sl->ums_context);
+        if(unlikely(ums_context == NULL))
+            continue;   // being deleted
+
+        seq_printf(m, "%6lu %10d %8s %5d %8d %12u %14llu %14llu %14llu\n",
+                    ucd,
+                    READ_ONCE(ums_context->pid_scheduler),
+                    ums_context_printable_state(ums_context),
+                    READ_ONCE(ums_context->prio),
+                    READ_ONCE(ums_context->num_switch),
+                    ums_context_get_run_time_ms(ums_context),
+                    READ_ONCE(ums_context->ums_run_time),
+                    READ_ONCE(ums_context->ums_cpu_time),
+                    READ_ONCE(ums_context->ums_ready_wait_time)
+                    );
     }
-    // NOTE: It is necessary to lock the scheduler that manage the thread since at this point, only the scheduler
-    // can access to the thread
-
-    ums_process_get_ums_context_sl(ums_process, ucd, ums_context_sl);
-    ums_context = ums_context_sl->ums_context;
-
-    
-    len += snprintf(buff, buff_size,
-                        "ns=%d\n"
-                        "state=%s\n"
-                        "ums_run_time=%u\n"
-                        , 
-                        ums_context->num_switch,
-                        ums_context_printable_state(ums_context),
-                        ums_context_get_run_time_ms(ums_context)
-                        );
-    
-    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
-
-    return len;
-}
\ No newline at end of file
+    rcu_read_unlock();
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <asm/uaccess.h>
 
 
@@ -14,26 +15,52 @@
 #include "ums_process.h"
 #include "ums_context.h"
 #include "ums_completion_lsit.h"
+#include "ums_cache.h"
+#include "ums_ioctl.h"
 
 
 extern struct proc_dir_entry* ums_proc_ums_folder; /** entry in /proc of "ums" folder*/
+extern struct proc_dir_entry* ums_proc_caches_file; /** entry in /proc of "ums/caches" file*/
+extern struct proc_dir_entry* ums_proc_ioctl_stats_file; /** entry in /proc of "ums/ioctl_stats" file*/
+extern bool ums_proc_objects;   /** module parameter, false to not create the entries of processes and schedulers in /proc/ums */
+
+// NOTE: the files of /proc/ums store the object they describe as proc data (pde_data()), their show functions are called
+// by seq_read() with it and do not look it up again. proc_remove() waits for the readers of a file, and the files are removed
+// before the objects are destroyed, so the object is valid for the whole read.
+
+/**
+ * @brief show info about a scheduler in /proc
+ * 
+ * The counters are read without the spin_lock of the scheduler, the lists are copied under the spin_locks
+ * and printed after. The output is complete whatever the length of the lists.
+ * 
+ * @param m seq_file of the read
+ * @param ums_scheduler_sl NON-NULL pointer to the ums_scheduler_sl, proc data of the file
+ */
+int ums_scheduler_seq_show_info(struct seq_file* m, ums_scheduler_sl_t* ums_scheduler_sl);
+
+/**
+ * @brief show a line for each ums_context of a process in /proc, without spin_locks
+ * 
+ * @param m seq_file of the read
+ * @param ums_process NON-NULL pointer to the ums_process, proc data of the file
+ */
+int ums_process_seq_show_workers(struct seq_file* m, ums_process_t* ums_process);
 
 /**
- * @brief snprintf used to print info about scheduler in /proc
+ * @brief show the latency histograms of a scheduler in /proc
  * 
- * @param tgid tgid of the process
- * @param sched_pid pid of the scheduler
+ * @param m seq_file of the read
+ * @param ums_scheduler_sl NON-NULL pointer to the ums_scheduler_sl, proc data of the file
  */
-ssize_t ums_scheduler_snprintf_info(pid_t tgid, pid_t sched_pid, char* buff, size_t buff_size);
+int ums_scheduler_seq_show_latency(struct seq_file* m, ums_scheduler_sl_t* ums_scheduler_sl);
 
 /**
- * @brief snprintf used to print info about a worker thread in /proc
+ * @brief reset the latency histograms of a scheduler
  * 
- * @param tgid tgid of the process
- * @param sched_pid pid of the scheduler that manages the ums_context
- * @param ucd descriptor of the ums_context
+ * @param ums_scheduler_sl NON-NULL pointer to the ums_scheduler_sl, proc data of the file
  */
-ssize_t ums_scheduler_snprintf_worker(pid_t tgid, pid_t sched_pid, ums_context_descriptor_t ucd, char* buff, size_t buff_size);
+void ums_scheduler_reset_latency(ums_scheduler_sl_t* ums_scheduler_sl);
 
 
 /**
@@ -46,163 +73,113 @@ static ssize_t ums_proc_write(struct file *file, const char __user *ubuf, size_t
 }
 
 
+static int ums_proc_show_scheduler(struct seq_file* m, void* v){
+    return ums_scheduler_seq_show_info(m, (ums_scheduler_sl_t*)m->private);
+}
 /**
- * @brief get pid of the scheduler to which "file" refers to, in /proc/ums
+ * @brief function used when user opens "info" file in /proc/ums
  * 
- * @param p_file pointer to a struct file
- * @param p_pid_out output, pointer to a pid_t
  */
-#define __sched_file_to_sched_pid(p_file, p_pid_out)    \
-    do{ \
-        long tmp;   \
-        int res = kstrtol((p_file)->f_path.dentry->d_parent->d_iname, 10, &tmp); \
-        if(likely(res==0))   \
-            *(p_pid_out) = (pid_t)tmp;  \
-        else    \
-            *(p_pid_out) = -1;  \
-    }while(0)
+static int ums_proc_open_scheduler(struct inode* inode, struct file* file){
+    return single_open(file, ums_proc_show_scheduler, pde_data(inode));
+}
+static struct proc_ops sched_info_ops = {
+        .proc_open = ums_proc_open_scheduler,
+        .proc_read = seq_read,
+        .proc_lseek = seq_lseek,
+        .proc_release = single_release,
+        .proc_write = ums_proc_write,
+};
 
+
+static int ums_proc_show_latency(struct seq_file* m, void* v){
+    return ums_scheduler_seq_show_latency(m, (ums_scheduler_sl_t*)m->private);
+}
 /**
- * @brief get tgid of the process to which "file" refers to, in /proc/ums
+ * @brief function used when user opens "latency" file in /proc/ums
  * 
  */
-#define __sched_file_to_tgid(p_file, p_tgid_out)    \
-    do{ \
-        long tmp;   \
-        int res = kstrtol((p_file)->f_path.dentry->d_parent->d_parent->d_parent->d_iname, 10, &tmp);    \
-        if(likely(res==0))  \
-            *(p_tgid_out) = (pid_t)tmp; \
-        else \
-            *(p_tgid_out) = -1; \
-    }while(0)
-
-
-#define __INFO_FILE_BUFF_SIZE   128
+static int ums_proc_open_latency(struct inode* inode, struct file* file){
+    return single_open(file, ums_proc_show_latency, pde_data(inode));
+}
 /**
- * @brief function used when user reads "info" file in /proc/ums
+ * @brief function used when user writes "latency" file in /proc/ums, any value resets the histograms
  * 
  */
-static ssize_t ums_proc_read_scheduler(struct file *file, char __user *ubuf, size_t count, loff_t *ppos){
-
-    pid_t sched_pid;
-    pid_t tgid;
-
-    char buff[__INFO_FILE_BUFF_SIZE];
-    ssize_t len;
-    len = 0;
-
-    __sched_file_to_sched_pid(file, &sched_pid);
-    __sched_file_to_tgid(file, &tgid);
-
-    if (*ppos > 0 || count < __INFO_FILE_BUFF_SIZE)
-        return 0;
-
-    len += ums_scheduler_snprintf_info(tgid, sched_pid, buff, __INFO_FILE_BUFF_SIZE);
-
-    if (copy_to_user(ubuf, buff, len))
-        return -EFAULT;
-
-    *ppos = len;
-    return len;
+static ssize_t ums_proc_write_latency(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos){
+    ums_scheduler_reset_latency((ums_scheduler_sl_t*)pde_data(file_inode(file)));
+    return count;
 }
-static struct proc_ops sched_info_ops = {
-        .proc_read = ums_proc_read_scheduler,
-        .proc_write = ums_proc_write,
+static struct proc_ops sched_latency_ops = {
+        .proc_open = ums_proc_open_latency,
+        .proc_read = seq_read,
+        .proc_lseek = seq_lseek,
+        .proc_release = single_release,
+        .proc_write = ums_proc_write_latency,
 };
 
 
+static int ums_proc_show_workers(struct seq_file* m, void* v){
+    return ums_process_seq_show_workers(m, (ums_process_t*)m->private);
+}
 /**
- * @brief get ums_context_descriptor of the ums_context to which "p_file" refers to, in /proc/ums
+ * @brief function used when user opens "workers" file in /proc/ums/<tgid>
  * 
- * @param p_file pointer to a struct file
- * @param p_ucd output, pointer to a ums_context_descriptor
  */
-#define __worker_file_to_ucd(p_file, p_ucd)    \
-    do{ \
-        long tmp;   \
-        int res = kstrtol((p_file)->f_path.dentry->d_iname, 10, &tmp); \
-        if(likely(res==0))   \
-            *(p_ucd) = (int)tmp;  \
-        else    \
-            *(p_ucd) = -1;  \
-    }while(0)
+static int ums_proc_open_workers(struct inode* inode, struct file* file){
+    return single_open(file, ums_proc_show_workers, pde_data(inode));
+}
+static struct proc_ops workers_ops = {
+        .proc_open = ums_proc_open_workers,
+        .proc_read = seq_read,
+        .proc_lseek = seq_lseek,
+        .proc_release = single_release,
+        .proc_write = ums_proc_write,
+};
+
 
+static int ums_proc_show_caches(struct seq_file* m, void* v){
+    return ums_cache_seq_show_info(m);
+}
 /**
- * @brief get pid of the scheduler to which "file" refers to, in /proc/ums
+ * @brief function used when user opens "caches" file in /proc/ums
  * 
- * @param p_file pointer to a struct file
- * @param p_pid_out output, pointer to a pid_t
  */
-#define __worker_file_to_sched_pid(p_file, p_pid_out)    \
-    do{ \
-        long tmp;   \
-        int res = kstrtol((p_file)->f_path.dentry->d_parent->d_parent->d_iname, 10, &tmp); \
-        if(likely(res==0))   \
-            *(p_pid_out) = (pid_t)tmp;  \
-        else    \
-            *(p_pid_out) = -1;  \
-    }while(0)
+static int ums_proc_open_caches(struct inode* inode, struct file* file){
+    return single_open(file, ums_proc_show_caches, NULL);
+}
+static struct proc_ops caches_ops = {
+        .proc_open = ums_proc_open_caches,
+        .proc_read = seq_read,
+        .proc_lseek = seq_lseek,
+        .proc_release = single_release,
+        .proc_write = ums_proc_write,
+};
 
+static int ums_proc_show_ioctl_stats(struct seq_file* m, void* v){
+    return ums_ioctl_seq_show_stats(m);
+}
 /**
- * @brief get tgid of the process to which "file" refers to, in /proc/ums
+ * @brief function used when user opens "ioctl_stats" file in /proc/ums
  * 
- * @param p_file pointer to a struct file
- * @param p_tgid_out output, pointer to a pid_t
  */
-#define __worker_file_to_tgid(p_file, p_tgid_out)    \
-    do{ \
-        long tmp;   \
-        int res = kstrtol((p_file)->f_path.dentry->d_parent->d_parent->d_parent->d_parent->d_iname, 10, &tmp);    \
-        if(likely(res==0))  \
-            *(p_tgid_out) = (pid_t)tmp; \
-        else \
-            *(p_tgid_out) = -1; \
-    }while(0)
-
-
-
-
-#define __INFO_WORKER_BUFF_SIZE     128
+static int ums_proc_open_ioctl_stats(struct inode* inode, struct file* file){
+    return single_open(file, ums_proc_show_ioctl_stats, NULL);
+}
 /**
- * @brief function used when user reads a file in "workers" folder in /proc/ums..
+ * @brief function used when user writes "ioctl_stats" file in /proc/ums, any value resets the statistics
  * 
  */
-static ssize_t ums_proc_read_thread(struct file *file, char __user *ubuf, size_t count, loff_t *ppos){
-        
-        pid_t tgid;
-        pid_t sched_pid;
-        ums_context_descriptor_t ucd;
-
-        char buff[__INFO_WORKER_BUFF_SIZE];
-        int len = 0;
-
-        if(*ppos > 0 || count < __INFO_WORKER_BUFF_SIZE)
-            return 0;
- 
-        __worker_file_to_tgid(file, &tgid);
-        __worker_file_to_sched_pid(file, &sched_pid);
-        __worker_file_to_ucd(file, &ucd);
-
-        /*
-        len += snprintf(buff, __INFO_WORKER_BUFF_SIZE,
-                        "tgid=%d"
-                        "sched_pid=%d"
-                        "ucd=%d",
-                        tgid,
-                        sched_pid,
-                        ucd);
-        */
-        len += ums_scheduler_snprintf_worker(tgid, sched_pid, ucd, buff, __INFO_WORKER_BUFF_SIZE);
-
-        if(copy_to_user(ubuf, buff, len))
-                return -EFAULT;
-        *ppos = len;
-
-        return len;
+static ssize_t ums_proc_write_ioctl_stats(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos){
+    ums_ioctl_reset_stats();
+    return count;
 }
-static struct proc_ops thread_ops = {
-        .proc_read = ums_proc_read_thread,
-        .proc_write = ums_proc_write,
+static struct proc_ops ioctl_stats_ops = {
+        .proc_open = ums_proc_open_ioctl_stats,
+        .proc_read = seq_read,
+        .proc_lseek = seq_lseek,
+        .proc_release = single_release,
+        .proc_write = ums_proc_write_ioctl_stats,
 };
 
 /**
@@ -212,6 +189,8 @@ static struct proc_ops thread_ops = {
 #define ums_proc_mount()    \
     do{ \
         ums_proc_ums_folder = proc_mkdir("ums", NULL);  \
+        ums_proc_caches_file = proc_create("caches", S_IALLUGO, ums_proc_ums_folder, &caches_ops);   \
+        ums_proc_ioctl_stats_file = proc_create("ioctl_stats", S_IALLUGO, ums_proc_ums_folder, &ioctl_stats_ops);   \
     }while(0)
 
 /**
@@ -220,22 +199,29 @@ static struct proc_ops thread_ops = {
  */
 #define ums_proc_unmount()  \
     do{ \
+        proc_remove(ums_proc_ioctl_stats_file);  \
+        proc_remove(ums_proc_caches_file);  \
         proc_remove(ums_proc_ums_folder);   \
     }while(0)
 
 /**
- * @brief add a process in /proc/ums
+ * @brief add a process in /proc/ums, nothing if ums_proc_objects is false
  * 
+ * @param p_ums_process_in NON-NULL pointer to the ums_process, proc data of its files
  * @param p_pd_proc_out output, pointer proc_dir_entry of the new directory /proc/ums/<tgid>
  * @param p_pd_scheds_out output, pointer proc_dir_entry of the new directory /proc/ums/<tgid>/schedulers
+ * @param p_workers_out output, pointer proc_dir_entry of the new file /proc/ums/<tgid>/workers
  * @param pid pid of the process (tgid)
  */
-#define ums_proc_add_process(p_pd_proc_out, p_pd_scheds_out, pid)   \
+#define ums_proc_add_process(p_ums_process_in, p_pd_proc_out, p_pd_scheds_out, p_workers_out, pid)   \
     do{ \
         char __buff[32];    \
+        if(!ums_proc_objects)   \
+            break;  \
         sprintf(__buff, "%d", pid); \
         p_pd_proc_out = proc_mkdir(__buff, ums_proc_ums_folder);  \
         p_pd_scheds_out = proc_mkdir("schedulers", p_pd_proc_out);  \
+        p_workers_out = proc_create_data("workers", S_IALLUGO, p_pd_proc_out, &workers_ops, p_ums_process_in);    \
     }while(0)
 
 /**
@@ -243,31 +229,36 @@ static struct proc_ops thread_ops = {
  * 
  * @param p_pd_proc_in pointer proc_dir_entry of the directory /proc/ums/<tgid> to remove
  * @param p_pd_scheds_in pointer proc_dir_entry of the directory /proc/ums/<tgid>/schedulers to remove
+ * @param p_workers_in pointer proc_dir_entry of the file /proc/ums/<tgid>/workers to remove
  */
-#define ums_proc_remove_process(p_pd_proc_in, p_pd_sched_in)    \
+#define ums_proc_remove_process(p_pd_proc_in, p_pd_sched_in, p_workers_in)    \
     do{ \
+        proc_remove(p_workers_in);  \
         proc_remove(p_pd_sched_in); \
         proc_remove(p_pd_proc_in);  \
     }while(0)
 
 /**
- * @brief add a scheduler in /proc/ums/<tgid>
+ * @brief add a scheduler in /proc/ums/<tgid>, nothing if the process has no entry in /proc/ums
  * 
+ * @param p_ums_scheduler_sl_in NON-NULL pointer to the ums_scheduler_sl, proc data of its files
  * @param p_pd_scheds_main_in pointer proc_dir_entry of the directory /proc/ums/<tgid>/schedulers
  * @param sched_id pid of the scheduler
  * @param p_pd_sched_out output, pointer proc_dir_entry of the directory /proc/ums/<tgid>/schedulers/<sched_pid> 
  * @param p_info_out output, pointer proc_dir_entry of the file "info" in /proc/ums/<tgid>/schedulers/<sched_pid> 
- * @param p_pd_workers_main_out output, pointer proc_dir_entry of the folder /proc/ums/<tgid>/schedulers/<sched_pid>/workers 
+ * @param p_latency_out output, pointer proc_dir_entry of the file "latency" in /proc/ums/<tgid>/schedulers/<sched_pid> 
  * 
  */
-#define ums_proc_add_scheduler(p_pd_scheds_main_in, sched_id, p_pd_sched_out, p_info_out, p_pd_workers_main_out)    \
+#define ums_proc_add_scheduler(p_ums_scheduler_sl_in, p_pd_scheds_main_in, sched_id, p_pd_sched_out, p_info_out, p_latency_out)    \
     do{ \
         char __buff[32];    \
+        if((p_pd_scheds_main_in) == NULL)  \
+            break;  \
         sprintf(__buff, "%d", sched_id);    \
         \
         p_pd_sched_out = proc_mkdir(__buff, p_pd_scheds_main_in);   \
-        p_info_out = proc_create("info", S_IALLUGO, p_pd_sched_out, &sched_info_ops);    \
-        p_pd_workers_main_out = proc_mkdir("workers", p_pd_sched_out);  \
+        p_info_out = proc_create_data("info", S_IALLUGO, p_pd_sched_out, &sched_info_ops, p_ums_scheduler_sl_in);    \
+        p_latency_out = proc_create_data("latency", S_IALLUGO, p_pd_sched_out, &sched_latency_ops, p_ums_scheduler_sl_in);    \
     }while(0)
 
 /**
@@ -275,39 +266,12 @@ static struct proc_ops thread_ops = {
  * 
  * @param p_pd_sched_in pointer proc_dir_entry of the directory /proc/ums/<tgid>/schedulers/<sched_pid> 
  * @param p_info_in pointer proc_dir_entry of the file "info" in /proc/ums/<tgid>/schedulers/<sched_pid> 
- * @param p_pd_workers_main_in pointer proc_dir_entry of the folder /proc/ums/<tgid>/schedulers/<sched_pid>/workers 
+ * @param p_latency_in pointer proc_dir_entry of the file "latency" in /proc/ums/<tgid>/schedulers/<sched_pid> 
  * 
  */
-#define ums_proc_remove_scheduler(p_pd_sched_in, p_info_in, p_pd_workers_main_in)  \
+#define ums_proc_remove_scheduler(p_pd_sched_in, p_info_in, p_latency_in)  \
     do{ \
-        proc_remove(p_pd_workers_main_in);  \
+        proc_remove(p_latency_in);  \
         proc_remove(p_info_in);    \
         proc_remove(p_pd_sched_in); \
     }while(0)
-
-
-/**
- * @brief add a ums_context in /proc/ums/tgid/schedulers/<pid>/workers
- * 
- * @param p_pd_workers_main_in pointer proc_dir_entry of the folder /proc/ums/<tgid>/schedulers/<sched_pid>/workers 
- * @param id_thread_in ums_context_descriptor
- * @param p_pd_thread_out output, proc_dir_entry of the file associated to ums_context in /proc/ums/tgid/schedulers/<pid>/workers
- * 
- */
-#define ums_proc_add_thread(p_pd_workers_main_in, id_thread_in, p_pd_thread_out) \
-    do{ \
-        char __buff[32];    \
-        sprintf(__buff, "%d", id_thread_in);    \
-        p_pd_thread_out = proc_create(__buff, S_IALLUGO, p_pd_workers_main_in, &thread_ops);    \
-    }while(0)
-
-/**
- * @brief remove a ums_context from /proc/ums/tgid/schedulers/<pid>/workers
- * 
- * @param p_pd_thread_in proc_dir_entry of the file associated to ums_context in /proc/ums/tgid/schedulers/<pid>/workers
- * 
- */
-#define ums_proc_remove_thread(p_pd_thread_in) \
-    do{ \
-        proc_remove(p_pd_thread_in);    \
-    }while(0)
@@ -4,17 +4,28 @@
 ///
 
 #include <linux/proc_fs.h>
+#include <linux/rcupdate.h>
+#include <linux/rculist.h>
+#include <linux/xarray.h>
+#include <linux/rhashtable.h>
 #include "ums_scheduler.h"
 
 // ums_process_t ########################################################################################
 #define UMS_PROCESS_COMPLETION_LIST_MIN_ID  0       /** Lower value for a ums_completion_list descriptor */
-#define UMS_PROCESS_COMPLETION_LIST_MAX_ID  127     /** Higher value for a ums_completion_list descriptor */
-
 #define UMS_PROCESS_UMS_CONTEXT_MIN_ID  0           /** Lower value for a ums_context descriptor */
-#define UMS_PROCESS_UMS_CONTEXT_MAX_ID  127         /** Higher value for a ums_context descriptor */
+
+extern unsigned int ums_max_completion_lists;   /** module parameter, maximum number of ums_completion_lists of a process */
+extern unsigned int ums_max_contexts;   /** module parameter, maximum number of ums_contexts of a process */
 
 #define HASHTABLE_UMS_SCHEDULERS_HASH_BITS 6    /** size of hashtable = 2^HASH_BITS */
-#define HASHTABLE_UMS_THREADS_HASH_BITS 6       /** size of hashtable = 2^HASH_BITS */
+
+/** parameters of rhashtable_ums_threads, the key of a ums_context is the pid of its thread */
+static const struct rhashtable_params ums_threads_rht_params = {
+    .key_len = sizeof(pid_t),
+    .key_offset = offsetof(ums_context_t, pid),
+    .head_offset = offsetof(ums_context_t, rhnode),
+    .automatic_shrinking = true,
+};
 
 /**
  * @brief Represent a ums_process object
@@ -23,22 +34,19 @@
 typedef struct ums_process_t{
     struct hlist_node hlist; /** field used to arrange it in the ums_hashmap */
     int key; /** key in the ums_hashtable (equals to tgid (thread id)) */
+    struct rcu_head rcu; /** used to free it after a grace period, lookups are lockless */
 
     DECLARE_HASHTABLE(hashtable_ums_schedulers, HASHTABLE_UMS_SCHEDULERS_HASH_BITS);    /** hashtable that contains schedulers, the key of as scheduler is its pid*/  
-    rwlock_t hashtable_ums_schedulers_rwlock; /** rw_spin_lock of ums_scheduler_hashtable */
+    spinlock_t hashtable_ums_schedulers_lock; /** serializes writers of ums_scheduler_hashtable, readers use RCU */
 
-    DECLARE_HASHTABLE(hashtable_ums_threads, HASHTABLE_UMS_THREADS_HASH_BITS);  /** hashtable used to map a thread to its ums_context */
-    rwlock_t hashtable_ums_threads_rwlock; /** rw_spin_lock of the ums_thraed_hashtable */
+    struct rhashtable rhashtable_ums_threads;  /** resizable hashtable used to map a thread to its ums_context, readers use RCU */
 
-
-    struct idr idr_completion_list;  /** idr struct used to allocate the ums_completion_lists managed by this process*/
-    rwlock_t idr_completion_list_rwlock;    /** rw_spin_lock of idr_completion_list */
-
-    struct idr idr_ums_context;  /** idr struct used to store ums_contexts managed by this process*/
-    rwlock_t idr_ums_context_rwlock;    /** rw_spin_lock of idr_ums_context */
+    struct xarray xa_completion_list;  /** allocates the descriptors of the ums_completion_lists managed by this process, readers use RCU */
+    struct xarray xa_ums_context;  /** allocates the descriptors of the ums_contexts managed by this process, readers use RCU */
 
     struct proc_dir_entry* proc_entry;  /** entry in /proc, corresponds to /proc/ums/<tgid> */
     struct proc_dir_entry* proc_entry_main_scheds; /** entry in /proc, corresponds to /proc/ums/<tgid>/schedulers */
+    struct proc_dir_entry* proc_entry_workers; /** entry in /proc, corresponds to /proc/ums/<tgid>/workers */
 }ums_process_t;
 
 // -------------------------------------------------------------------
@@ -47,23 +55,22 @@ typedef struct ums_process_t{
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param key_in key used in the ums_hashtable, it corresponds to <tgid>
+ * @param res_OUT output, 0 on success, otherwise -errno (the ums_process must not be used nor destroyed)
  */
-#define INIT_UMS_PROCESS(p_ums_process, key_in)		\
+#define INIT_UMS_PROCESS(p_ums_process, key_in, res_OUT)		\
 	do {						\
 		(p_ums_process)->key = key_in;    	\
         (p_ums_process)->proc_entry = NULL;  \
+        (p_ums_process)->proc_entry_main_scheds = NULL;  \
+        (p_ums_process)->proc_entry_workers = NULL;  \
         \
         hash_init((p_ums_process)->hashtable_ums_schedulers);   \
-        rwlock_init(&(p_ums_process)->hashtable_ums_schedulers_rwlock);    \
-        \
-        hash_init((p_ums_process)->hashtable_ums_threads);  \
-        rwlock_init(&(p_ums_process)->hashtable_ums_threads_rwlock);   \
+        spin_lock_init(&(p_ums_process)->hashtable_ums_schedulers_lock);    \
         \
-        idr_init(&(p_ums_process)->idr_completion_list);       \
-        rwlock_init(&(p_ums_process)->idr_completion_list_rwlock); \
+        res_OUT = rhashtable_init(&(p_ums_process)->rhashtable_ums_threads, &ums_threads_rht_params);  \
         \
-        idr_init(&(p_ums_process)->idr_ums_context);       \
-        rwlock_init(&(p_ums_process)->idr_ums_context_rwlock); \
+        xa_init_flags(&(p_ums_process)->xa_completion_list, XA_FLAGS_ALLOC);       \
+        xa_init_flags(&(p_ums_process)->xa_ums_context, XA_FLAGS_ALLOC);       \
 	} while (0)
 
 /**
@@ -73,12 +80,15 @@ typedef struct ums_process_t{
  */
 #define DESTROY_UMS_PROCESS(p_ums_process)   \
     do {    \
-        idr_destroy(&(p_ums_process)->idr_completion_list);       \
+        rhashtable_destroy(&(p_ums_process)->rhashtable_ums_threads);  \
         \
-        idr_destroy(&(p_ums_process)->idr_ums_context);       \
+        xa_destroy(&(p_ums_process)->xa_completion_list);       \
+        xa_destroy(&(p_ums_process)->xa_ums_context);       \
         \
         (p_ums_process)->key = 0;    	\
         (p_ums_process)->proc_entry = NULL;  \
+        (p_ums_process)->proc_entry_main_scheds = NULL;  \
+        (p_ums_process)->proc_entry_workers = NULL;  \
     }while(0)
 // -------------------------------------------------------------------
 
@@ -91,11 +101,11 @@ typedef struct ums_process_t{
  */
 #define ums_process_add_scheduler_sl(p_ums_process, p_ums_scheduler_sl)   \
     do{ \
-        write_lock(&((p_ums_process)->hashtable_ums_schedulers_rwlock));    \
-            hash_add(p_ums_process->hashtable_ums_schedulers, &((p_ums_scheduler_sl)->hlist), (p_ums_scheduler_sl)->key);   \
-        write_unlock(&((p_ums_process)->hashtable_ums_schedulers_rwlock));  \
+        spin_lock(&((p_ums_process)->hashtable_ums_schedulers_lock));    \
+            hash_add_rcu(p_ums_process->hashtable_ums_schedulers, &((p_ums_scheduler_sl)->hlist), (p_ums_scheduler_sl)->key);   \
+        spin_unlock(&((p_ums_process)->hashtable_ums_schedulers_lock));  \
         \
-        ums_proc_add_scheduler((p_ums_process)->proc_entry_main_scheds, (p_ums_scheduler_sl)->key, (p_ums_scheduler_sl)->proc_entry, (p_ums_scheduler_sl)->proc_entry_info, (p_ums_scheduler_sl)->proc_entry_main_workers);    \
+        ums_proc_add_scheduler(p_ums_scheduler_sl, (p_ums_process)->proc_entry_main_scheds, (p_ums_scheduler_sl)->key, (p_ums_scheduler_sl)->proc_entry, (p_ums_scheduler_sl)->proc_entry_info, (p_ums_scheduler_sl)->proc_entry_latency);    \
         \
     }while(0)
 
@@ -107,11 +117,11 @@ typedef struct ums_process_t{
  */
 #define ums_process_remove_scheduler_sl(p_ums_process, p_ums_scheduler_sl)   \
     do{ \
-        write_lock(&((p_ums_process)->hashtable_ums_schedulers_rwlock));    \
-            hash_del(&((p_ums_scheduler_sl)->hlist));   \
-        write_unlock(&((p_ums_process)->hashtable_ums_schedulers_rwlock));  \
+        spin_lock(&((p_ums_process)->hashtable_ums_schedulers_lock));    \
+            hash_del_rcu(&((p_ums_scheduler_sl)->hlist));   \
+        spin_unlock(&((p_ums_process)->hashtable_ums_schedulers_lock));  \
         \
-        ums_proc_remove_scheduler((p_ums_scheduler_sl)->proc_entry, (p_ums_scheduler_sl)->proc_entry_info, (p_ums_scheduler_sl)->proc_entry_main_workers);    \
+        ums_proc_remove_scheduler((p_ums_scheduler_sl)->proc_entry, (p_ums_scheduler_sl)->proc_entry_info, (p_ums_scheduler_sl)->proc_entry_latency);    \
         \
     }while(0)
 // -------------------------------------------------------------------
@@ -119,20 +129,18 @@ typedef struct ums_process_t{
 
 // -------------------------------------------------------------------
 /**
- * @brief register a ums_context in hashtable_ums_thread of the process
+ * @brief register a ums_context in rhashtable_ums_threads of the process
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param p_ums_context NON-NULL pointer to a ums_context to add
  */
 #define ums_process_register_ums_thread(p_ums_process, p_ums_context)   \
     do{ \
-        write_lock(&((p_ums_process)->hashtable_ums_threads_rwlock));    \
-            hash_add(p_ums_process->hashtable_ums_threads, &((p_ums_context)->hlist), (p_ums_context)->pid);   \
-        write_unlock(&((p_ums_process)->hashtable_ums_threads_rwlock));  \
+        WARN_ON_ONCE(rhashtable_insert_fast(&(p_ums_process)->rhashtable_ums_threads, &((p_ums_context)->rhnode), ums_threads_rht_params));    \
     }while(0)
 
 /**
- * @brief unregister a ums_context from hashtable_ums_thread of the process
+ * @brief unregister a ums_context from rhashtable_ums_threads of the process
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param p_ums_context NON-NULL pointer to the ums_context to remove
@@ -140,31 +148,25 @@ typedef struct ums_process_t{
  */
 #define ums_process_unregister_ums_thread(p_ums_process, p_ums_context)   \
     do{ \
-        write_lock(&((p_ums_process)->hashtable_ums_threads_rwlock));    \
-            hash_del(&((p_ums_context)->hlist));   \
-        write_unlock(&((p_ums_process)->hashtable_ums_threads_rwlock));  \
+        rhashtable_remove_fast(&(p_ums_process)->rhashtable_ums_threads, &((p_ums_context)->rhnode), ums_threads_rht_params);    \
     }while(0)
 // -------------------------------------------------------------------
 
 // -------------------------------------------------------------------
 /**
- * @brief get a ums_context from hashtable_threads of the process by its pid
+ * @brief get a ums_context from rhashtable_ums_threads of the process by its pid
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param key_in pid of the thread
  * @param p_ums_context_OUT output, pointer to a ums_context
+ * 
+ * NOTE: the lookup is lockless (RCU). A thread looks up its own ums_context, that cannot be deleted while it is assigned;
+ * any other caller must hold rcu_read_lock() while it uses the object (see ums_cache_free_rcu())
  */
 #define ums_process_get_ums_thread(p_ums_process, key_in, p_ums_context_OUT)    \
     do{ \
-    ums_context_t* current_ums_context = NULL;  \
-	read_lock(&((p_ums_process)->hashtable_ums_threads_rwlock));   \
-        /*iterate a bucket*/    \
-        hash_for_each_possible((p_ums_process)->hashtable_ums_threads, current_ums_context, hlist, key_in){    \
-            if(likely(current_ums_context && current_ums_context->pid == key_in))    break;\
-        }   \
-    read_unlock(&((p_ums_process)->hashtable_ums_threads_rwlock)); \
-    \
-    p_ums_context_OUT = (likely(current_ums_context && current_ums_context->pid == key_in)) ? current_ums_context : NULL; \
+        pid_t __key = key_in;   \
+        p_ums_context_OUT = rhashtable_lookup_fast(&(p_ums_process)->rhashtable_ums_threads, &__key, ums_threads_rht_params); \
     }while(0)
 // -----------
 
@@ -177,39 +179,116 @@ typedef struct ums_process_t{
  * @param key_in pid of the scheduler
  * @param p_ums_scheduler_sl_OUT output, pointer to a ums_scheduler_sl
  * 
+ * NOTE: the lookup is lockless, the caller must hold rcu_read_lock() while it uses the object: the object is freed
+ * after a grace period (see ums_cache_free_rcu()). Keep it also while the spin_lock of the object is held,
+ * a deleter can free it right after releasing that spin_lock
+ * 
+ * A scheduler thread that looks up its own ums_scheduler_sl needs rcu_read_lock() only for the lookup:
+ * only that thread frees it (rq_exit_ums_scheduler())
  */
 #define ums_process_get_scheduler_sl(p_ums_process, key_in, p_ums_scheduler_sl_OUT)    \
     do{ \
     ums_scheduler_sl_t* current_ums_scheduler_sl = NULL;  \
-	read_lock(&((p_ums_process)->hashtable_ums_schedulers_rwlock));   \
         /*iterate a bucket*/    \
-        hash_for_each_possible((p_ums_process)->hashtable_ums_schedulers, current_ums_scheduler_sl, hlist, key_in){    \
+        hash_for_each_possible_rcu((p_ums_process)->hashtable_ums_schedulers, current_ums_scheduler_sl, hlist, key_in){    \
             if(likely(current_ums_scheduler_sl && current_ums_scheduler_sl->key == key_in))    break;\
         }   \
-    read_unlock(&((p_ums_process)->hashtable_ums_schedulers_rwlock)); \
-    \
-    p_ums_scheduler_sl_OUT = (likely(current_ums_scheduler_sl && current_ums_scheduler_sl->key == key_in)) ? current_ums_scheduler_sl : NULL; \
+        p_ums_scheduler_sl_OUT = (likely(current_ums_scheduler_sl && current_ums_scheduler_sl->key == key_in)) ? current_ums_scheduler_sl : NULL; \
+    }while(0)
+
+/**
+ * @brief a ums_context runs again, the handoff started by its scheduler (if any) is added to latency_execute of the scheduler
+ * and its on-CPU time restarts
+ * 
+ * @param p_ums_process NON-NULL pointer to a ums_process
+ * @param p_ums_context NON-NULL pointer to the ums_context, called by its thread after schedule()
+ * 
+ * NOTE: the scheduler cannot change in the meantime, a ums_context is stolen only while it waits in a ready_list
+ */
+#define ums_process_handoff_end(p_ums_process, p_ums_context)    \
+    do{ \
+        ums_scheduler_sl_t* __ussl; \
+        u64 __start = xchg(&(p_ums_context)->handoff_start_ns, 0);  \
+        ums_context_update_run_time_resume(p_ums_context);  \
+        if(__start != 0){   \
+            rcu_read_lock();    \
+            ums_process_get_scheduler_sl(p_ums_process, READ_ONCE((p_ums_context)->pid_scheduler), __ussl);   \
+            if(likely(__ussl != NULL))  \
+                ums_latency_hist_add(&__ussl->latency_execute, ktime_get_ns() - __start);  \
+            rcu_read_unlock();  \
+        }   \
     }while(0)
 // ------------------------------------------------------------------
 
 
 // -------------------------------------------------------------------
 /**
- * @brief add a ums_context_sl to idr_ums_context of the process
+ * @brief add a ums_context_sl to xa_ums_context of the process
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param p_ums_context_sl NON-NULL pointer ums_context_sl to add
+ * 
+ * NOTE: (p_ums_context_sl)->id is negative if the process has already ums_max_contexts ums_contexts
  */
 #define ums_process_add_ums_context_sl(p_ums_process, p_ums_context_sl) \
     do{\
-        write_lock(&((p_ums_process)->idr_ums_context_rwlock));     \
-            (p_ums_context_sl)->id = idr_alloc(&((p_ums_process)->idr_ums_context), p_ums_context_sl, UMS_PROCESS_UMS_CONTEXT_MIN_ID, UMS_PROCESS_UMS_CONTEXT_MAX_ID, GFP_KERNEL); \
-            (p_ums_context_sl)->ums_context->id = (p_ums_context_sl)->id; \
-        write_unlock(&((p_ums_process)->idr_ums_context_rwlock));   \
+        u32 __id;   \
+        if(likely(xa_alloc(&((p_ums_process)->xa_ums_context), &__id, p_ums_context_sl, XA_LIMIT(UMS_PROCESS_UMS_CONTEXT_MIN_ID, READ_ONCE(ums_max_contexts) - 1), GFP_KERNEL) == 0)) \
+            (p_ums_context_sl)->id = __id;  \
+        else    \
+            (p_ums_context_sl)->id = -1;    \
+        (p_ums_context_sl)->ums_context->id = (p_ums_context_sl)->id; \
     }while(0)
 
 /**
- * @brief remove a ums_context_sl from idr_ums_context of the ums_process
+ * @brief add several ums_context_sl to xa_ums_context of the ums_process, taking its lock once
+ * 
+ * @param p_ums_process NON-NULL pointer to a ums_process
+ * @param array_ums_context_sl NON-NULL array of pointers to the ums_context_sl to add
+ * @param num number of ums_context_sl
+ * @param p_num_added output, pointer to an int, number of ums_context_sl added, in order
+ * 
+ * NOTE: it stops at the first failure, the id of the ums_context_sl not added is negative
+ */
+#define ums_process_add_ums_context_sl_batch(p_ums_process, array_ums_context_sl, num, p_num_added) \
+    do{\
+        u32 __id;   \
+        int __i;    \
+        struct xa_limit __limit = XA_LIMIT(UMS_PROCESS_UMS_CONTEXT_MIN_ID, READ_ONCE(ums_max_contexts) - 1);  \
+        *(p_num_added) = 0; \
+        xa_lock(&((p_ums_process)->xa_ums_context));    \
+        for(__i = 0; __i < (num); __i++){   \
+            if(unlikely(__xa_alloc(&((p_ums_process)->xa_ums_context), &__id, (array_ums_context_sl)[__i], __limit, GFP_KERNEL) != 0))  \
+                break;  \
+            (array_ums_context_sl)[__i]->id = __id;  \
+            (array_ums_context_sl)[__i]->ums_context->id = __id; \
+        }   \
+        xa_unlock(&((p_ums_process)->xa_ums_context));  \
+        *(p_num_added) = __i;   \
+    }while(0)
+
+/**
+ * @brief remove several ums_context_sl from xa_ums_context of the ums_process, taking its lock once
+ * 
+ * @param p_ums_process NON-NULL pointer to a ums_process
+ * @param array_ums_context_sl NON-NULL array of pointers to the ums_context_sl to remove
+ * @param num number of ums_context_sl
+ * 
+ */
+#define ums_process_remove_ums_context_sl_batch(p_ums_process, array_ums_context_sl, num) \
+    do{ \
+        int __i;    \
+        xa_lock(&((p_ums_process)->xa_ums_context));    \
+        for(__i = 0; __i < (num); __i++){   \
+            __xa_erase(&((p_ums_process)->xa_ums_context), (array_ums_context_sl)[__i]->id); \
+            (array_ums_context_sl)[__i]->id = -1;    \
+            (array_ums_context_sl)[__i]->ums_context->id = -1; \
+        }   \
+        xa_unlock(&((p_ums_process)->xa_ums_context));  \
+    }while(0)
+
+/**
+ * @brief remove a ums_context_sl from xa_ums_context of the ums_process
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param p_ums_context_sl NON-NULL pointer to the ums_context_sl to remove
@@ -217,11 +296,9 @@ typedef struct ums_process_t{
  */
 #define ums_process_remove_ums_context_sl(p_ums_process, p_ums_context_sl) \
     do{ \
-        write_lock(&((p_ums_process)->idr_ums_context_rwlock));   \
-            idr_remove(&((p_ums_process)->idr_ums_context), (p_ums_context_sl)->id); \
-            (p_ums_context_sl)->id = -1;    \
-            (p_ums_context_sl)->ums_context->id = -1; \
-        write_unlock(&((p_ums_process)->idr_ums_context_rwlock));   \
+        xa_erase(&((p_ums_process)->xa_ums_context), (p_ums_context_sl)->id); \
+        (p_ums_context_sl)->id = -1;    \
+        (p_ums_context_sl)->ums_context->id = -1; \
     }while(0)
 // -------------------------------------------------------------------
 
@@ -231,12 +308,16 @@ typedef struct ums_process_t{
  * 
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param p_ums_completion_list_sl NON-NULL pointer to the object to add
+ * 
+ * NOTE: (p_ums_completion_list_sl)->id is negative if the process has already ums_max_completion_lists ums_completion_lists
  */
 #define ums_process_add_ums_completion_list_sl(p_ums_process, p_ums_completion_list_sl) \
     do{\
-        write_lock(&((p_ums_process)->idr_completion_list_rwlock));     \
-            (p_ums_completion_list_sl)->id = idr_alloc(&((p_ums_process)->idr_completion_list), p_ums_completion_list_sl, UMS_PROCESS_COMPLETION_LIST_MIN_ID, UMS_PROCESS_COMPLETION_LIST_MAX_ID, GFP_KERNEL); \
-        write_unlock(&((p_ums_process)->idr_completion_list_rwlock));   \
+        u32 __id;   \
+        if(likely(xa_alloc(&((p_ums_process)->xa_completion_list), &__id, p_ums_completion_list_sl, XA_LIMIT(UMS_PROCESS_COMPLETION_LIST_MIN_ID, READ_ONCE(ums_max_completion_lists) - 1), GFP_KERNEL) == 0)) \
+            (p_ums_completion_list_sl)->id = __id;  \
+        else    \
+            (p_ums_completion_list_sl)->id = -1;    \
     }while(0)
 
 /**
@@ -247,10 +328,8 @@ typedef struct ums_process_t{
  */
 #define ums_process_remove_ums_completion_list_sl(p_ums_process, p_ums_completion_list_sl) \
     do{\
-        write_lock(&((p_ums_process)->idr_completion_list_rwlock));     \
-            idr_remove(&((p_ums_process)->idr_completion_list), (p_ums_completion_list_sl)->id); \
-            (p_ums_completion_list_sl)->id = -1;    \
-        write_unlock(&((p_ums_process)->idr_completion_list_rwlock));   \
+        xa_erase(&((p_ums_process)->xa_completion_list), (p_ums_completion_list_sl)->id); \
+        (p_ums_completion_list_sl)->id = -1;    \
     }while(0)
 // -------------------------------------------------------------------
 
@@ -261,12 +340,14 @@ typedef struct ums_process_t{
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param id ums_completion_list_sl descriptor
  * @param p_ums_completion_list_sl_OUT output, pointer object to get
+ * 
+ * NOTE: the lookup is lockless, the caller must hold rcu_read_lock() while it uses the object: the object is freed
+ * after a grace period (see ums_cache_free_rcu()). Keep it also while the spin_lock of the object is held,
+ * a deleter can free it right after releasing that spin_lock
  */
 #define ums_process_get_ums_completion_list_sl(p_ums_process, id, p_ums_completion_list_sl_OUT) \
     do{ \
-        read_lock(&((p_ums_process)->idr_completion_list_rwlock));     \
-            p_ums_completion_list_sl_OUT = idr_find(&((p_ums_process)->idr_completion_list), id); \
-        read_unlock(&((p_ums_process)->idr_completion_list_rwlock));   \
+        p_ums_completion_list_sl_OUT = ((id) < 0) ? NULL : xa_load(&((p_ums_process)->xa_completion_list), id); \
     }while(0)
 // ------------------------------------------------------------------
 
@@ -277,12 +358,14 @@ typedef struct ums_process_t{
  * @param p_ums_process NON-NULL pointer to a ums_process
  * @param id ums_context descriptor
  * @param p_ums_context_sl_OUT output, pointer object to get
+ * 
+ * NOTE: the lookup is lockless, the caller must hold rcu_read_lock() while it uses the object: the object is freed
+ * after a grace period (see ums_cache_free_rcu()). Keep it also while the spin_lock of the object is held,
+ * a deleter can free it right after releasing that spin_lock
  */
 #define ums_process_get_ums_context_sl(p_ums_process, id, p_ums_context_sl_OUT) \
     do{ \
-        read_lock(&((p_ums_process)->idr_ums_context_rwlock));     \
-            p_ums_context_sl_OUT = idr_find(&((p_ums_process)->idr_ums_context), id); \
-        read_unlock(&((p_ums_process)->idr_ums_context_rwlock));   \
+        p_ums_context_sl_OUT = ((id) < 0) ? NULL : xa_load(&((p_ums_process)->xa_ums_context), id); \
     }while(0)
 // ------------------------------------------------------------------
 
@@ -296,6 +379,8 @@ typedef struct ums_process_t{
  */
 static inline int printk_ums_process(ums_process_t* ums_process){
     idr_for_each_handler_arg_t args;
+    unsigned long index;
+    void* entry;
   
 
     char* __buff_hashtable = kmalloc(8192, GFP_KERNEL);    
@@ -316,8 +401,8 @@ static inline int printk_ums_process(ums_process_t* ums_process){
             ums_process->key
     );
 
-    read_lock(&ums_process->hashtable_ums_schedulers_rwlock);
-        hash_for_each(ums_process->hashtable_ums_schedulers, current_bucket, current_item, hlist){
+    rcu_read_lock();
+        hash_for_each_rcu(ums_process->hashtable_ums_schedulers, current_bucket, current_item, hlist){
             if((k = snprintf_ums_scheduler_sl(__buff_sched_sl, 8192, current_item)) >8192-4)
                 printk(KERN_DEBUG "\n snprintf_ums_process() overflow!!!\n");  
             
@@ -332,7 +417,7 @@ static inline int printk_ums_process(ums_process_t* ums_process){
             );
             //printk("offset=%d\n", offset_buff);
         }  
-    read_unlock(&ums_process->hashtable_ums_schedulers_rwlock);
+    rcu_read_unlock();
 
     if(offset_buff == 0){
         __buff_hashtable[0] = '\n';
@@ -345,30 +430,28 @@ static inline int printk_ums_process(ums_process_t* ums_process){
     );
 
     printk(KERN_DEBUG 
-            "\tidr_completion_list=\n\t{\n"
+            "\txa_completion_list=\n\t{\n"
     );
 
     args.buff = __buff_idr_completion;
     args.buff_size = 8192;
     args.offset = 0;
-    read_lock(&ums_process->idr_completion_list_rwlock);
-        idr_for_each(&ums_process->idr_completion_list, &idr_ums_completion_list_for_each_handler, &args);
-    read_unlock(&ums_process->idr_completion_list_rwlock);
+    xa_for_each(&ums_process->xa_completion_list, index, entry)
+        idr_ums_completion_list_for_each_handler(index, entry, &args);
     if(args.offset > args.buff_size-4)    printk(KERN_DEBUG "\n snprintf_ums_process() overflow!!!\n");   
 
     printk(KERN_DEBUG 
             "\t}\n"
     );
     printk(KERN_DEBUG 
-            "\tidr_ums_context=\n\t{\n"
+            "\txa_ums_context=\n\t{\n"
     );
 
     args.buff = __buff_idr_context;
     args.buff_size = 8192;
     args.offset = 0;
-    read_lock(&ums_process->idr_ums_context_rwlock);
-        idr_for_each(&ums_process->idr_ums_context, &idr_ums_context_for_each_handler, &args);
-    read_unlock(&ums_process->idr_ums_context_rwlock);
+    xa_for_each(&ums_process->xa_ums_context, index, entry)
+        idr_ums_context_for_each_handler(index, entry, &args);
     if(args.offset > args.buff_size-4)    printk(KERN_DEBUG "\n snprintf_ums_process() overflow!!!\n");   
 
     printk(KERN_DEBUG 
@@ -0,0 +1,213 @@
+#include "ums_ring.h"
+#include "ums_hashtable.h"
+#include "ums_proc.h"
+#include "rq_ums_context.h"
+#include "rq_ums_completion_list.h"
+#include "rq_ums_scheduler.h"
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+// ---------------------------------------------------------------------------------------------
+static void ums_ring_release(struct kref* kref){
+    ums_ring_t* ums_ring = container_of(kref, ums_ring_t, kref);
+
+    vfree(ums_ring->shared);
+    kfree(ums_ring);
+}
+
+static ums_ring_t* ums_ring_create(void){
+    ums_ring_t* ums_ring = kmalloc(sizeof(*ums_ring), GFP_KERNEL);
+
+    if(unlikely(ums_ring == NULL))
+        return NULL;
+
+    ums_ring->shared = vmalloc_user(sizeof(ums_ring_shared_t));    // zeroed
+    if(unlikely(ums_ring->shared == NULL)){
+        kfree(ums_ring);
+        return NULL;
+    }
+
+    kref_init(&ums_ring->kref);
+    spin_lock_init(&ums_ring->cq_spin_lock);
+    ums_ring->sq_head = 0;
+    return ums_ring;
+}
+
+void ums_ring_put(ums_ring_t* ums_ring){
+    kref_put(&ums_ring->kref, ums_ring_release);
+}
+// ---------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------
+static void ums_ring_vm_open(struct vm_area_struct* vma){
+    kref_get(&((ums_ring_t*)vma->vm_private_data)->kref);
+}
+
+static void ums_ring_vm_close(struct vm_area_struct* vma){
+    ums_ring_put((ums_ring_t*)vma->vm_private_data);
+}
+
+static const struct vm_operations_struct ums_ring_vm_ops = {
+    .open = ums_ring_vm_open,
+    .close = ums_ring_vm_close,
+};
+
+int ums_ring_mmap(ums_process_t* ums_process, struct vm_area_struct* vma){
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+    ums_ring_t* ums_ring;
+    int ret;
+
+    if(unlikely(vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_ALIGN(sizeof(ums_ring_shared_t))))
+        return -EINVAL;
+
+    // only a scheduler has a ums_ring, and only its thread sets it
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, current->pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL || ums_scheduler_sl->ums_scheduler == NULL))
+        return -EINVAL;
+    if(unlikely(ums_scheduler_sl->ums_scheduler->ring != NULL))
+        return -EBUSY;
+
+    ums_ring = ums_ring_create();
+    if(unlikely(ums_ring == NULL))
+        return -ENOMEM;
+
+    ret = remap_vmalloc_range(vma, ums_ring->shared, 0);
+    if(unlikely(ret != 0)){
+        ums_ring_put(ums_ring);
+        return ret;
+    }
+
+    // a reference for the mapping, the one of ums_ring_create() is given to the scheduler
+    kref_get(&ums_ring->kref);
+    vma->vm_private_data = ums_ring;
+    vma->vm_ops = &ums_ring_vm_ops;
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(likely(ums_scheduler != NULL)){
+        ums_scheduler->ring = ums_ring;
+        ums_ring = NULL;
+    }
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+
+    if(unlikely(ums_ring != NULL))
+        ums_ring_put(ums_ring);
+    return 0;
+}
+// ---------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------
+void ums_ring_post_cqe(ums_ring_t* ums_ring, int kind, int res, int ucd, int opcode, u64 user_data){
+    ums_ring_shared_t* shared = ums_ring->shared;
+    ums_cqe_t* cqe;
+    unsigned int tail;
+
+    spin_lock(&ums_ring->cq_spin_lock);
+
+    tail = shared->cq_tail;
+    if(unlikely(tail - smp_load_acquire(&shared->cq_head) >= UMS_RING_CQ_ENTRIES)){
+        WRITE_ONCE(shared->cq_overflow, shared->cq_overflow + 1);
+        spin_unlock(&ums_ring->cq_spin_lock);
+        return;
+    }
+
+    cqe = &shared->cqes[tail & (UMS_RING_CQ_ENTRIES - 1)];
+    cqe->kind = kind;
+    cqe->res = res;
+    cqe->ucd = ucd;
+    cqe->opcode = opcode;
+    cqe->user_data = user_data;
+    smp_store_release(&shared->cq_tail, tail + 1);
+
+    spin_unlock(&ums_ring->cq_spin_lock);
+}
+
+/**
+ * @brief execute a sqe as the corresponding request
+ *
+ * @param ums_process ums_process of the scheduler
+ * @param sqe NON-NULL pointer to a copy of the sqe, the user cannot change it
+ * @param p_ucd output, descriptor of the new ums_context for UMS_SQE_CREATE_UMS_CONTEXT, otherwise the one of the sqe
+ * @param can_lock false if the requests that take the spin_lock of a scheduler cannot be executed
+ *
+ * @return Returns 0 on sucess, otherwise -errno
+ */
+static int ums_ring_execute_sqe(ums_process_t* ums_process, const ums_sqe_t* sqe, int* p_ucd, bool can_lock){
+    rq_create_delete_ums_context_args_t create_args;
+    rq_completion_list_add_remove_ums_context_args_t add_args;
+    rq_set_ums_context_prio_args_t prio_args;
+    info_ums_context_t info;
+    int ret;
+
+    *p_ucd = sqe->ucd;
+
+    switch(sqe->opcode){
+        case UMS_SQE_NOP:
+            return 0;
+
+        case UMS_SQE_CREATE_UMS_CONTEXT:
+            create_args.tgid = current->tgid;
+            create_args.descriptor = -1;
+            create_args.routine = sqe->routine;
+            create_args.args = sqe->args;
+            create_args.user_res = sqe->user_res;
+            create_args.cpu_core = -1;
+            create_args.prio = sqe->prio;
+            ret = rq_create_ums_context_san(ums_process, &create_args);
+            *p_ucd = create_args.descriptor;
+            return ret;
+
+        case UMS_SQE_COMPLETION_LIST_ADD:
+            add_args.tgid = current->tgid;
+            add_args.completion_list_d = sqe->cld;
+            add_args.ums_context_d = sqe->ucd;
+            return rq_completion_list_add_ums_context_san(ums_process, add_args);
+
+        case UMS_SQE_SET_PRIO:
+            if(unlikely(!can_lock))
+                return -EBUSY;
+            prio_args.ucd = sqe->ucd;
+            prio_args.prio = sqe->prio;
+            return rq_set_ums_context_prio_san(ums_process, prio_args);
+
+        case UMS_SQE_EXECUTE_READY:
+            if(unlikely(!can_lock))
+                return -EBUSY;
+            memset(&info, 0, sizeof(info));
+            info.ucd = sqe->ucd;
+            info.from_cl = false;
+            return rq_execute_ready_list_san(ums_process, info);
+
+        default:
+            return -EINVAL;
+    }
+}
+
+int ums_ring_submit(ums_process_t* ums_process, ums_ring_t* ums_ring, unsigned int to_submit, bool can_lock){
+    ums_ring_shared_t* shared = ums_ring->shared;
+    unsigned int head = ums_ring->sq_head;
+    unsigned int tail = smp_load_acquire(&shared->sq_tail);
+    unsigned int num, i;
+    ums_sqe_t sqe;
+    int ucd;
+    int res;
+
+    if(unlikely(tail - head > UMS_RING_SQ_ENTRIES))
+        return -EINVAL; // sq_tail has been corrupted
+
+    num = min(tail - head, to_submit);
+    for(i = 0; i < num; i++, head++){
+        sqe = shared->sqes[head & (UMS_RING_SQ_ENTRIES - 1)];
+        res = ums_ring_execute_sqe(ums_process, &sqe, &ucd, can_lock);
+        if(sqe.opcode == UMS_SQE_EXECUTE_READY && res == 0)
+            can_lock = false;   // the ums_context executed may hand back at any time
+        ums_ring_post_cqe(ums_ring, UMS_CQE_COMPLETION, res, ucd, sqe.opcode, sqe.user_data);
+    }
+
+    ums_ring->sq_head = head;
+    smp_store_release(&shared->sq_head, head);
+    return num;
+}
+// ---------------------------------------------------------------------------------------------
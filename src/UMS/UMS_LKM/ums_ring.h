@@ -0,0 +1,83 @@
+#pragma once
+/// @file
+/// This file contains the ums_ring of a scheduler, the submission and completion queues shared with the user
+/// (see ../common/ums_ring.h)
+///
+
+#include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/spinlock.h>
+#include <linux/mm.h>
+
+#include "../common/ums_ring.h"
+
+struct ums_process_t;
+
+/**
+ * @brief ums_ring of a ums_scheduler
+ *
+ */
+typedef struct ums_ring_t{
+    struct kref kref;   /** held by the ums_scheduler and by the mapping of its thread */
+    spinlock_t cq_spin_lock;    /** serializes the producers of the completion queue */
+    unsigned int sq_head;   /** private copy of shared->sq_head, the user cannot move it */
+    ums_ring_shared_t* shared;  /** vmalloc_user() memory, mapped by the thread of the scheduler */
+}ums_ring_t;
+
+/**
+ * @brief release a reference of the ums_ring, the last one frees it
+ *
+ * @param ums_ring NON-NULL pointer to the ums_ring
+ */
+void ums_ring_put(ums_ring_t* ums_ring);
+
+/**
+ * @brief mmap() handler of /dev/UMS, creates the ums_ring of the calling scheduler and maps it
+ *
+ * @param ums_process ums_process bound to the file
+ * @param vma offset 0 and size of ums_ring_shared_t rounded up to the page size
+ *
+ * @return Returns 0 on sucess, otherwise -errno (-EBUSY if the scheduler already has a ums_ring)
+ */
+int ums_ring_mmap(struct ums_process_t* ums_process, struct vm_area_struct* vma);
+
+/**
+ * @brief add an entry to the completion queue, it is dropped (and cq_overflow incremented) if the queue is full
+ *
+ * @param ums_ring NON-NULL pointer to the ums_ring
+ * @param kind UMS_CQE_COMPLETION or UMS_CQE_EVENT
+ * @param res result of the sqe or reason of the event
+ * @param ucd descriptor of the ums_context
+ * @param opcode opcode of the sqe
+ * @param user_data user_data of the sqe
+ *
+ * NOTE: it can be called with the spin_lock of the scheduler held
+ */
+void ums_ring_post_cqe(ums_ring_t* ums_ring, int kind, int res, int ucd, int opcode, u64 user_data);
+
+/**
+ * @brief consume the entries of the submission queue, the result of each one is posted in the completion queue
+ *
+ * @param ums_process ums_process of the scheduler
+ * @param ums_ring NON-NULL pointer to the ums_ring of the calling scheduler
+ * @param to_submit maximum number of entries to consume
+ * @param can_lock false if the scheduler must not take its spin_lock (see ums_scheduler_t.dispatched),
+ *                  then UMS_SQE_SET_PRIO and UMS_SQE_EXECUTE_READY fail with -EBUSY
+ *
+ * @return Returns the number of entries consumed, otherwise -errno
+ * NOTE: only the thread of the scheduler can call it, the entries are executed as its requests
+ */
+int ums_ring_submit(struct ums_process_t* ums_process, ums_ring_t* ums_ring, unsigned int to_submit, bool can_lock);
+
+/**
+ * @brief post an event of a ums_context (REASON_THREAD_*) in the ums_ring, if any
+ *
+ * @param p_ums_ring pointer to the ums_ring, it can be NULL
+ * @param reason_in reason of the event
+ * @param ucd_in descriptor of the ums_context
+ */
+#define ums_ring_post_event(p_ums_ring, reason_in, ucd_in)    \
+    do{ \
+        if((p_ums_ring) != NULL)    \
+            ums_ring_post_cqe(p_ums_ring, UMS_CQE_EVENT, reason_in, ucd_in, UMS_SQE_NOP, 0);    \
+    }while(0)
@@ -13,6 +13,8 @@
 #include <stdbool.h>
 #include <linux/list.h>
 #include <linux/rwlock.h>
+#include <linux/rcupdate.h>
+#include <linux/cache.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/init.h>
@@ -25,8 +27,83 @@
 
 #include "ums_context.h"
 #include "ums_completion_lsit.h"
+#include "ums_ring.h"
+#include "ums_state.h"
+#include "ums_latency.h"
 
 #include <linux/proc_fs.h>
+#include <linux/bitmap.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+
+
+// ums_ready_queue_t ########################################################################################
+/**
+ * @brief ready ums_contexts arranged by priority, one FIFO list for each priority level
+ * 
+ * A bit of bitmap is set if and only if the list of that priority is not empty,
+ * so the highest priority ums_context is found in O(1) (UMS_PRIO_NUM is a small constant)
+ */
+typedef struct ums_ready_queue_t{
+    DECLARE_BITMAP(bitmap, UMS_PRIO_NUM);   /** non-empty priority levels */
+    struct list_head queue[UMS_PRIO_NUM];   /** lists of ums_context linked by their prio_list field */
+}ums_ready_queue_t;
+
+// -------------------------------------------------------------------
+/**
+ * @brief ums_ready_queue constructor
+ * 
+ * @param p_ums_ready_queue NON-NULL pointer to the object to init
+ */
+#define INIT_UMS_READY_QUEUE(p_ums_ready_queue)    \
+    do{ \
+        int __prio; \
+        bitmap_zero((p_ums_ready_queue)->bitmap, UMS_PRIO_NUM);    \
+        for(__prio = 0; __prio < UMS_PRIO_NUM; __prio++)    \
+            INIT_LIST_HEAD(&(p_ums_ready_queue)->queue[__prio]);    \
+    }while(0)
+
+/**
+ * @brief add a ums_context to the tail of the list of its priority
+ * 
+ * @param p_ums_ready_queue NON-NULL pointer to the ums_ready_queue
+ * @param p_ums_context NON-NULL pointer to the ums_context to add
+ */
+#define ums_ready_queue_add(p_ums_ready_queue, p_ums_context)  \
+    do{ \
+        list_add_tail(&((p_ums_context)->prio_list), &((p_ums_ready_queue)->queue[(p_ums_context)->prio]));  \
+        __set_bit((p_ums_context)->prio, (p_ums_ready_queue)->bitmap);   \
+    }while(0)
+
+/**
+ * @brief remove a ums_context from the ums_ready_queue
+ * 
+ * @param p_ums_ready_queue NON-NULL pointer to the ums_ready_queue
+ * @param p_ums_context NON-NULL pointer to the ums_context to remove, its prio must not be changed since it was added
+ */
+#define ums_ready_queue_remove(p_ums_ready_queue, p_ums_context)  \
+    do{ \
+        list_del_init(&((p_ums_context)->prio_list));  \
+        if(list_empty(&((p_ums_ready_queue)->queue[(p_ums_context)->prio])))  \
+            __clear_bit((p_ums_context)->prio, (p_ums_ready_queue)->bitmap);   \
+    }while(0)
+
+/**
+ * @brief get, without removing it, the first ums_context of the highest priority
+ * 
+ * @param p_ums_ready_queue NON-NULL pointer to the ums_ready_queue
+ * @param p_ums_context_OUT output, pointer to a ums_context, NULL if the ums_ready_queue is empty
+ */
+#define ums_ready_queue_peek_highest_prio(p_ums_ready_queue, p_ums_context_OUT)  \
+    do{ \
+        unsigned long __prio = find_first_bit((p_ums_ready_queue)->bitmap, UMS_PRIO_NUM);  \
+        if(likely(__prio < UMS_PRIO_NUM))  \
+            p_ums_context_OUT = list_first_entry(&((p_ums_ready_queue)->queue[__prio]), ums_context_t, prio_list);   \
+        else    \
+            p_ums_context_OUT = NULL;   \
+    }while(0)
+// -------------------------------------------------------------------
+// ######################################################################################################
 
 
 // ums_scheduler_t ########################################################################################
@@ -38,18 +115,37 @@ typedef struct ums_scheduler_t{
     void* scheduler_task_struct;    /** task_struct of the scheduler thread */
    
     ums_completion_list_sl_t* completion_list; /** ums_completion_list managed */
-    struct list_head* current_completion_list_item; /** current ums_completion_list_item during navigation of the ums_completion_list*/
+    struct list_head* current_completion_list_item; /** cl_list of the current ums_context_sl during navigation of the ums_completion_list*/
 
     struct list_head ready_list;    /** ready list of the scheduler */
     struct list_head* current_ready_list_item; /** current ums_context during navigation of ready_list*/
+    int num_ready;  /** number of ums_contexts in ready_list */
+    ums_ready_queue_t ready_queue;  /** the same ums_contexts of ready_list, arranged by priority */
 
     ums_context_t* running_thread; /** pointer to the current ums_context in execution*/
+    bool dispatched;    /** a ums_context has been executed since the last scheduler call. Until the scheduler sleeps again it must not
+                            take its own spin_lock: the ums_context that hands back spins on its wake up holding it */
 
     entry_point_args_t* entry_point_args; /** args of the entry_point function of the scheduler*/
 
     int num_switch; /** number of scheduler calls*/
 
     int cpu_core;   /** CPU core used */
+
+    int num_steal_attempts; /** number of times the ready_list was empty and a sibling has been searched */
+    int num_steals; /** number of ums_contexts stolen from siblings */
+    int num_stolen; /** number of ums_contexts stolen by siblings */
+
+    u64 quantum_ns; /** time slice of a ums_context before it is preempted, 0 to disable the preemption */
+    struct hrtimer quantum_timer;   /** expires at the end of the quantum of running_thread */
+    ums_context_t* quantum_context; /** ums_context whose quantum is measured by quantum_timer, NULL if none */
+    unsigned int quantum_seq;   /** incremented at each start of quantum_timer */
+    int num_preemptions;    /** number of ums_contexts preempted at the end of their quantum */
+
+    int num_parks;  /** number of times it has been parked on the idle_wait_queue of its ums_completion_list */
+
+    ums_ring_t* ring;   /** submission and completion queues shared with the thread of the scheduler, NULL if not mapped */
+    ums_state_t* state; /** state page of the ready_list, linked to the one of the ums_completion_list. NULL if not mapped */
 }ums_scheduler_t;
 
 // -------------------------------------------------------------------
@@ -69,10 +165,29 @@ typedef struct ums_scheduler_t{
         \
         INIT_LIST_HEAD(&(p_ums_scheduler)->ready_list); \
         (p_ums_scheduler)->current_ready_list_item = NULL;  \
+        (p_ums_scheduler)->num_ready = 0;  \
+        INIT_UMS_READY_QUEUE(&(p_ums_scheduler)->ready_queue);  \
         \
         (p_ums_scheduler)->running_thread = NULL;   \
+        (p_ums_scheduler)->dispatched = false;  \
         (p_ums_scheduler)->num_switch = 0;   \
         (p_ums_scheduler)->cpu_core = -1;   \
+        \
+        (p_ums_scheduler)->num_steal_attempts = 0;   \
+        (p_ums_scheduler)->num_steals = 0;   \
+        (p_ums_scheduler)->num_stolen = 0;   \
+        \
+        (p_ums_scheduler)->quantum_ns = 0;   \
+        hrtimer_init(&(p_ums_scheduler)->quantum_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);  \
+        (p_ums_scheduler)->quantum_timer.function = ums_scheduler_quantum_expired;  \
+        (p_ums_scheduler)->quantum_context = NULL;   \
+        (p_ums_scheduler)->quantum_seq = 0;   \
+        (p_ums_scheduler)->num_preemptions = 0;   \
+        \
+        (p_ums_scheduler)->num_parks = 0;   \
+        \
+        (p_ums_scheduler)->ring = NULL;   \
+        (p_ums_scheduler)->state = NULL;   \
     }while(0)
 
 /**
@@ -88,23 +203,65 @@ typedef struct ums_scheduler_t{
         (p_ums_scheduler)->current_completion_list_item = NULL; \
         \
         (p_ums_scheduler)->current_ready_list_item = NULL;  \
+        (p_ums_scheduler)->num_ready = 0;  \
         \
         (p_ums_scheduler)->running_thread = NULL;   \
         (p_ums_scheduler)->num_switch = 0;   \
         (p_ums_scheduler)->cpu_core = -1;   \
+        \
+        if((p_ums_scheduler)->ring != NULL){    \
+            ums_ring_put((p_ums_scheduler)->ring);  \
+            (p_ums_scheduler)->ring = NULL; \
+        }   \
+        if((p_ums_scheduler)->state != NULL){    \
+            ums_state_put((p_ums_scheduler)->state);  \
+            (p_ums_scheduler)->state = NULL; \
+        }   \
     }while(0)
 // -------------------------------------------------------------------
 
 // -------------------------------------------------------------------
+/**
+ * @brief rewrite the state page of the ready list, if mapped
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the scheduler, its spin_lock must be held
+ */
+#define ums_scheduler_state_update(p_ums_scheduler) \
+    do{ \
+        ums_state_list_t* __shared; \
+        ums_context_t* __uc;    \
+        int __n = 0;    \
+        if((p_ums_scheduler)->state != NULL){ \
+            __shared = (p_ums_scheduler)->state->shared;  \
+            ums_state_write_begin(__shared);    \
+            list_for_each_entry(__uc, &((p_ums_scheduler)->ready_list), list){  \
+                if(unlikely(__n == UMS_STATE_LIST_MAX)) \
+                    break;  \
+                ums_state_fill_context(&__shared->contexts[__n], __uc);   \
+                __n++;  \
+            }   \
+            WRITE_ONCE(__shared->num, (p_ums_scheduler)->num_ready); \
+            WRITE_ONCE(__shared->num_shown, __n);  \
+            ums_state_write_end(__shared);  \
+        }   \
+    }while(0)
+
 /**
  * @brief add a ums_context to ready list of the scheduler 
  * 
+ * A scheduler parked on the ums_completion_list is woken up, it may be the owner or a sibling that can steal it
+ * 
  * @param p_ums_scheduler NON-NULL pointer to the scheduler
  * @param p_ums_context NON-NULL pointer to the ums_context to add
  */
 #define ums_scheduler_ready_list_add(p_ums_scheduler, p_ums_context) \
     do{ \
         list_add_tail(&((p_ums_context)->list), &((p_ums_scheduler)->ready_list));  \
+        ums_ready_queue_add(&((p_ums_scheduler)->ready_queue), p_ums_context);  \
+        (p_ums_scheduler)->num_ready += 1;  \
+        ums_context_update_ready_wait_start(p_ums_context); \
+        ums_scheduler_state_update(p_ums_scheduler);    \
+        ums_completion_list_wake_up_idle((p_ums_scheduler)->completion_list);   \
     }while(0)
 
 /**
@@ -116,6 +273,10 @@ typedef struct ums_scheduler_t{
 #define ums_scheduler_ready_list_remove(p_ums_scheduler, p_ums_context) \
     do{ \
         list_del(&((p_ums_context)->list));  \
+        ums_ready_queue_remove(&((p_ums_scheduler)->ready_queue), p_ums_context);  \
+        (p_ums_scheduler)->num_ready -= 1;  \
+        ums_context_update_ready_wait_end(p_ums_context); \
+        ums_scheduler_state_update(p_ums_scheduler);    \
     }while(0)
 // -------------------------------------------------------------------
 
@@ -130,7 +291,39 @@ typedef struct ums_scheduler_t{
     do{ \
         p_ums_context_OUT = list_first_entry_or_null(&(p_ums_scheduler)->ready_list, ums_context_t, list);    \
         if(likely((p_ums_context_OUT) != NULL))   \
-            list_del(&((p_ums_context_OUT)->list));  \
+            ums_scheduler_ready_list_remove(p_ums_scheduler, p_ums_context_OUT);  \
+    }while(0)
+
+/**
+ * @brief remove the ums_context with the highest priority from the ready list, FIFO among the same priority
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the scheduler
+ * @param p_ums_context_OUT output, pointer to a ums_context, NULL if the ready list is empty
+ */
+#define ums_scheduler_ready_list_remove_highest_prio(p_ums_scheduler, p_ums_context_OUT) \
+    do{ \
+        ums_ready_queue_peek_highest_prio(&((p_ums_scheduler)->ready_queue), p_ums_context_OUT);    \
+        if(likely((p_ums_context_OUT) != NULL))   \
+            ums_scheduler_ready_list_remove(p_ums_scheduler, p_ums_context_OUT);  \
+    }while(0)
+
+/**
+ * @brief change the priority of a ums_context managed by the scheduler, it is moved if it waits in the ready list
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the scheduler, its spin_lock must be held
+ * @param p_ums_context NON-NULL pointer to the ums_context
+ * @param prio_in new priority
+ */
+#define ums_scheduler_set_prio(p_ums_scheduler, p_ums_context, prio_in) \
+    do{ \
+        if(list_empty(&((p_ums_context)->prio_list)))  \
+            (p_ums_context)->prio = prio_in;    \
+        else{   \
+            ums_ready_queue_remove(&((p_ums_scheduler)->ready_queue), p_ums_context);   \
+            (p_ums_context)->prio = prio_in;    \
+            ums_ready_queue_add(&((p_ums_scheduler)->ready_queue), p_ums_context);  \
+            ums_scheduler_state_update(p_ums_scheduler);    \
+        }   \
     }while(0)
 // --------------------------------------------------------------------------------
 
@@ -139,7 +332,7 @@ typedef struct ums_scheduler_t{
  * @brief start to iterate the completion_list
  * 
  * @param p_ums_scheduler NON-NULL pointer to the scheduler
- * @param p_ums_completion_list_item_out output, pointer to ums_completion_item. it's NULL if the list ends
+ * @param p_ums_completion_list_item_out output, pointer to ums_context_sl. it's NULL if the list ends
  * 
  */
 #define ums_scheduler_completion_list_start_iteration(p_ums_scheduler, p_ums_completion_list_item_out)  \
@@ -149,7 +342,7 @@ typedef struct ums_scheduler_t{
         if(unlikely(list_empty(&((p_ums_scheduler)->completion_list->ums_context_list)))) \
             p_ums_completion_list_item_out = NULL;  \
         else    \
-            p_ums_completion_list_item_out = list_entry((p_ums_scheduler)->current_completion_list_item, ums_completion_list_item_t, list);    \
+            p_ums_completion_list_item_out = list_entry((p_ums_scheduler)->current_completion_list_item, ums_context_sl_t, cl_list);    \
     }while(0)
 
 /**
@@ -166,17 +359,17 @@ typedef struct ums_scheduler_t{
 
 
 /**
- * @brief get next ums_completion_list_item during navigation
+ * @brief get next ums_context_sl during navigation
  * 
  * @param p_ums_scheduler NON-NULL pointer to the scheduler
- * @param p_ums_completion_list_item_out output, pointer to ums_completion_item, return null at the end of the list
+ * @param p_ums_completion_list_item_out output, pointer to ums_context_sl, return null at the end of the list
  * 
  */
 #define ums_scheduler_completion_list_iterate(p_ums_scheduler, p_ums_completion_list_item_out)  \
     do{ \
         (p_ums_scheduler)->current_completion_list_item = (p_ums_scheduler)->current_completion_list_item->next;    \
         if(likely((p_ums_scheduler)->current_completion_list_item != &((p_ums_scheduler)->completion_list->ums_context_list)))  \
-            p_ums_completion_list_item_out = list_entry((p_ums_scheduler)->current_completion_list_item, ums_completion_list_item_t, list);    \
+            p_ums_completion_list_item_out = list_entry((p_ums_scheduler)->current_completion_list_item, ums_context_sl_t, cl_list);    \
         else p_ums_completion_list_item_out = NULL; \
     }while(0)
 
@@ -255,13 +448,21 @@ typedef struct ums_scheduler_t{
 typedef struct ums_scheduler_sl_t{
     struct hlist_node hlist;    /** used to arrange in the hashtable of process' schedulers */
     int key; /** key in the hashtable, corresponds to scheduler's pid*/
+    struct rcu_head rcu; /** used to free it after a grace period */
 
-    spinlock_t ums_scheduler_spin_lock; /** protect ums_scheduler */
+    spinlock_t ums_scheduler_spin_lock ____cacheline_aligned_in_smp; /** protect ums_scheduler */
     ums_scheduler_t* ums_scheduler; /** pointer to the scheduler to protect */
 
+    struct list_head siblings;  /** used to arrange it in the schedulers of its ums_completion_list */
+    ums_completion_list_sl_t* completion_list;  /** ums_completion_list used to find the siblings, NULL if detached */
+
     struct proc_dir_entry* proc_entry; /** entry in /proc, corresponds to /proc/ums/<tgid>/schedulers/<pid> */
     struct proc_dir_entry* proc_entry_info; /** entry in /proc, corresponds to /proc/ums/<tgid>/schedulers/<pid>/info */
-    struct proc_dir_entry* proc_entry_main_workers; /** entry in /proc, corresponds to /proc/ums/<tgid>/schedulers/<pid>/workers */
+    struct proc_dir_entry* proc_entry_latency; /** entry in /proc, corresponds to /proc/ums/<tgid>/schedulers/<pid>/latency */
+
+    u64 handoff_start_ns;   /** set when a ums_context gives the control back to the scheduler (yield, end, preemption), 0 if none */
+    ums_latency_hist_t latency_wake;    /** from the wake up of the scheduler by a ums_context to the scheduler running */
+    ums_latency_hist_t latency_execute; /** from the wake up of a ums_context of the ready_list to the ums_context running */
 }ums_scheduler_sl_t;
 
 // -------------------------------------------------------------------
@@ -279,9 +480,16 @@ typedef struct ums_scheduler_sl_t{
         \
         (p_ums_scheduler_sl)->ums_scheduler = p_ums_scheduler_in;   \
         \
+        INIT_LIST_HEAD(&(p_ums_scheduler_sl)->siblings);   \
+        (p_ums_scheduler_sl)->completion_list = NULL;   \
+        \
         (p_ums_scheduler_sl)->proc_entry = NULL;   \
         (p_ums_scheduler_sl)->proc_entry_info = NULL;   \
-        (p_ums_scheduler_sl)->proc_entry_main_workers = NULL;  \
+        (p_ums_scheduler_sl)->proc_entry_latency = NULL;  \
+        \
+        (p_ums_scheduler_sl)->handoff_start_ns = 0;  \
+        INIT_UMS_LATENCY_HIST(&(p_ums_scheduler_sl)->latency_wake);  \
+        INIT_UMS_LATENCY_HIST(&(p_ums_scheduler_sl)->latency_execute);  \
     } while(0)
 
 /**
@@ -293,10 +501,11 @@ typedef struct ums_scheduler_sl_t{
     do{ \
         (p_ums_scheduler_sl)->key = 0; \
         (p_ums_scheduler_sl)->ums_scheduler = NULL;   \
+        (p_ums_scheduler_sl)->completion_list = NULL;   \
         \
         (p_ums_scheduler_sl)->proc_entry = NULL;   \
         (p_ums_scheduler_sl)->proc_entry_info = NULL;   \
-        (p_ums_scheduler_sl)->proc_entry_main_workers = NULL;  \
+        (p_ums_scheduler_sl)->proc_entry_latency = NULL;  \
     } while(0)
 // -------------------------------------------------------------------
 
@@ -341,6 +550,241 @@ typedef struct ums_scheduler_sl_t{
     }while(0)
 // ------------------------------------------------------
 
+// ------------------------------------------------------
+/**
+ * @brief a ums_context wakes up the scheduler, start to measure the handoff
+ * 
+ * @param p_ums_scheduler_sl NON-NULL pointer ums_scheduler_sl object
+ */
+#define ums_scheduler_sl_handoff_start(p_ums_scheduler_sl)    \
+    do{ \
+        WRITE_ONCE((p_ums_scheduler_sl)->handoff_start_ns, ktime_get_ns());  \
+    }while(0)
+
+/**
+ * @brief the scheduler thread runs again, the handoff started by a ums_context (if any) is added to latency_wake
+ * 
+ * @param p_ums_scheduler_sl NON-NULL pointer ums_scheduler_sl object
+ */
+#define ums_scheduler_sl_handoff_end(p_ums_scheduler_sl)    \
+    do{ \
+        u64 __start = xchg(&(p_ums_scheduler_sl)->handoff_start_ns, 0);  \
+        if(__start != 0)    \
+            ums_latency_hist_add(&(p_ums_scheduler_sl)->latency_wake, ktime_get_ns() - __start);    \
+    }while(0)
+// ------------------------------------------------------
+
+// ------------------------------------------------------
+/**
+ * @brief start to measure the quantum of a ums_context that starts to run, if the preemption is enabled
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the ums_scheduler, its spin_lock must be held
+ * @param p_ums_context NON-NULL pointer to the new running_thread
+ */
+#define ums_scheduler_quantum_start(p_ums_scheduler, p_ums_context)    \
+    do{ \
+        if((p_ums_scheduler)->quantum_ns != 0){   \
+            (p_ums_scheduler)->quantum_seq += 1;    \
+            WRITE_ONCE((p_ums_scheduler)->quantum_context, p_ums_context); \
+            hrtimer_start(&(p_ums_scheduler)->quantum_timer, ns_to_ktime((p_ums_scheduler)->quantum_ns), HRTIMER_MODE_REL);   \
+        }   \
+    }while(0)
+
+/**
+ * @brief stop to measure the quantum of the running_thread, that leaves the CPU
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the ums_scheduler, its spin_lock must be held
+ * 
+ * NOTE: it waits a concurrent ums_scheduler_quantum_expired(), that doesn't use the spin_lock
+ */
+#define ums_scheduler_quantum_stop(p_ums_scheduler)    \
+    do{ \
+        if((p_ums_scheduler)->quantum_ns != 0){   \
+            hrtimer_cancel(&(p_ums_scheduler)->quantum_timer);  \
+            WRITE_ONCE((p_ums_scheduler)->quantum_context, NULL); \
+        }   \
+    }while(0)
+// ------------------------------------------------------
+
+// ------------------------------------------------------
+/**
+ * @brief check, without the spin_lock, if the running ums_context blocked and the scheduler has not been notified
+ * 
+ * @param ums_scheduler NON-NULL pointer to the ums_scheduler, only its thread can call it
+ */
+static inline bool ums_scheduler_blocked_pending(ums_scheduler_t* ums_scheduler){
+    ums_context_t* running_thread = READ_ONCE(ums_scheduler->running_thread);
+    return running_thread != NULL && READ_ONCE(running_thread->blocked);
+}
+
+/**
+ * @brief if the running ums_context blocked, release it and prepare the next call of the entry_point (REASON_THREAD_BLOCKED)
+ * 
+ * If its thread already woke up, the ums_context is put in the ready_list, otherwise its thread will do it
+ * 
+ * @param p_ums_scheduler NON-NULL pointer to the ums_scheduler, its spin_lock must be held
+ * @param p_res output, pointer to a bool, true if the scheduler has been notified
+ */
+#define ums_scheduler_notify_blocked(p_ums_scheduler, p_res)    \
+    do{ \
+        ums_context_t* __uc = (p_ums_scheduler)->running_thread;    \
+        *(p_res) = (__uc != NULL && READ_ONCE(__uc->blocked));  \
+        if(*(p_res)){   \
+            (p_ums_scheduler)->running_thread = NULL;   \
+            ums_scheduler_quantum_stop(p_ums_scheduler);   \
+            ums_context_update_run_time_end_slot(__uc); \
+            __uc->num_switch += 1;  \
+            WRITE_ONCE(__uc->blocked, false);   \
+            if(__uc->unblocked){    \
+                __uc->unblocked = false;    \
+                __uc->state = UMS_THREAD_STATE_IDLE;    \
+                ums_scheduler_ready_list_add(p_ums_scheduler, __uc);    \
+            }   \
+            else    \
+                WRITE_ONCE(__uc->state, UMS_THREAD_STATE_BLOCKED);  \
+            \
+            (p_ums_scheduler)->entry_point_args->reason = REASON_THREAD_BLOCKED;   \
+            (p_ums_scheduler)->entry_point_args->activation_payload = __uc->id;   \
+            ums_ring_post_event((p_ums_scheduler)->ring, REASON_THREAD_BLOCKED, __uc->id);  \
+        }   \
+    }while(0)
+// ------------------------------------------------------
+
+// ------------------------------------------------------
+/**
+ * @brief add the ums_scheduler_sl to the schedulers of a ums_completion_list, it becomes a sibling for the work stealing
+ * 
+ * @param p_ums_scheduler_sl NON-NULL pointer ums_scheduler_sl object 
+ * @param p_ums_completion_list_sl NON-NULL pointer to the ums_completion_list_sl used by the scheduler
+ */
+#define ums_scheduler_sl_attach_completion_list(p_ums_scheduler_sl, p_ums_completion_list_sl)  \
+    do{ \
+        spin_lock(&((p_ums_completion_list_sl)->schedulers_spin_lock));  \
+            list_add_tail_rcu(&((p_ums_scheduler_sl)->siblings), &((p_ums_completion_list_sl)->schedulers)); \
+            (p_ums_scheduler_sl)->completion_list = p_ums_completion_list_sl;   \
+        spin_unlock(&((p_ums_completion_list_sl)->schedulers_spin_lock));    \
+    }while(0)
+
+/**
+ * @brief remove the ums_scheduler_sl from the schedulers of its ums_completion_list
+ * 
+ * @param p_ums_scheduler_sl NON-NULL pointer ums_scheduler_sl object 
+ * 
+ * NOTE: siblings may still see it until a grace period elapses, its ums_scheduler must be removed before freeing it
+ */
+#define ums_scheduler_sl_detach_completion_list(p_ums_scheduler_sl)  \
+    do{ \
+        ums_completion_list_sl_t* __cl = (p_ums_scheduler_sl)->completion_list; \
+        if(likely(__cl != NULL)){   \
+            spin_lock(&(__cl->schedulers_spin_lock));  \
+                list_del_rcu(&((p_ums_scheduler_sl)->siblings)); \
+                (p_ums_scheduler_sl)->completion_list = NULL;   \
+            spin_unlock(&(__cl->schedulers_spin_lock));    \
+        }   \
+    }while(0)
+// ------------------------------------------------------
+
+// ------------------------------------------------------
+/**
+ * @brief check if a thief can take a ready ums_context of a victim
+ * 
+ * The victim must have a ums_context that waits (more than one in the ready_list, or one while another runs),
+ * and its worker threads must be able to run on the core of the thief (same cpu_core or not pinned)
+ * 
+ * @param p_thief NON-NULL pointer to the ums_scheduler that steals
+ * @param p_victim NON-NULL pointer to a sibling ums_scheduler
+ */
+#define ums_scheduler_can_steal_from(p_thief, p_victim)    \
+    (((p_victim)->cpu_core == -1 || (p_victim)->cpu_core == (p_thief)->cpu_core) &&   \
+     ((p_victim)->num_ready > 1 || ((p_victim)->num_ready == 1 && (p_victim)->running_thread != NULL)))
+
+/**
+ * @brief move a ready ums_context from a busy sibling (same ums_completion_list) to the ready_list of the thief
+ * 
+ * The ums_context is taken from the tail of the ready_list of the victim, that serves from the head.
+ * The spin_lock of a sibling is only tried, so two schedulers that steal from each other never deadlock
+ * 
+ * @param thief_sl NON-NULL pointer to the ums_scheduler_sl of the thief, its spin_lock must be held
+ * @return the stolen ums_context, NULL if no sibling can give one
+ */
+static inline ums_context_t* ums_scheduler_steal_ready_context(ums_scheduler_sl_t* thief_sl){
+    ums_scheduler_t* thief = thief_sl->ums_scheduler;
+    ums_completion_list_sl_t* ums_completion_list_sl = thief_sl->completion_list;
+    ums_scheduler_sl_t* victim_sl;
+    ums_scheduler_t* victim;
+    ums_context_t* ums_context = NULL;
+
+    if(unlikely(ums_completion_list_sl == NULL))
+        return NULL;
+
+    thief->num_steal_attempts += 1;
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(victim_sl, &ums_completion_list_sl->schedulers, siblings){
+        if(victim_sl == thief_sl || !spin_trylock(&victim_sl->ums_scheduler_spin_lock))
+            continue;
+
+        victim = victim_sl->ums_scheduler;
+        if(likely(victim != NULL) && ums_scheduler_can_steal_from(thief, victim)){
+            ums_context = list_last_entry(&victim->ready_list, ums_context_t, list);
+            if(unlikely(victim->current_ready_list_item == &ums_context->list))
+                victim->current_ready_list_item = NULL;
+            ums_scheduler_ready_list_remove(victim, ums_context);
+            victim->num_stolen += 1;
+
+            ums_context->pid_scheduler = thief_sl->key;
+            WRITE_ONCE(ums_context->scheduler_task_struct, thief->scheduler_task_struct);
+            ums_scheduler_ready_list_add(thief, ums_context);
+            thief->num_steals += 1;
+        }
+        spin_unlock(&victim_sl->ums_scheduler_spin_lock);
+
+        if(ums_context != NULL)
+            break;
+    }
+    rcu_read_unlock();
+
+    return ums_context;
+}
+
+/**
+ * @brief check, without spin_locks, if a parked scheduler has something to do
+ * 
+ * There is work if the ums_completion_list is not empty, a ums_context waits in its ready_list or it can be stolen
+ * from a sibling, or the running ums_context blocked
+ * 
+ * @param ums_scheduler_sl NON-NULL pointer to the ums_scheduler_sl of the parked scheduler, only its thread can call it
+ */
+static inline bool ums_scheduler_has_work(ums_scheduler_sl_t* ums_scheduler_sl){
+    ums_scheduler_t* ums_scheduler = ums_scheduler_sl->ums_scheduler;
+    ums_completion_list_sl_t* ums_completion_list_sl = ums_scheduler_sl->completion_list;
+    ums_scheduler_sl_t* sibling_sl;
+    ums_scheduler_t* sibling;
+    bool res = false;
+
+    if(ums_scheduler_blocked_pending(ums_scheduler) || READ_ONCE(ums_scheduler->num_ready) > 0)
+        return true;
+    if(unlikely(ums_completion_list_sl == NULL))
+        return false;
+    if(!list_empty_careful(&ums_completion_list_sl->ums_context_list))
+        return true;
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(sibling_sl, &ums_completion_list_sl->schedulers, siblings){
+        if(sibling_sl == ums_scheduler_sl)
+            continue;
+        sibling = READ_ONCE(sibling_sl->ums_scheduler);
+        if(sibling != NULL && ums_scheduler_can_steal_from(ums_scheduler, sibling)){
+            res = true;
+            break;
+        }
+    }
+    rcu_read_unlock();
+
+    return res;
+}
+// ------------------------------------------------------
+
 // ---------------------------------------------------------------
 /**
  * @brief macro used to check if a list is empty
@@ -419,9 +863,7 @@ static inline int snprintf_ums_scheduler(char* buff, ssize_t size_buff, ums_sche
         printk(KERN_DEBUG "\n snprintf_ums_scheduler() overflow!!!\n");
     }
     if(ums_scheduler->current_completion_list_item){            
-        if(snprintf_ums_completion_list_item(__buff_curr_list_item, 512, list_entry(ums_scheduler->current_completion_list_item, ums_completion_list_item_t, list)) > 512-4){
-            printk(KERN_DEBUG "\n snprintf_ums_scheduler() overflow!!!\n");
-        }
+        snprintf(__buff_curr_list_item, 512, "\t\t\tums_context_id=%d\n", list_entry(ums_scheduler->current_completion_list_item, ums_context_sl_t, cl_list)->id);
     }
     else    snprintf(__buff_curr_list_item, 512, "\t\t\tNULL\n");
 
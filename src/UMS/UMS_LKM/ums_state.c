@@ -0,0 +1,144 @@
+#include "ums_state.h"
+#include "ums_hashtable.h"
+#include "ums_proc.h"
+#include "rq_ums_scheduler.h"
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+// ---------------------------------------------------------------------------------------------
+static void ums_state_release(struct kref* kref){
+    ums_state_t* ums_state = container_of(kref, ums_state_t, kref);
+
+    if(ums_state->linked != NULL)
+        ums_state_put(ums_state->linked);
+    vfree(ums_state->shared);
+    kfree(ums_state);
+}
+
+static ums_state_t* ums_state_create(void){
+    ums_state_t* ums_state = kmalloc(sizeof(*ums_state), GFP_KERNEL);
+
+    if(unlikely(ums_state == NULL))
+        return NULL;
+
+    BUILD_BUG_ON(sizeof(ums_state_list_t) > PAGE_SIZE);
+    ums_state->shared = vmalloc_user(PAGE_SIZE);    // zeroed, seq is 0 and the list is empty
+    if(unlikely(ums_state->shared == NULL)){
+        kfree(ums_state);
+        return NULL;
+    }
+
+    kref_init(&ums_state->kref);
+    ums_state->linked = NULL;
+    return ums_state;
+}
+
+void ums_state_put(ums_state_t* ums_state){
+    kref_put(&ums_state->kref, ums_state_release);
+}
+// ---------------------------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------------------------
+static void ums_state_vm_open(struct vm_area_struct* vma){
+    kref_get(&((ums_state_t*)vma->vm_private_data)->kref);
+}
+
+static void ums_state_vm_close(struct vm_area_struct* vma){
+    ums_state_put((ums_state_t*)vma->vm_private_data);
+}
+
+static const struct vm_operations_struct ums_state_vm_ops = {
+    .open = ums_state_vm_open,
+    .close = ums_state_vm_close,
+};
+
+/**
+ * @brief get the state page of a ums_completion_list, it is created if it doesn't exist
+ *
+ * @param ums_completion_list_sl NON-NULL pointer to the ums_completion_list_sl
+ *
+ * @return Returns a new reference to the state page, NULL if out of memory
+ */
+static ums_state_t* ums_state_get_completion_list(ums_completion_list_sl_t* ums_completion_list_sl){
+    ums_state_t* ums_state = NULL;
+    ums_state_t* new_state = NULL;
+
+    if(READ_ONCE(ums_completion_list_sl->state) == NULL){
+        new_state = ums_state_create();
+        if(unlikely(new_state == NULL))
+            return NULL;
+    }
+
+    spin_lock(&ums_completion_list_sl->ums_context_list_spin_lock);
+    if(ums_completion_list_sl->state == NULL && new_state != NULL){
+        ums_completion_list_sl->state = new_state;  // the reference of ums_state_create() is given to the ums_completion_list
+        new_state = NULL;
+        ums_completion_list_state_update(ums_completion_list_sl);
+    }
+    ums_state = ums_completion_list_sl->state;
+    if(likely(ums_state != NULL))
+        kref_get(&ums_state->kref);
+    spin_unlock(&ums_completion_list_sl->ums_context_list_spin_lock);
+
+    if(new_state != NULL)
+        ums_state_put(new_state);   // created by a sibling in the meantime
+    return ums_state;
+}
+
+int ums_state_mmap(ums_process_t* ums_process, struct vm_area_struct* vma){
+    ums_scheduler_sl_t* ums_scheduler_sl;
+    ums_scheduler_t* ums_scheduler;
+    ums_state_t* ums_state;
+    int ret;
+
+    if(unlikely(vma->vm_end - vma->vm_start != 2*PAGE_SIZE))
+        return -EINVAL;
+    if(unlikely(vma->vm_flags & VM_WRITE))
+        return -EPERM;  // read-only view, the lists are changed only by requests
+    vm_flags_clear(vma, VM_MAYWRITE);
+
+    // only a scheduler has state pages, and only its thread sets them
+    rcu_read_lock();    // its own ums_scheduler_sl, see ums_process_get_scheduler_sl()
+    ums_process_get_scheduler_sl(ums_process, current->pid, ums_scheduler_sl);
+    rcu_read_unlock();
+    if(unlikely(ums_scheduler_sl == NULL || ums_scheduler_sl->ums_scheduler == NULL))
+        return -EINVAL;
+    if(unlikely(ums_scheduler_sl->ums_scheduler->state != NULL))
+        return -EBUSY;
+
+    ums_state = ums_state_create();
+    if(unlikely(ums_state == NULL))
+        return -ENOMEM;
+
+    ums_state->linked = ums_state_get_completion_list(ums_scheduler_sl->ums_scheduler->completion_list);
+    if(unlikely(ums_state->linked == NULL)){
+        ums_state_put(ums_state);
+        return -ENOMEM;
+    }
+
+    ret = vm_insert_page(vma, vma->vm_start, vmalloc_to_page(ums_state->shared));
+    if(likely(ret == 0))
+        ret = vm_insert_page(vma, vma->vm_start + PAGE_SIZE, vmalloc_to_page(ums_state->linked->shared));
+    if(unlikely(ret != 0)){
+        ums_state_put(ums_state);
+        return ret;
+    }
+
+    // a reference for the mapping, the one of ums_state_create() is given to the scheduler
+    kref_get(&ums_state->kref);
+    vma->vm_private_data = ums_state;
+    vma->vm_ops = &ums_state_vm_ops;
+
+    ums_scheduler_sl_lock_get_scheduler(ums_scheduler_sl, ums_scheduler);
+    if(likely(ums_scheduler != NULL)){
+        ums_scheduler->state = ums_state;
+        ums_state = NULL;
+        ums_scheduler_state_update(ums_scheduler);
+    }
+    ums_scheduler_sl_unlock_scheduler(ums_scheduler_sl);
+
+    if(unlikely(ums_state != NULL))
+        ums_state_put(ums_state);
+    return 0;
+}
+// ---------------------------------------------------------------------------------------------
@@ -0,0 +1,83 @@
+#pragma once
+/// @file
+/// This file contains the state pages of a scheduler, the read-only view of its lists shared with the user
+/// (see ../common/ums_state.h)
+///
+
+#include <linux/kernel.h>
+#include <linux/kref.h>
+#include <linux/mm.h>
+
+#include "../common/ums_state.h"
+
+struct ums_process_t;
+
+/**
+ * @brief a state page
+ *
+ */
+typedef struct ums_state_t{
+    struct kref kref;   /** held by the owner (ums_scheduler or ums_completion_list) and by the state pages that link it */
+    ums_state_list_t* shared;   /** vmalloc_user() page, mapped read-only by the schedulers */
+    struct ums_state_t* linked; /** the page of the ums_completion_list, for the page of a ums_scheduler. It holds a reference */
+}ums_state_t;
+
+/**
+ * @brief release a reference of the state page, the last one frees it
+ *
+ * @param ums_state NON-NULL pointer to the state page
+ */
+void ums_state_put(ums_state_t* ums_state);
+
+/**
+ * @brief mmap() handler of /dev/UMS at UMS_STATE_MMAP_OFFSET, creates the state pages of the calling scheduler and maps them
+ *
+ * @param ums_process ums_process bound to the file
+ * @param vma size of 2 pages, not writable
+ *
+ * @return Returns 0 on sucess, otherwise -errno (-EBUSY if the scheduler already has its state pages)
+ */
+int ums_state_mmap(struct ums_process_t* ums_process, struct vm_area_struct* vma);
+
+// -------------------------------------------------------------------
+/**
+ * @brief start an update of a state page, the user retries its reads until ums_state_write_end()
+ *
+ * @param p_shared NON-NULL pointer to ums_state_list_t
+ *
+ * NOTE: the writers of a page must be serialized by the spin_lock of the list
+ */
+#define ums_state_write_begin(p_shared) \
+    do{ \
+        WRITE_ONCE((p_shared)->seq, (p_shared)->seq + 1);   \
+        smp_wmb();  \
+    }while(0)
+
+/**
+ * @brief end an update of a state page
+ *
+ * @param p_shared NON-NULL pointer to ums_state_list_t
+ */
+#define ums_state_write_end(p_shared) \
+    do{ \
+        smp_wmb();  \
+        WRITE_ONCE((p_shared)->seq, (p_shared)->seq + 1);   \
+    }while(0)
+
+/**
+ * @brief copy a ums_context in an entry of a state page
+ *
+ * @param p_entry NON-NULL pointer to ums_state_context_t
+ * @param p_ums_context NON-NULL pointer to the ums_context, idle since it waits in a list
+ */
+#define ums_state_fill_context(p_entry, p_ums_context) \
+    do{ \
+        (p_entry)->ucd = (p_ums_context)->id;   \
+        (p_entry)->prio = (p_ums_context)->prio;    \
+        (p_entry)->number_switch = (p_ums_context)->num_switch; \
+        (p_entry)->reserved = 0;    \
+        (p_entry)->run_time_ns = (p_ums_context)->ums_run_time; \
+        (p_entry)->cpu_time_ns = (p_ums_context)->ums_cpu_time; \
+        (p_entry)->user_reserved = (p_ums_context)->user_reserved;  \
+    }while(0)
+// -------------------------------------------------------------------
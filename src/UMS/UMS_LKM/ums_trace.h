@@ -0,0 +1,160 @@
+/// @file
+/// This file contains the tracepoints of the state transitions of UMS (events ums:*, see /sys/kernel/tracing/events/ums)
+///
+/// Each event carries tgid, pid of the scheduler, descriptor, CPU and a ktime_get_ns() timestamp,
+/// so the latencies between events can be measured with perf trace, ftrace or bpftrace.
+/// CREATE_TRACE_POINTS is defined only by ums_LKM.c
+///
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ums
+
+#if !defined(_UMS_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _UMS_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/smp.h>
+
+// ums_context ########################################################################################
+DECLARE_EVENT_CLASS(ums_context_class,
+
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+
+    TP_ARGS(pid_scheduler, ucd),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(pid_t, pid_scheduler)
+        __field(int, ucd)
+        __field(int, cpu)
+        __field(u64, ts)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid = current->tgid;
+        __entry->pid_scheduler = pid_scheduler;
+        __entry->ucd = ucd;
+        __entry->cpu = raw_smp_processor_id();
+        __entry->ts = ktime_get_ns();
+    ),
+
+    TP_printk("tgid=%d scheduler=%d ucd=%d cpu=%d ts=%llu",
+        __entry->tgid, __entry->pid_scheduler, __entry->ucd, __entry->cpu, __entry->ts)
+);
+
+DEFINE_EVENT(ums_context_class, ums_context_create,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_delete,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_startup,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_execute_cl,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_execute_rl,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_yield,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_switch_to,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+
+DEFINE_EVENT(ums_context_class, ums_context_end,
+    TP_PROTO(pid_t pid_scheduler, int ucd),
+    TP_ARGS(pid_scheduler, ucd));
+// ########################################################################################
+
+// ums_scheduler ########################################################################################
+DECLARE_EVENT_CLASS(ums_scheduler_class,
+
+    TP_PROTO(pid_t pid_scheduler, int cld),
+
+    TP_ARGS(pid_scheduler, cld),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(pid_t, pid_scheduler)
+        __field(int, cld)
+        __field(int, cpu)
+        __field(u64, ts)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid = current->tgid;
+        __entry->pid_scheduler = pid_scheduler;
+        __entry->cld = cld;
+        __entry->cpu = raw_smp_processor_id();
+        __entry->ts = ktime_get_ns();
+    ),
+
+    TP_printk("tgid=%d scheduler=%d cld=%d cpu=%d ts=%llu",
+        __entry->tgid, __entry->pid_scheduler, __entry->cld, __entry->cpu, __entry->ts)
+);
+
+DEFINE_EVENT(ums_scheduler_class, ums_scheduler_park,
+    TP_PROTO(pid_t pid_scheduler, int cld),
+    TP_ARGS(pid_scheduler, cld));
+
+DEFINE_EVENT(ums_scheduler_class, ums_scheduler_wake,
+    TP_PROTO(pid_t pid_scheduler, int cld),
+    TP_ARGS(pid_scheduler, cld));
+// ########################################################################################
+
+// ums_completion_list ########################################################################################
+DECLARE_EVENT_CLASS(ums_completion_list_class,
+
+    TP_PROTO(int cld, int ucd),
+
+    TP_ARGS(cld, ucd),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(pid_t, pid)
+        __field(int, cld)
+        __field(int, ucd)
+        __field(int, cpu)
+        __field(u64, ts)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid = current->tgid;
+        __entry->pid = current->pid;
+        __entry->cld = cld;
+        __entry->ucd = ucd;
+        __entry->cpu = raw_smp_processor_id();
+        __entry->ts = ktime_get_ns();
+    ),
+
+    TP_printk("tgid=%d pid=%d cld=%d ucd=%d cpu=%d ts=%llu",
+        __entry->tgid, __entry->pid, __entry->cld, __entry->ucd, __entry->cpu, __entry->ts)
+);
+
+DEFINE_EVENT(ums_completion_list_class, ums_completion_list_add,
+    TP_PROTO(int cld, int ucd),
+    TP_ARGS(cld, ucd));
+
+DEFINE_EVENT(ums_completion_list_class, ums_completion_list_remove,
+    TP_PROTO(int cld, int ucd),
+    TP_ARGS(cld, ucd));
+// ########################################################################################
+
+#endif /* _UMS_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ums_trace
+#include <trace/define_trace.h>
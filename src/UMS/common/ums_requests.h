@@ -6,6 +6,8 @@
 ///
 
 #include "ums_types.h"
+#include "ums_ring.h"
+#include "ums_state.h"
 
 #define REQUEST_0       120
 #define REQUEST_1       119
@@ -30,6 +32,14 @@
 #define REQUEST_19      101
 #define REQUEST_20      100
 
+#define REQUEST_21      99
+#define REQUEST_22      98
+#define REQUEST_23      97
+#define REQUEST_24      96
+#define REQUEST_25      95
+#define REQUEST_26      94
+#define REQUEST_27      93
+
 
 #define REQUEST_DEBUG_0     255
 #define REQUEST_DEBUG_1     254
@@ -65,6 +75,7 @@ typedef struct rq_create_delete_ums_context_args_t{
     void* args;
     void* user_res;
     int cpu_core;
+    int prio;   //UMS_PRIO_HIGHEST..UMS_PRIO_LOWEST
 }rq_create_delete_ums_context_args_t;
 
 
@@ -93,6 +104,13 @@ typedef struct rq_create_delete_ums_scheduler_args_t{
 
     int return_value;
     int cpu_core;
+
+    int pool_size;      //user only, maximum number of parked worker threads
+    int pool_warm_up;   //user only, worker threads created at startup
+
+    unsigned int quantum_us;    //time slice of a ums_context in microseconds, 0 to disable the preemption
+    int ring;   //user only, map the ums_ring at startup
+    int state;  //user only, map the state pages at startup
 }rq_create_delete_ums_scheduler_args_t;
 
 
@@ -180,4 +198,58 @@ typedef struct rq_execute_args_t{
 #define RQ_EXECUTE_READY_LIST   REQUEST_19
 
 
+#define RQ_SWITCH_TO_UMS_CONTEXT    REQUEST_20
+typedef struct rq_switch_to_ums_context_args_t{
+    ums_context_descriptor_t ucd;   //ums_context to run in place of the caller
+}rq_switch_to_ums_context_args_t;
+
+
+#define RQ_SET_UMS_CONTEXT_PRIO     REQUEST_21
+typedef struct rq_set_ums_context_prio_args_t{
+    ums_context_descriptor_t ucd;
+    int prio;   //UMS_PRIO_HIGHEST..UMS_PRIO_LOWEST
+}rq_set_ums_context_prio_args_t;
+
+
+#define RQ_EXECUTE_HIGHEST_PRIO_READY_THREAD    REQUEST_22
+//uses rq_execute_next_ready_thread_args_t
+
+
+#define RQ_PARK_UMS_SCHEDULER       REQUEST_23
+typedef struct rq_park_ums_scheduler_args_t{
+    pid_t tgid; //pid of the process
+    pid_t pid;  //pid of the scheduler's thread
+}rq_park_ums_scheduler_args_t;
+
+
+#define RQ_CREATE_UMS_CONTEXT_BATCH     REQUEST_24
+typedef struct rq_create_ums_context_batch_args_t{
+    pid_t tgid;
+    int num;    //1..UMS_BATCH_MAX
+    const ums_context_batch_item_t* items;  //num attributes of the new ums_contexts
+    ums_context_descriptor_t* descriptors;  //output, num descriptors
+}rq_create_ums_context_batch_args_t;
+
+
+#define RQ_COMPLETION_LIST_ADD_UMS_CONTEXT_BATCH    REQUEST_25
+typedef struct rq_completion_list_add_ums_context_batch_args_t{
+    pid_t tgid;
+    ums_completion_list_descriptor_t completion_list_d;
+    int num;    //1..UMS_BATCH_MAX
+    const ums_context_descriptor_t* descriptors;    //num ums_contexts to add
+}rq_completion_list_add_ums_context_batch_args_t;
+
+
+#define RQ_UMS_RING_ENTER           REQUEST_26
+typedef struct rq_ums_ring_enter_args_t{
+    unsigned int to_submit; //maximum number of sqes to consume
+}rq_ums_ring_enter_args_t;
+
+
+#define RQ_PARK_UMS_CONTEXT         REQUEST_27
+typedef struct rq_park_ums_context_args_t{
+    int unused;
+}rq_park_ums_context_args_t;
+
+
 #endif /* UMS_REQUEST_H_ */
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+/// @file
+/// This file contains the layout of a ums_ring, the memory shared by a scheduler and the kernel module
+/// to submit requests and receive their results and the events of the ums_contexts, without a syscall for each one
+///
+/// The scheduler thread maps its ums_ring with mmap() on /dev/UMS, offset 0 and size of ums_ring_shared_t rounded up to the page size.
+/// Submission queue: the user writes sqes[sq_tail % UMS_RING_SQ_ENTRIES] and then increments sq_tail,
+/// the kernel consumes them at RQ_UMS_RING_ENTER and RQ_WAIT_NEXT_SCHEDULER_CALL and increments sq_head.
+/// Completion queue: the kernel writes cqes[cq_tail % UMS_RING_CQ_ENTRIES] and then increments cq_tail,
+/// the user reads them and increments cq_head. If the completion queue is full, cq_overflow is incremented.
+/// Indexes are free running unsigned int, the producer publishes its index with a release store,
+/// the consumer reads it with an acquire load.
+///
+
+#include "ums_types.h"
+
+#define UMS_RING_SQ_ENTRIES     256     /*power of 2*/
+#define UMS_RING_CQ_ENTRIES     512     /*power of 2*/
+
+#define UMS_RING_CACHELINE      64
+
+//opcode of a ums_sqe_t, each one is the same as a request.
+//SET_PRIO and EXECUTE_READY take the spin_lock of a scheduler: after the scheduler executed a ums_context, they fail with -EBUSY
+//until the next scheduler call, they must be submitted before any execute
+#define UMS_SQE_NOP                         0
+#define UMS_SQE_CREATE_UMS_CONTEXT          1   /*RQ_CREATE_UMS_CONTEXT: routine, args, user_res, prio. cqe.ucd is the new descriptor*/
+#define UMS_SQE_COMPLETION_LIST_ADD         2   /*RQ_COMPLETION_LIST_ADD_UMS_CONTEXT: cld, ucd*/
+#define UMS_SQE_SET_PRIO                    3   /*RQ_SET_UMS_CONTEXT_PRIO: ucd, prio*/
+#define UMS_SQE_EXECUTE_READY               4   /*RQ_EXECUTE_READY_LIST: ucd*/
+
+//kind of a ums_cqe_t
+#define UMS_CQE_COMPLETION      0   /*result of a ums_sqe_t: res is 0 or -errno, user_data is the one of the sqe*/
+#define UMS_CQE_EVENT           1   /*res is the reason (REASON_THREAD_*) and ucd the activation_payload*/
+
+/**
+ * @brief entry of the submission queue
+ *
+ */
+typedef struct ums_sqe_t{
+    int opcode;     // UMS_SQE_*
+    int prio;
+    ums_context_descriptor_t ucd;
+    ums_completion_list_descriptor_t cld;
+
+    void* (*routine)(void* args);
+    void* args;
+    void* user_res;
+
+    unsigned long long user_data;   // given back in the cqe
+}ums_sqe_t;
+
+/**
+ * @brief entry of the completion queue
+ *
+ */
+typedef struct ums_cqe_t{
+    int kind;       // UMS_CQE_*
+    int res;
+    ums_context_descriptor_t ucd;
+    int opcode;     // opcode of the sqe, if kind is UMS_CQE_COMPLETION
+
+    unsigned long long user_data;
+}ums_cqe_t;
+
+/**
+ * @brief memory shared by a scheduler and the kernel module
+ *
+ */
+typedef struct ums_ring_shared_t{
+    unsigned int sq_head __attribute__((aligned(UMS_RING_CACHELINE)));  // written by the kernel
+    unsigned int sq_tail __attribute__((aligned(UMS_RING_CACHELINE)));  // written by the user
+
+    unsigned int cq_head __attribute__((aligned(UMS_RING_CACHELINE)));  // written by the user
+    unsigned int cq_tail __attribute__((aligned(UMS_RING_CACHELINE)));  // written by the kernel
+    unsigned int cq_overflow;   // written by the kernel
+
+    ums_sqe_t sqes[UMS_RING_SQ_ENTRIES] __attribute__((aligned(UMS_RING_CACHELINE)));
+    ums_cqe_t cqes[UMS_RING_CQ_ENTRIES] __attribute__((aligned(UMS_RING_CACHELINE)));
+}ums_ring_shared_t;
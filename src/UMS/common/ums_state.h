@@ -0,0 +1,46 @@
+#pragma once
+
+/// @file
+/// This file contains the layout of the state pages, a read-only view of the ready_list and of the ums_completion_list
+/// of a scheduler kept up to date by the kernel module, so the entry_point can choose a ums_context without a syscall
+///
+/// The scheduler thread maps them with mmap() on /dev/UMS, offset UMS_STATE_MMAP_OFFSET, size 2 pages, PROT_READ only.
+/// The first page is the ready_list of the scheduler, the second one is its ums_completion_list (common to the siblings).
+/// Each page is a ums_state_list_t, protected by a seqcount: seq is odd while the kernel updates the page,
+/// the user reads seq, copies the entries and reads seq again, the copy is valid if both are the same even value.
+///
+
+#include "ums_types.h"
+
+#define UMS_STATE_MMAP_OFFSET   0x10000000UL    /*offset of mmap() for the state pages, the ums_ring uses offset 0*/
+
+#define UMS_STATE_LIST_MAX      96  /*entries of a page, the ums_contexts beyond are counted in num but not shown*/
+
+/**
+ * @brief ums_context in a state page
+ *
+ */
+typedef struct ums_state_context_t{
+    ums_context_descriptor_t ucd;
+    int prio;
+    int number_switch;
+    int reserved;
+
+    unsigned long long run_time_ns;     // wall-clock time spent running
+    unsigned long long cpu_time_ns;     // time actually spent on a CPU while running
+
+    void* user_reserved;
+}ums_state_context_t;
+
+/**
+ * @brief a state page, the ums_contexts of a list in order
+ *
+ */
+typedef struct ums_state_list_t{
+    unsigned int seq;   // odd while the kernel updates the page
+    int num;            // number of ums_contexts in the list
+    int num_shown;      // number of valid entries in contexts, at most UMS_STATE_LIST_MAX
+    int reserved;
+
+    ums_state_context_t contexts[UMS_STATE_LIST_MAX];
+}ums_state_list_t;
@@ -48,12 +48,26 @@ typedef int res_t;
 #define ERR_INTERNAL            RES_ERR_4   /*SHOULD BE A KERNEL PANIC*/
 #define ERR_ASSIGNED            RES_ERR_5
 #define ERR_CPU_SELECTED        RES_ERR_6
+#define ERR_STALE               RES_ERR_7   /*the ums_context is no longer in the ums_completion_list of the snapshot*/
+
+//priority of a ums_context, the lower the value the higher the priority
+#define UMS_PRIO_NUM        32  /*number of priority levels*/
+#define UMS_PRIO_HIGHEST    0
+#define UMS_PRIO_LOWEST     (UMS_PRIO_NUM-1)
+#define UMS_PRIO_DEFAULT    (UMS_PRIO_NUM/2)
+
+//maximum number of ums_contexts created or added to a completion_list by a single batch request
+#define UMS_BATCH_MAX       4096
+
+//signal (SIGRTMAX) sent by the LKM to a ums thread that must leave the CPU, its handler requests RQ_PARK_UMS_CONTEXT
+#define UMS_PARK_SIGNAL     64
 
 typedef int reason_t;
 #define REASON_STARTUP              REASON_0
 #define REASON_THREAD_BLOCKED       REASON_1
 #define REASON_THREAD_YIELD         REASON_2
 #define REASON_THREAD_ENDED         REASON_3
+#define REASON_THREAD_PREEMPTED     REASON_4
 
 #define REASON_SPECIAL_END_SCHEDULER    REASON_SPECIAL_0
 
@@ -64,13 +78,26 @@ typedef int reason_t;
 typedef struct entry_point_args_t{
     reason_t reason; /** reason of the scheduler call:
                         REASON_STARTUP
+                        REASON_THREAD_BLOCKED (the ums_context will be in the ready_list when its thread wakes up)
                         REASON_THREAD_YIELD
-                        REASON_THREAD_ENDED */
-    ums_context_descriptor_t activation_payload;    /** if reason is yielded or ended thread, 
+                        REASON_THREAD_ENDED
+                        REASON_THREAD_PREEMPTED (end of the quantum, the ums_context is in the ready_list) */
+    ums_context_descriptor_t activation_payload;    /** if reason is blocked, yielded, ended or preempted thread, 
                                                     indicates the descriptor of the ums_context */
     void* sched_args;   /** user defined scheduler arguments */
 }entry_point_args_t;
 
+/**
+ * @brief attributes of a ums_context created by a batch request
+ * 
+ */
+typedef struct ums_context_batch_item_t{
+    void* (*routine)(void* args);
+    void* args;
+    void* user_res;
+    int prio;   //UMS_PRIO_HIGHEST..UMS_PRIO_LOWEST
+}ums_context_batch_item_t;
+
 /**
  * @brief used to choose a ums_context from the ready list or from the completion_list
  * 
@@ -82,4 +109,9 @@ typedef struct info_ums_context_t{
     
     void* user_reserved;
     bool from_cl;
+    int prio;
+
+    unsigned long long run_time_ns;     // wall-clock time spent running, also while blocked or preempted by other tasks
+    unsigned long long cpu_time_ns;     // time actually spent on a CPU while running
+    unsigned long long ready_wait_ns;   // time spent in a ready_list
 }info_ums_context_t;
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "bench_common.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sysinfo.h>
+
+static FILE* bench_out = NULL;
+static bench_format_t bench_out_format;
+static int bench_out_rows;
+
+// bench_samples_t ---------------------------------------------------------------------------------------
+int bench_samples_init(bench_samples_t* samples, int cap){
+    memset(samples, 0, sizeof(*samples));
+    samples->ns = malloc(sizeof(uint64_t) * (cap > 0? cap : 1));
+    if(samples->ns == NULL)
+        return -1;
+    samples->cap = cap;
+    return 0;
+}
+
+void bench_samples_free(bench_samples_t* samples){
+    free(samples->ns);
+    memset(samples, 0, sizeof(*samples));
+}
+
+void bench_samples_merge(bench_samples_t* dst, const bench_samples_t* src){
+    int i;
+
+    for(i = 0; i < src->num; i++)
+        bench_samples_add(dst, src->ns[i]);
+    dst->num_dropped += src->num_dropped;
+
+    if(src->begin_ns != 0 && (dst->begin_ns == 0 || src->begin_ns < dst->begin_ns))
+        dst->begin_ns = src->begin_ns;
+    if(src->end_ns > dst->end_ns)
+        dst->end_ns = src->end_ns;
+}
+// -------------------------------------------------------------------------------------------------------
+
+// bench_stats_t -----------------------------------------------------------------------------------------
+static int bench_cmp_u64(const void* a, const void* b){
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief nearest-rank percentile of sorted samples
+ *
+ * @param permille percentile in thousandths (e.g. 990 for p99)
+ */
+static uint64_t bench_percentile(const bench_samples_t* samples, int permille){
+    long rank;
+
+    if(samples->num == 0)
+        return 0;
+    rank = ((long)samples->num * permille + 999) / 1000;
+    if(rank < 1)
+        rank = 1;
+    return samples->ns[rank - 1];
+}
+
+void bench_stats_compute(bench_samples_t* samples, bench_stats_t* stats){
+    memset(stats, 0, sizeof(*stats));
+    stats->num = samples->num + samples->num_dropped;
+
+    if(samples->num > 0){
+        qsort(samples->ns, samples->num, sizeof(uint64_t), bench_cmp_u64);
+        stats->min_ns = samples->ns[0];
+        stats->p50_ns = bench_percentile(samples, 500);
+        stats->p99_ns = bench_percentile(samples, 990);
+        stats->max_ns = samples->ns[samples->num - 1];
+    }
+
+    if(samples->begin_ns != 0 && samples->end_ns > samples->begin_ns)
+        stats->ops_per_sec = (double)stats->num * 1e9 / (double)(samples->end_ns - samples->begin_ns);
+}
+// -------------------------------------------------------------------------------------------------------
+
+// output ------------------------------------------------------------------------------------------------
+int bench_format_parse(const char* name, bench_format_t* format){
+    if(strcmp(name, "csv") == 0)
+        *format = BENCH_FORMAT_CSV;
+    else if(strcmp(name, "json") == 0)
+        *format = BENCH_FORMAT_JSON;
+    else if(strcmp(name, "table") == 0)
+        *format = BENCH_FORMAT_TABLE;
+    else
+        return -1;
+    return 0;
+}
+
+int bench_output_begin(bench_format_t format){
+    int fd;
+
+    fflush(stdout);
+    fd = dup(STDOUT_FILENO);
+    if(fd == -1)
+        return -1;
+    bench_out = fdopen(fd, "w");
+    if(bench_out == NULL){
+        close(fd);
+        return -1;
+    }
+    // from now on printf() goes to stderr
+    if(dup2(STDERR_FILENO, STDOUT_FILENO) == -1)
+        return -1;
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    bench_out_format = format;
+    bench_out_rows = 0;
+    if(format == BENCH_FORMAT_CSV)
+        fprintf(bench_out, "bench,threads,cpu_base,size,samples,min_ns,p50_ns,p99_ns,max_ns,ops_per_sec\n");
+    else if(format == BENCH_FORMAT_JSON)
+        fprintf(bench_out, "[");
+    fflush(bench_out);
+    return 0;
+}
+
+void bench_output_group(const char* title){
+    if(bench_out_format != BENCH_FORMAT_TABLE)
+        return;
+    fprintf(bench_out, "\n%s\n", title);
+    fprintf(bench_out, "%-28s %7s %8s %6s %10s %10s %10s %10s %12s %14s\n",
+                "bench", "threads", "cpu_base", "size", "samples", "min_ns", "p50_ns", "p99_ns", "max_ns", "ops_per_sec");
+    fflush(bench_out);
+}
+
+void bench_output_row(const char* bench, int threads, int cpu_base, int size, bench_samples_t* samples){
+    bench_stats_t stats;
+
+    bench_stats_compute(samples, &stats);
+    if(samples->num_dropped > 0)
+        fprintf(stderr, "%s: %d samples dropped, the statistics are computed on the first %d\n", bench, samples->num_dropped, samples->num);
+
+    if(bench_out_format == BENCH_FORMAT_CSV){
+        fprintf(bench_out, "%s,%d,%d,%d,%d,%llu,%llu,%llu,%llu,%.1f\n",
+                    bench, threads, cpu_base, size, stats.num,
+                    (unsigned long long)stats.min_ns,
+                    (unsigned long long)stats.p50_ns,
+                    (unsigned long long)stats.p99_ns,
+                    (unsigned long long)stats.max_ns,
+                    stats.ops_per_sec);
+    }
+    else if(bench_out_format == BENCH_FORMAT_TABLE){
+        fprintf(bench_out, "%-28s %7d %8d %6d %10d %10llu %10llu %10llu %12llu %14.1f\n",
+                    bench, threads, cpu_base, size, stats.num,
+                    (unsigned long long)stats.min_ns,
+                    (unsigned long long)stats.p50_ns,
+                    (unsigned long long)stats.p99_ns,
+                    (unsigned long long)stats.max_ns,
+                    stats.ops_per_sec);
+    }
+    else{
+        fprintf(bench_out, "%s\n  {\"bench\": \"%s\", \"threads\": %d, \"cpu_base\": %d, \"size\": %d, \"samples\": %d, "
+                    "\"min_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu, \"ops_per_sec\": %.1f}",
+                    (bench_out_rows > 0)? "," : "",
+                    bench, threads, cpu_base, size, stats.num,
+                    (unsigned long long)stats.min_ns,
+                    (unsigned long long)stats.p50_ns,
+                    (unsigned long long)stats.p99_ns,
+                    (unsigned long long)stats.max_ns,
+                    stats.ops_per_sec);
+    }
+    bench_out_rows++;
+    fflush(bench_out);
+}
+
+void bench_output_end(void){
+    if(bench_out == NULL)
+        return;
+    if(bench_out_format == BENCH_FORMAT_JSON)
+        fprintf(bench_out, "\n]\n");
+    fclose(bench_out);
+    bench_out = NULL;
+}
+// -------------------------------------------------------------------------------------------------------
+
+int bench_parse_list(const char* list, int* values, int max){
+    const char* p = list;
+    char* end;
+    long value;
+    int num = 0;
+
+    while(*p != '\0'){
+        if(num == max)
+            return -1;
+        value = strtol(p, &end, 10);
+        if(end == p || (*end != ',' && *end != '\0'))
+            return -1;
+        values[num++] = (int)value;
+        p = (*end == ',')? end + 1 : end;
+    }
+    return (num > 0)? num : -1;
+}
+
+int bench_cpu_of(int cpu_base, int i){
+    if(cpu_base < 0)
+        return -1;
+    return (cpu_base + i) % get_nprocs();
+}
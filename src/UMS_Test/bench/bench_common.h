@@ -0,0 +1,175 @@
+#pragma once
+/// @file
+/// This file contains the helpers shared by the benchmarks of UMS_Test: clock, samples, statistics and output
+///
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_LIST_MAX  32  /** maximum number of values of a comma separated option (e.g. -s 1,2,4) */
+
+// bench_samples_t ########################################################################################
+/**
+ * @brief latencies measured by a benchmark, in ns
+ *
+ * The samples beyond the capacity are counted in num_dropped and not stored
+ */
+typedef struct bench_samples_t{
+    uint64_t* ns;   /** array of cap samples */
+    int num;    /** number of samples stored */
+    int cap;    /** capacity of ns */
+    int num_dropped;    /** samples not stored, the array was full */
+
+    uint64_t begin_ns;  /** start of the measured interval, 0 if not started */
+    uint64_t end_ns;    /** end of the measured interval */
+}bench_samples_t;
+
+/**
+ * @brief current time in ns, CLOCK_MONOTONIC as ktime_get_ns() of the kernel module
+ *
+ */
+static inline uint64_t bench_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief store a sample
+ *
+ * NOTE: not thread safe, each thread (or each scheduler, that runs one ums_context at a time) must use its own bench_samples_t
+ */
+static inline void bench_samples_add(bench_samples_t* samples, uint64_t ns){
+    if(samples->num < samples->cap)
+        samples->ns[samples->num++] = ns;
+    else
+        samples->num_dropped++;
+}
+
+/**
+ * @brief mark the start of the measured interval, only the first call counts
+ *
+ */
+static inline void bench_samples_begin(bench_samples_t* samples){
+    if(samples->begin_ns == 0)
+        samples->begin_ns = bench_now_ns();
+}
+
+/**
+ * @brief mark the end of the measured interval, the last call counts
+ *
+ */
+static inline void bench_samples_end(bench_samples_t* samples){
+    samples->end_ns = bench_now_ns();
+}
+
+/**
+ * @brief allocate a bench_samples_t of capacity cap
+ *
+ * @return int Returns 0 on success, otherwise -1
+ */
+int bench_samples_init(bench_samples_t* samples, int cap);
+
+/**
+ * @brief free the samples and reset the bench_samples_t
+ *
+ */
+void bench_samples_free(bench_samples_t* samples);
+
+/**
+ * @brief append the samples of src to dst, the interval of dst becomes the union of both
+ *
+ * NOTE: the samples that do not fit in dst are counted as dropped
+ */
+void bench_samples_merge(bench_samples_t* dst, const bench_samples_t* src);
+// ########################################################################################
+
+// bench_stats_t ########################################################################################
+/**
+ * @brief statistics of a bench_samples_t
+ *
+ */
+typedef struct bench_stats_t{
+    int num;    /** number of samples, also the dropped ones */
+    uint64_t min_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    double ops_per_sec; /** samples (also the dropped ones) divided by the measured interval, 0 if it is empty */
+}bench_stats_t;
+
+/**
+ * @brief compute the statistics of samples
+ *
+ * NOTE: it sorts the samples in place
+ */
+void bench_stats_compute(bench_samples_t* samples, bench_stats_t* stats);
+// ########################################################################################
+
+// output ########################################################################################
+typedef enum bench_format_t{
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+    BENCH_FORMAT_TABLE  /** aligned columns, for a terminal */
+}bench_format_t;
+
+/**
+ * @brief parse the name of a format, "csv", "json" or "table"
+ *
+ * @return int Returns 0 on success, otherwise -1
+ */
+int bench_format_parse(const char* name, bench_format_t* format);
+
+/**
+ * @brief start the output of the results
+ *
+ * The results are written on the original stdout, while the stdout of the process (printf of the program and of libums)
+ * is redirected to stderr, so the results can be piped to a file without the messages of the library
+ *
+ * @return int Returns 0 on success, otherwise -1
+ */
+int bench_output_begin(bench_format_t format);
+
+/**
+ * @brief write a row of results
+ *
+ * @param bench name of the benchmark
+ * @param threads number of schedulers (or threads) that ran the benchmark
+ * @param cpu_base cpu of the first scheduler, the others follow. -1 if not pinned
+ * @param size size of the lists (0 if it has no meaning for the benchmark)
+ * @param samples samples of all the schedulers, sorted in place
+ */
+void bench_output_row(const char* bench, int threads, int cpu_base, int size, bench_samples_t* samples);
+
+/**
+ * @brief start a group of rows to compare (e.g. the same workload with different implementations)
+ *
+ * Only the table format shows it, as a title followed by the header of the columns
+ */
+void bench_output_group(const char* title);
+
+/**
+ * @brief end the output of the results
+ *
+ */
+void bench_output_end(void);
+// ########################################################################################
+
+/**
+ * @brief parse a comma separated list of integers (e.g. "1,2,4")
+ *
+ * @param list string to parse
+ * @param values output, array of at least max elements
+ * @param max maximum number of values
+ * @return int number of values parsed, -1 if the list is not valid
+ */
+int bench_parse_list(const char* list, int* values, int max);
+
+/**
+ * @brief cpu of the i-th scheduler (or thread), spread over the online cpus starting from cpu_base
+ *
+ * @return int cpu, or -1 if cpu_base is -1 (not pinned)
+ */
+int bench_cpu_of(int cpu_base, int i);
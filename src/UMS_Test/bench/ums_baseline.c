@@ -0,0 +1,554 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "ums.h"
+#include "bench_common.h"
+
+/// @file
+/// Comparison of the handoff of libums with the ones of plain Linux threads.
+/// The same two-party workloads (ping-pong and producer/consumer) are written once against a handoff_ops_t
+/// and run with: a ums_scheduler and yield(), a ums_scheduler and switch_to(), and two pthreads that pass the turn with
+/// pthread_cond, futex wake/wait, a pipe or sched_yield() spinning. The two pthreads are pinned to the cpu of the
+/// ums_scheduler (the worker threads inherit its affinity), so each implementation runs on the same core
+///
+
+#define PARTY_0     0   /** ping: measures the round-trip / producer */
+#define PARTY_1     1   /** pong / consumer */
+#define OTHER(me)   (1 - (me))
+
+typedef struct handoff_t handoff_t;
+
+/**
+ * @brief how the two parties pass the turn to each other, only one party runs at a time
+ *
+ * PARTY_0 runs first. A party waits its first turn with wait_first(), passes the turn and waits it back with pass(),
+ * and leaves the turn to the other one for good with give_last()
+ */
+typedef struct handoff_ops_t{
+    const char* name;
+    bool ums;   /** run by a ums_scheduler, otherwise by two pthreads */
+    int (*setup)(handoff_t* h);
+    void (*teardown)(handoff_t* h);
+    void (*wait_first)(handoff_t* h, int me);
+    void (*pass)(handoff_t* h, int me);
+    void (*give_last)(handoff_t* h, int me);
+}handoff_ops_t;
+
+struct handoff_t{
+    const handoff_ops_t* ops;
+    int cpu;
+
+    // handoff
+    int turn;   /** party that owns the turn, futex word */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pipes[2][2];    /** pipes[me] is read by me */
+    ums_context_descriptor_t ucd[2];
+    bool started[2];
+
+    // workload
+    int num_iterations;
+    int queue_size;
+    uint64_t* queue;    /** timestamps of the items produced and not consumed yet */
+    int head;
+    int count;
+    bench_samples_t samples;
+};
+
+// -----------------------------------------------------------------------------------------------------
+static inline int handoff_turn(handoff_t* h){
+    return __atomic_load_n(&h->turn, __ATOMIC_ACQUIRE);
+}
+
+static inline void handoff_set_turn(handoff_t* h, int party){
+    __atomic_store_n(&h->turn, party, __ATOMIC_RELEASE);
+}
+
+static void handoff_nop(handoff_t* h, int me){
+}
+
+static int handoff_setup_nop(handoff_t* h){
+    return 0;
+}
+
+static void handoff_teardown_nop(handoff_t* h){
+}
+
+// ums: the scheduler runs the other party when a party yields, and when it ends
+static void handoff_ums_yield_pass(handoff_t* h, int me){
+    if(yield() != SUCCESS){
+        printf("%s(): yield() failed, errno=%d\n", __func__, errno);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ums: the first pass of PARTY_0 yields to let the scheduler start PARTY_1, then the parties switch directly
+static void handoff_ums_switch_to_pass(handoff_t* h, int me){
+    res_t res;
+
+    if(__atomic_load_n(&h->started[OTHER(me)], __ATOMIC_ACQUIRE))
+        res = switch_to(h->ucd[OTHER(me)]);
+    else
+        res = yield();
+    if(res != SUCCESS){
+        printf("%s(): switch_to() failed, errno=%d\n", __func__, errno);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// pthread_cond
+static int handoff_cond_setup(handoff_t* h){
+    pthread_mutex_init(&h->mutex, NULL);
+    pthread_cond_init(&h->cond, NULL);
+    return 0;
+}
+
+static void handoff_cond_teardown(handoff_t* h){
+    pthread_cond_destroy(&h->cond);
+    pthread_mutex_destroy(&h->mutex);
+}
+
+static void handoff_cond_wait_first(handoff_t* h, int me){
+    pthread_mutex_lock(&h->mutex);
+    while(h->turn != me)
+        pthread_cond_wait(&h->cond, &h->mutex);
+    pthread_mutex_unlock(&h->mutex);
+}
+
+static void handoff_cond_give_last(handoff_t* h, int me){
+    pthread_mutex_lock(&h->mutex);
+    h->turn = OTHER(me);
+    pthread_cond_signal(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+}
+
+static void handoff_cond_pass(handoff_t* h, int me){
+    pthread_mutex_lock(&h->mutex);
+    h->turn = OTHER(me);
+    pthread_cond_signal(&h->cond);
+    while(h->turn != me)
+        pthread_cond_wait(&h->cond, &h->mutex);
+    pthread_mutex_unlock(&h->mutex);
+}
+
+// futex: the turn is the futex word
+static void handoff_futex_wait_first(handoff_t* h, int me){
+    while(handoff_turn(h) != me)
+        syscall(SYS_futex, &h->turn, FUTEX_WAIT_PRIVATE, OTHER(me), NULL, NULL, 0);
+}
+
+static void handoff_futex_give_last(handoff_t* h, int me){
+    handoff_set_turn(h, OTHER(me));
+    syscall(SYS_futex, &h->turn, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void handoff_futex_pass(handoff_t* h, int me){
+    handoff_futex_give_last(h, me);
+    handoff_futex_wait_first(h, me);
+}
+
+// pipe: a byte written in the pipe of the other party
+static int handoff_pipe_setup(handoff_t* h){
+    if(pipe(h->pipes[PARTY_0]) == -1)
+        return -1;
+    if(pipe(h->pipes[PARTY_1]) == -1){
+        close(h->pipes[PARTY_0][0]);
+        close(h->pipes[PARTY_0][1]);
+        return -1;
+    }
+    return 0;
+}
+
+static void handoff_pipe_teardown(handoff_t* h){
+    int i;
+
+    for(i = 0; i < 2; i++){
+        close(h->pipes[i][0]);
+        close(h->pipes[i][1]);
+    }
+}
+
+static void handoff_pipe_wait_first(handoff_t* h, int me){
+    char c;
+
+    if(read(h->pipes[me][0], &c, 1) != 1){
+        printf("%s(): read() failed, errno=%d\n", __func__, errno);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void handoff_pipe_give_last(handoff_t* h, int me){
+    char c = 0;
+
+    if(write(h->pipes[OTHER(me)][1], &c, 1) != 1){
+        printf("%s(): write() failed, errno=%d\n", __func__, errno);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void handoff_pipe_pass(handoff_t* h, int me){
+    handoff_pipe_give_last(h, me);
+    handoff_pipe_wait_first(h, me);
+}
+
+// sched_yield: spin on the turn, leaving the cpu to the other party
+static void handoff_sched_yield_wait_first(handoff_t* h, int me){
+    while(handoff_turn(h) != me)
+        sched_yield();
+}
+
+static void handoff_sched_yield_give_last(handoff_t* h, int me){
+    handoff_set_turn(h, OTHER(me));
+}
+
+static void handoff_sched_yield_pass(handoff_t* h, int me){
+    handoff_set_turn(h, OTHER(me));
+    handoff_sched_yield_wait_first(h, me);
+}
+
+static const handoff_ops_t handoffs[] = {
+    {"ums_yield", true, handoff_setup_nop, handoff_teardown_nop, handoff_nop, handoff_ums_yield_pass, handoff_nop},
+    {"ums_switch_to", true, handoff_setup_nop, handoff_teardown_nop, handoff_nop, handoff_ums_switch_to_pass, handoff_nop},
+    {"pthread_cond", false, handoff_cond_setup, handoff_cond_teardown, handoff_cond_wait_first, handoff_cond_pass, handoff_cond_give_last},
+    {"futex", false, handoff_setup_nop, handoff_teardown_nop, handoff_futex_wait_first, handoff_futex_pass, handoff_futex_give_last},
+    {"pipe", false, handoff_pipe_setup, handoff_pipe_teardown, handoff_pipe_wait_first, handoff_pipe_pass, handoff_pipe_give_last},
+    {"sched_yield", false, handoff_setup_nop, handoff_teardown_nop, handoff_sched_yield_wait_first, handoff_sched_yield_pass, handoff_sched_yield_give_last},
+};
+#define HANDOFF_NUM ((int)(sizeof(handoffs)/sizeof(handoffs[0])))
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief ping-pong: PARTY_0 measures the round-trip of each pass, PARTY_1 passes the turn straight back
+ *
+ */
+static void workload_pingpong(handoff_t* h, int me){
+    uint64_t t0;
+    int i;
+
+    if(me == PARTY_0){
+        bench_samples_begin(&h->samples);
+        for(i = 0; i < h->num_iterations; i++){
+            t0 = bench_now_ns();
+            h->ops->pass(h, me);
+            bench_samples_add(&h->samples, bench_now_ns() - t0);
+        }
+        bench_samples_end(&h->samples);
+    }
+    else{
+        h->ops->wait_first(h, me);
+        for(i = 0; i < h->num_iterations - 1; i++)
+            h->ops->pass(h, me);
+        h->ops->give_last(h, me);
+    }
+}
+
+/**
+ * @brief producer/consumer on a queue of queue_size items: the producer passes the turn when the queue is full,
+ * the consumer when it is empty. A sample is the time from the production of an item to its consumption
+ *
+ */
+static void workload_prodcons(handoff_t* h, int me){
+    int i;
+
+    if(me == PARTY_0){
+        bench_samples_begin(&h->samples);
+        for(i = 0; i < h->num_iterations; i++){
+            if(h->count == h->queue_size)
+                h->ops->pass(h, me);
+            h->queue[(h->head + h->count) % h->queue_size] = bench_now_ns();
+            h->count++;
+        }
+        h->ops->give_last(h, me);
+    }
+    else{
+        h->ops->wait_first(h, me);
+        for(i = 0; i < h->num_iterations; ){
+            if(h->count == 0){
+                h->ops->pass(h, me);
+                continue;
+            }
+            bench_samples_add(&h->samples, bench_now_ns() - h->queue[h->head]);
+            h->head = (h->head + 1) % h->queue_size;
+            h->count--;
+            i++;
+        }
+        bench_samples_end(&h->samples);
+    }
+}
+
+typedef struct workload_t{
+    const char* name;
+    const char* title;
+    void (*run)(handoff_t* h, int me);
+}workload_t;
+
+static const workload_t workloads[] = {
+    {"pingpong", "round-trip of a ping-pong", workload_pingpong},
+    {"prodcons", "producer/consumer, from the production of an item to its consumption", workload_prodcons},
+};
+#define WORKLOAD_NUM    ((int)(sizeof(workloads)/sizeof(workloads[0])))
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+typedef struct party_args_t{
+    handoff_t* h;
+    const workload_t* workload;
+    int me;
+}party_args_t;
+
+static void* party_routine(void* args){
+    party_args_t* p = args;
+
+    __atomic_store_n(&p->h->started[p->me], true, __ATOMIC_RELEASE);
+    p->workload->run(p->h, p->me);
+    return NULL;
+}
+
+static void* party_thread(void* args){
+    party_args_t* p = args;
+    cpu_set_t cpu_set;
+
+    if(p->h->cpu >= 0){
+        CPU_ZERO(&cpu_set);
+        CPU_SET(p->h->cpu, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+    return party_routine(args);
+}
+
+/**
+ * @brief run the new ums_contexts first (PARTY_0 then PARTY_1), then the ready ones in order, exit when both ended
+ *
+ */
+static void entry_point_baseline(entry_point_args_t* entry_point_args){
+    int res;
+
+    switch(entry_point_args->reason){
+        case REASON_STARTUP:
+            res = execute_next_new_thread();
+        break;
+
+        case REASON_THREAD_BLOCKED:
+            // the ums_context goes in the ready_list when its thread wakes up
+            park_scheduler();
+            // fall through
+        default:
+            res = execute_next_new_thread();
+            if(res == -1 && errno == ERR_EMPTY_COMP_LIST){
+                res = execute_next_ready_thread();
+                if(res == -1 && errno == ERR_EMPTY_READY_LIST && entry_point_args->reason == REASON_THREAD_ENDED){
+                    exit_scheduler(0);
+                    return;
+                }
+            }
+        break;
+    }
+
+    if(res == -1){
+        printf("%s(): unexpected errno=%d\n", __func__, errno);
+        exit_scheduler(EXIT_FAILURE);
+    }
+}
+
+static int run_ums(handoff_t* h, party_args_t* parties){
+    ums_completion_list_descriptor_t cld;
+    ums_scheduler_descriptor_t sd;
+    int i, ret;
+
+    if(create_ums_completion_list(&cld) != SUCCESS)
+        return -1;
+    for(i = 0; i < 2; i++){
+        if(create_ums_context(&h->ucd[i], party_routine, &parties[i], NULL) != SUCCESS
+                || completion_list_add_ums_context(cld, h->ucd[i]) != SUCCESS)
+            return -1;
+    }
+
+    if(create_ums_scheduler(&sd, cld, entry_point_baseline, h, h->cpu) != SUCCESS)
+        return -1;
+    join_scheduler(&sd, &ret);
+
+    delete_ums_completion_list(cld);
+    for(i = 0; i < 2; i++)
+        delete_ums_context(h->ucd[i]);
+    return (ret == 0)? 0 : -1;
+}
+
+static int run_threads(handoff_t* h, party_args_t* parties){
+    pthread_t threads[2];
+    int i;
+
+    for(i = 0; i < 2; i++){
+        if(pthread_create(&threads[i], NULL, party_thread, &parties[i]) != 0)
+            return -1;
+    }
+    for(i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+    return 0;
+}
+
+static int run(const workload_t* workload, const handoff_ops_t* ops, int cpu, int num_iterations, int queue_size){
+    handoff_t h;
+    party_args_t parties[2];
+    char name[64];
+    int i, res;
+
+    memset(&h, 0, sizeof(h));
+    h.ops = ops;
+    h.cpu = cpu;
+    h.turn = PARTY_0;
+    h.num_iterations = num_iterations;
+    h.queue_size = queue_size;
+    h.queue = malloc(sizeof(uint64_t) * queue_size);
+    if(h.queue == NULL || bench_samples_init(&h.samples, num_iterations) != 0 || ops->setup(&h) != 0){
+        free(h.queue);
+        return -1;
+    }
+    for(i = 0; i < 2; i++){
+        parties[i].h = &h;
+        parties[i].workload = workload;
+        parties[i].me = i;
+    }
+
+    res = (ops->ums)? run_ums(&h, parties) : run_threads(&h, parties);
+    if(res == 0){
+        snprintf(name, sizeof(name), "%s_%s", workload->name, ops->name);
+        bench_output_row(name, 2, cpu, (workload->run == workload_prodcons)? queue_size : 0, &h.samples);
+    }
+
+    ops->teardown(&h);
+    bench_samples_free(&h.samples);
+    free(h.queue);
+    return res;
+}
+// -----------------------------------------------------------------------------------------------------
+
+static void usage(const char* prog){
+    int i;
+
+    fprintf(stderr,
+            "usage: %s [-w workload,...] [-i impl,...] [-c cpu] [-n iterations] [-q queue_size] [-o table|csv|json]\n"
+            "  -w  workloads (default all):", prog);
+    for(i = 0; i < WORKLOAD_NUM; i++)
+        fprintf(stderr, " %s", workloads[i].name);
+    fprintf(stderr, "\n  -i  implementations (default all):");
+    for(i = 0; i < HANDOFF_NUM; i++)
+        fprintf(stderr, " %s", handoffs[i].name);
+    fprintf(stderr, "\n"
+            "  -c  cpu of both parties (default 0), -1 not pinned\n"
+            "  -n  round-trips of pingpong, items of prodcons (default 100000)\n"
+            "  -q  queue size of prodcons (default 64)\n"
+            "  -o  output format on stdout (default table), the messages go to stderr\n");
+}
+
+/**
+ * @brief select the names of a comma separated list, all of them if the list is empty
+ *
+ * @return int Returns 0 on success, otherwise -1 (unknown name)
+ */
+static int select_names(char* list, const char* (*name_of)(int), int num, bool* selected){
+    char* name;
+    int i;
+
+    for(i = 0; i < num; i++)
+        selected[i] = (list[0] == '\0');
+    for(name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")){
+        for(i = 0; i < num && strcmp(name, name_of(i)) != 0; i++);
+        if(i == num){
+            fprintf(stderr, "unknown name %s\n", name);
+            return -1;
+        }
+        selected[i] = true;
+    }
+    return 0;
+}
+
+static const char* workload_name(int i){
+    return workloads[i].name;
+}
+
+static const char* handoff_name(int i){
+    return handoffs[i].name;
+}
+
+int main(int argc, char **argv){
+    char workload_list[256] = "";
+    char handoff_list[256] = "";
+    bool workload_selected[WORKLOAD_NUM];
+    bool handoff_selected[HANDOFF_NUM];
+    bench_format_t format = BENCH_FORMAT_TABLE;
+    bool ums_available;
+    int cpu = 0;
+    int num_iterations = 100000;
+    int queue_size = 64;
+    char title[160];
+    int opt, i, j;
+    int res = 0;
+
+    while((opt = getopt(argc, argv, "w:i:c:n:q:o:h")) != -1){
+        switch(opt){
+            case 'w': snprintf(workload_list, sizeof(workload_list), "%s", optarg); break;
+            case 'i': snprintf(handoff_list, sizeof(handoff_list), "%s", optarg); break;
+            case 'c': cpu = atoi(optarg); break;
+            case 'n': num_iterations = atoi(optarg); break;
+            case 'q': queue_size = atoi(optarg); break;
+            case 'o':
+                if(bench_format_parse(optarg, &format) != 0){
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(num_iterations < 1 || queue_size < 1 || cpu < -1 || cpu >= sysconf(_SC_NPROCESSORS_ONLN)
+            || select_names(workload_list, workload_name, WORKLOAD_NUM, workload_selected) != 0
+            || select_names(handoff_list, handoff_name, HANDOFF_NUM, handoff_selected) != 0){
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ums_available = (ums_init() == SUCCESS);
+    if(!ums_available)
+        fprintf(stderr, "ums_init() failed, is the module loaded? Only the pthread implementations are run\n");
+
+    if(bench_output_begin(format) != 0){
+        fprintf(stderr, "output not available\n");
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < WORKLOAD_NUM && res == 0; i++){
+        if(!workload_selected[i])
+            continue;
+        snprintf(title, sizeof(title), "%s: %s, cpu %d", workloads[i].name, workloads[i].title, cpu);
+        bench_output_group(title);
+
+        for(j = 0; j < HANDOFF_NUM && res == 0; j++){
+            if(!handoff_selected[j] || (handoffs[j].ums && !ums_available))
+                continue;
+            res = run(&workloads[i], &handoffs[j], cpu, num_iterations, queue_size);
+            if(res != 0)
+                fprintf(stderr, "%s with %s failed\n", workloads[i].name, handoffs[j].name);
+        }
+    }
+
+    bench_output_end();
+    if(ums_available)
+        ums_destroy();
+
+    return (res == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,748 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+
+#include "ums.h"
+#include "bench_common.h"
+
+/// @file
+/// Microbenchmarks of libums and of the UMS kernel module.
+/// Each benchmark is run for every number of schedulers given with -s: every scheduler has its own
+/// ums_completion_list (no stealing between them) and is pinned to cpu_base+i if -c is given.
+/// The results of all the schedulers are merged in a single row
+///
+
+typedef struct bench_config_t{
+    int num_iterations; /** samples for each scheduler (or thread) */
+    int num_reps;   /** get_ums_contexts_from_cl/rl calls for each list size */
+    int cpu_base;   /** -1 if not pinned */
+    int pool_size;  /** worker pool of the schedulers, 0 to create a thread for each ums_context */
+    int sizes[BENCH_LIST_MAX];  /** list sizes of get_cl and get_rl */
+    int num_sizes;
+}bench_config_t;
+
+/**
+ * @brief state of a scheduler (or thread) during a benchmark, passed as sched_args and as args of its ums_contexts
+ *
+ */
+typedef struct bench_sched_t{
+    int index;
+    int cpu;
+    int size;   /** length of the lists for get_cl and get_rl */
+    int num_iterations;
+    int num_reps;
+
+    ums_completion_list_descriptor_t cld;
+    ums_context_descriptor_t* ucds;
+    int num_ucds;
+    ums_scheduler_descriptor_t sd;
+
+    bench_samples_t samples;
+
+    bool mark_execute;  /** if true the scheduler stores in execute_ns the time of each execute */
+    uint64_t execute_ns;
+    bool measured;  /** get_rl: the ready_list has been measured */
+    info_ums_context_t* info;
+}bench_sched_t;
+
+static bench_config_t config = {
+    .num_iterations = 10000,
+    .num_reps = 1000,
+    .cpu_base = -1,
+    .pool_size = 0,
+    .sizes = {1, 16, 256, 1024},
+    .num_sizes = 4
+};
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief timestamp read by a worker, the time taken by its scheduler just before the execute that resumed it
+ *
+ */
+static inline uint64_t bench_execute_ns(bench_sched_t* s){
+    return __atomic_load_n(&s->execute_ns, __ATOMIC_ACQUIRE);
+}
+
+static inline void bench_mark_execute(bench_sched_t* s){
+    if(s->mark_execute)
+        __atomic_store_n(&s->execute_ns, bench_now_ns(), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief create num ums_contexts with routine(s) and add them to the ums_completion_list of s
+ *
+ */
+static int bench_sched_fill_cl(bench_sched_t* s, void* (*routine)(void*), int num){
+    ums_context_batch_item_t* items;
+    int i, chunk;
+
+    s->ucds = malloc(sizeof(ums_context_descriptor_t) * (num > 0? num : 1));
+    items = malloc(sizeof(ums_context_batch_item_t) * UMS_BATCH_MAX);
+    if(s->ucds == NULL || items == NULL){
+        free(items);
+        return -1;
+    }
+    for(i = 0; i < UMS_BATCH_MAX; i++){
+        items[i].routine = routine;
+        items[i].args = s;
+        items[i].user_res = NULL;
+        items[i].prio = UMS_PRIO_DEFAULT;
+    }
+
+    for(i = 0; i < num; i += chunk){
+        chunk = (num - i < UMS_BATCH_MAX)? num - i : UMS_BATCH_MAX;
+        if(create_ums_contexts_batch(&s->ucds[i], items, chunk) != SUCCESS){
+            free(items);
+            return -1;
+        }
+        s->num_ucds += chunk;
+        if(completion_list_add_batch(s->cld, &s->ucds[i], chunk) != SUCCESS){
+            free(items);
+            return -1;
+        }
+    }
+    free(items);
+    return 0;
+}
+
+static void bench_sched_clean(bench_sched_t* s){
+    int i;
+
+    delete_ums_completion_list(s->cld);
+    for(i = 0; i < s->num_ucds; i++)
+        delete_ums_context(s->ucds[i]);
+    free(s->ucds);
+    free(s->info);
+    bench_samples_free(&s->samples);
+}
+
+/**
+ * @brief run a benchmark on num_scheds schedulers and write its row
+ *
+ * @param name name of the benchmark
+ * @param num_scheds number of schedulers
+ * @param size length of the lists (get_cl, get_rl), 0 otherwise
+ * @param num_contexts number of ums_contexts of each scheduler
+ * @param num_samples samples of each scheduler
+ * @param mark_execute if true the schedulers store the time of each execute
+ * @return int Returns 0 on success, otherwise -1
+ */
+static int bench_run_schedulers(const char* name, int num_scheds, int size, int num_contexts, int num_samples, bool mark_execute,
+                                void* (*routine)(void*), void (*entry_point)(entry_point_args_t*)){
+    bench_sched_t* scheds;
+    bench_samples_t all;
+    ums_scheduler_attr_t attr;
+    int i, ret_sched;
+    int res = 0;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.pool_size = config.pool_size;
+    attr.pool_warm_up = config.pool_size;
+
+    scheds = calloc(num_scheds, sizeof(bench_sched_t));
+    if(scheds == NULL || bench_samples_init(&all, num_scheds * num_samples) != 0){
+        free(scheds);
+        return -1;
+    }
+
+    for(i = 0; i < num_scheds; i++){
+        bench_sched_t* s = &scheds[i];
+        s->index = i;
+        s->cpu = bench_cpu_of(config.cpu_base, i);
+        s->size = size;
+        s->num_iterations = config.num_iterations;
+        s->num_reps = config.num_reps;
+        s->mark_execute = mark_execute;
+        if(bench_samples_init(&s->samples, num_samples) != 0)
+            return -1;
+        if(size > 0 && (s->info = malloc(sizeof(info_ums_context_t) * size)) == NULL)
+            return -1;
+        if(create_ums_completion_list(&s->cld) != SUCCESS || bench_sched_fill_cl(s, routine, num_contexts) != 0){
+            printf("%s: setup of scheduler %d failed, errno=%d\n", name, i, errno);
+            return -1;
+        }
+    }
+
+    for(i = 0; i < num_scheds; i++){
+        if(create_ums_scheduler_attr(&scheds[i].sd, scheds[i].cld, entry_point, &scheds[i], scheds[i].cpu, &attr) != SUCCESS){
+            printf("%s: create_ums_scheduler_attr() failed, errno=%d\n", name, errno);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(i = 0; i < num_scheds; i++){
+        join_scheduler(&scheds[i].sd, &ret_sched);
+        if(ret_sched != 0){
+            printf("%s: scheduler %d returned %d\n", name, i, ret_sched);
+            res = -1;
+        }
+        bench_samples_merge(&all, &scheds[i].samples);
+        bench_sched_clean(&scheds[i]);
+    }
+
+    if(res == 0)
+        bench_output_row(name, num_scheds, config.cpu_base, size, &all);
+    bench_samples_free(&all);
+    free(scheds);
+    return res;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief entry_point that runs the ums_contexts of the completion_list one after the other, resuming each one
+ * after a yield, and exits when the completion_list is empty
+ *
+ */
+static void entry_point_run(entry_point_args_t* entry_point_args){
+    bench_sched_t* s = entry_point_args->sched_args;
+    int res;
+
+    switch(entry_point_args->reason){
+        case REASON_STARTUP:
+        case REASON_THREAD_ENDED:
+            bench_mark_execute(s);
+            res = execute_next_new_thread();
+            if(res == -1 && errno == ERR_EMPTY_COMP_LIST){
+                exit_scheduler(0);
+                return;
+            }
+        break;
+
+        case REASON_THREAD_BLOCKED:
+            // the ums_context goes in the ready_list when its thread wakes up
+            park_scheduler();
+            // fall through
+        default:
+            bench_mark_execute(s);
+            res = execute_next_ready_thread();
+        break;
+    }
+
+    if(res == -1){
+        printf("%s(): scheduler %d, unexpected errno=%d\n", __func__, s->index, errno);
+        exit_scheduler(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief yield round-trip: from the yield of the worker to its resume, through the scheduler
+ *
+ */
+static void* routine_yield(void* args){
+    bench_sched_t* s = args;
+    uint64_t t0;
+    int i;
+
+    bench_samples_begin(&s->samples);
+    for(i = 0; i < s->num_iterations; i++){
+        t0 = bench_now_ns();
+        yield();
+        bench_samples_add(&s->samples, bench_now_ns() - t0);
+    }
+    bench_samples_end(&s->samples);
+    return NULL;
+}
+
+/**
+ * @brief execute from the completion_list: from execute_next_new_thread() to the first instruction of the routine
+ *
+ */
+static void* routine_execute_cl(void* args){
+    bench_sched_t* s = args;
+    uint64_t now = bench_now_ns();
+
+    bench_samples_add(&s->samples, now - bench_execute_ns(s));
+    if(s->samples.begin_ns == 0)
+        s->samples.begin_ns = bench_execute_ns(s);
+    s->samples.end_ns = now;
+    return NULL;
+}
+
+/**
+ * @brief execute from the ready_list: from execute_next_ready_thread() to the return of the yield of the worker
+ *
+ */
+static void* routine_execute_rl(void* args){
+    bench_sched_t* s = args;
+    int i;
+
+    bench_samples_begin(&s->samples);
+    for(i = 0; i < s->num_iterations; i++){
+        yield();
+        bench_samples_add(&s->samples, bench_now_ns() - bench_execute_ns(s));
+    }
+    bench_samples_end(&s->samples);
+    return NULL;
+}
+
+/**
+ * @brief lookup: yields num_iterations times, each yield is a sample of its scheduler
+ *
+ */
+static void* routine_yield_loop(void* args){
+    bench_sched_t* s = args;
+    int i;
+
+    for(i = 0; i < s->num_iterations; i++)
+        yield();
+    return NULL;
+}
+
+static void* routine_empty(void* args){
+    return NULL;
+}
+
+static void* routine_yield_once(void* args){
+    yield();
+    return NULL;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief measure get_ums_contexts_from_cl() with the whole completion_list at startup, then run it
+ *
+ */
+static void entry_point_get_cl(entry_point_args_t* entry_point_args){
+    bench_sched_t* s = entry_point_args->sched_args;
+    int expected = (s->size < UMS_BATCH_MAX)? s->size : UMS_BATCH_MAX;
+    uint64_t t0;
+    int i, res;
+
+    if(entry_point_args->reason == REASON_STARTUP){
+        bench_samples_begin(&s->samples);
+        for(i = 0; i < s->num_reps; i++){
+            t0 = bench_now_ns();
+            res = get_ums_contexts_from_cl(s->info, s->size);
+            bench_samples_add(&s->samples, bench_now_ns() - t0);
+            if(res != expected){
+                printf("%s(): scheduler %d, read %d ums_contexts instead of %d, errno=%d\n", __func__, s->index, res, expected, errno);
+                exit_scheduler(EXIT_FAILURE);
+                return;
+            }
+        }
+        bench_samples_end(&s->samples);
+    }
+    entry_point_run(entry_point_args);
+}
+
+/**
+ * @brief start the ums_contexts one by one, each one yields once; when the completion_list is empty all of them
+ * are in the ready_list: measure get_ums_contexts_from_rl(), then resume them until the ready_list is empty
+ *
+ */
+static void entry_point_get_rl(entry_point_args_t* entry_point_args){
+    bench_sched_t* s = entry_point_args->sched_args;
+    uint64_t t0;
+    int i, res;
+
+    switch(entry_point_args->reason){
+        case REASON_STARTUP:
+            res = execute_next_new_thread();
+        break;
+
+        case REASON_THREAD_YIELD:
+            res = execute_next_new_thread();
+            if(res == 0 || errno != ERR_EMPTY_COMP_LIST)
+                break;
+
+            bench_samples_begin(&s->samples);
+            for(i = 0; i < s->num_reps; i++){
+                t0 = bench_now_ns();
+                res = get_ums_contexts_from_rl(s->info, s->size);
+                bench_samples_add(&s->samples, bench_now_ns() - t0);
+                if(res != s->size){
+                    printf("%s(): scheduler %d, read %d ums_contexts instead of %d, errno=%d\n", __func__, s->index, res, s->size, errno);
+                    exit_scheduler(EXIT_FAILURE);
+                    return;
+                }
+            }
+            bench_samples_end(&s->samples);
+            s->measured = true;
+            res = execute_next_ready_thread();
+        break;
+
+        case REASON_THREAD_BLOCKED:
+            park_scheduler();
+            // fall through
+        default:
+            res = execute_next_ready_thread();
+            if(res == -1 && errno == ERR_EMPTY_READY_LIST && s->measured){
+                exit_scheduler(0);
+                return;
+            }
+        break;
+    }
+
+    if(res == -1){
+        printf("%s(): scheduler %d, unexpected errno=%d\n", __func__, s->index, errno);
+        exit_scheduler(EXIT_FAILURE);
+    }
+}
+// -----------------------------------------------------------------------------------------------------
+
+/**
+ * @brief lookup: after each yield, resume the ums_context with get_ums_contexts_from_rl() and execute().
+ * A sample is the time of the two requests, that look up the scheduler by pid and the ums_context by ucd:
+ * their cost as the number of concurrently switching schedulers grows
+ *
+ */
+static void entry_point_lookup(entry_point_args_t* entry_point_args){
+    bench_sched_t* s = entry_point_args->sched_args;
+    uint64_t t0;
+    int res;
+
+    if(entry_point_args->reason != REASON_THREAD_YIELD){
+        entry_point_run(entry_point_args);
+        return;
+    }
+
+    bench_samples_begin(&s->samples);
+    t0 = bench_now_ns();
+    res = get_ums_contexts_from_rl(s->info, 1);
+    if(res == 1)
+        res = execute(&s->info[0]);
+    else if(res >= 0)
+        res = -1;
+    bench_samples_add(&s->samples, bench_now_ns() - t0);
+    bench_samples_end(&s->samples);
+
+    if(res != 0){
+        printf("%s(): scheduler %d, unexpected errno=%d\n", __func__, s->index, errno);
+        exit_scheduler(EXIT_FAILURE);
+    }
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+typedef struct bench_thread_t{
+    pthread_t thread;
+    int cpu;
+    bench_samples_t samples_a;
+    bench_samples_t samples_b;
+}bench_thread_t;
+
+static void bench_pin_self(int cpu){
+    cpu_set_t cpu_set;
+
+    if(cpu < 0)
+        return;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+/**
+ * @brief create then delete num_iterations ums_contexts, samples_a are the creations and samples_b the deletions
+ *
+ */
+static void* thread_create_delete(void* args){
+    bench_thread_t* t = args;
+    ums_context_descriptor_t* ucds;
+    uint64_t t0;
+    int i;
+
+    bench_pin_self(t->cpu);
+    ucds = malloc(sizeof(ums_context_descriptor_t) * config.num_iterations);
+    if(ucds == NULL)
+        return (void*)-1L;
+
+    bench_samples_begin(&t->samples_a);
+    for(i = 0; i < config.num_iterations; i++){
+        t0 = bench_now_ns();
+        if(create_ums_context(&ucds[i], routine_empty, NULL, NULL) != SUCCESS){
+            printf("%s(): create_ums_context() failed, errno=%d\n", __func__, errno);
+            exit(EXIT_FAILURE);
+        }
+        bench_samples_add(&t->samples_a, bench_now_ns() - t0);
+    }
+    bench_samples_end(&t->samples_a);
+
+    bench_samples_begin(&t->samples_b);
+    for(i = 0; i < config.num_iterations; i++){
+        t0 = bench_now_ns();
+        if(delete_ums_context(ucds[i]) != SUCCESS){
+            printf("%s(): delete_ums_context() failed, errno=%d\n", __func__, errno);
+            exit(EXIT_FAILURE);
+        }
+        bench_samples_add(&t->samples_b, bench_now_ns() - t0);
+    }
+    bench_samples_end(&t->samples_b);
+
+    free(ucds);
+    return NULL;
+}
+
+/**
+ * @brief add then remove num_iterations ums_contexts to a completion_list of the thread,
+ * samples_a are the additions and samples_b the removals
+ *
+ */
+static void* thread_cl_add_remove(void* args){
+    bench_thread_t* t = args;
+    ums_completion_list_descriptor_t cld;
+    ums_context_descriptor_t* ucds;
+    uint64_t t0;
+    int i;
+
+    bench_pin_self(t->cpu);
+    ucds = malloc(sizeof(ums_context_descriptor_t) * config.num_iterations);
+    if(ucds == NULL || create_ums_completion_list(&cld) != SUCCESS)
+        return (void*)-1L;
+    for(i = 0; i < config.num_iterations; i++){
+        if(create_ums_context(&ucds[i], routine_empty, NULL, NULL) != SUCCESS){
+            printf("%s(): create_ums_context() failed, errno=%d\n", __func__, errno);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    bench_samples_begin(&t->samples_a);
+    for(i = 0; i < config.num_iterations; i++){
+        t0 = bench_now_ns();
+        if(completion_list_add_ums_context(cld, ucds[i]) != SUCCESS){
+            printf("%s(): completion_list_add_ums_context() failed, errno=%d\n", __func__, errno);
+            exit(EXIT_FAILURE);
+        }
+        bench_samples_add(&t->samples_a, bench_now_ns() - t0);
+    }
+    bench_samples_end(&t->samples_a);
+
+    bench_samples_begin(&t->samples_b);
+    for(i = 0; i < config.num_iterations; i++){
+        t0 = bench_now_ns();
+        if(completion_list_remove_ums_context(cld, ucds[i]) != SUCCESS){
+            printf("%s(): completion_list_remove_ums_context() failed, errno=%d\n", __func__, errno);
+            exit(EXIT_FAILURE);
+        }
+        bench_samples_add(&t->samples_b, bench_now_ns() - t0);
+    }
+    bench_samples_end(&t->samples_b);
+
+    delete_ums_completion_list(cld);
+    for(i = 0; i < config.num_iterations; i++)
+        delete_ums_context(ucds[i]);
+    free(ucds);
+    return NULL;
+}
+
+/**
+ * @brief run routine on num_threads pthreads (not schedulers: these requests do not need one) and write two rows
+ *
+ */
+static int bench_run_threads(const char* name_a, const char* name_b, int num_threads, void* (*routine)(void*)){
+    bench_thread_t* threads;
+    bench_samples_t all_a, all_b;
+    void* ret;
+    int i;
+    int res = 0;
+
+    threads = calloc(num_threads, sizeof(bench_thread_t));
+    if(threads == NULL)
+        return -1;
+    if(bench_samples_init(&all_a, num_threads * config.num_iterations) != 0
+            || bench_samples_init(&all_b, num_threads * config.num_iterations) != 0)
+        return -1;
+
+    for(i = 0; i < num_threads; i++){
+        threads[i].cpu = bench_cpu_of(config.cpu_base, i);
+        if(bench_samples_init(&threads[i].samples_a, config.num_iterations) != 0
+                || bench_samples_init(&threads[i].samples_b, config.num_iterations) != 0)
+            return -1;
+        pthread_create(&threads[i].thread, NULL, routine, &threads[i]);
+    }
+
+    for(i = 0; i < num_threads; i++){
+        pthread_join(threads[i].thread, &ret);
+        if(ret != NULL)
+            res = -1;
+        bench_samples_merge(&all_a, &threads[i].samples_a);
+        bench_samples_merge(&all_b, &threads[i].samples_b);
+        bench_samples_free(&threads[i].samples_a);
+        bench_samples_free(&threads[i].samples_b);
+    }
+
+    if(res == 0){
+        bench_output_row(name_a, num_threads, config.cpu_base, 0, &all_a);
+        bench_output_row(name_b, num_threads, config.cpu_base, 0, &all_b);
+    }
+    bench_samples_free(&all_a);
+    bench_samples_free(&all_b);
+    free(threads);
+    return res;
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+static int bench_yield(int num_scheds){
+    return bench_run_schedulers("yield", num_scheds, 0, 1, config.num_iterations, false, routine_yield, entry_point_run);
+}
+
+static int bench_execute_cl(int num_scheds){
+    return bench_run_schedulers("execute_cl", num_scheds, 0, config.num_iterations, config.num_iterations, true, routine_execute_cl, entry_point_run);
+}
+
+static int bench_execute_rl(int num_scheds){
+    return bench_run_schedulers("execute_rl", num_scheds, 0, 1, config.num_iterations, true, routine_execute_rl, entry_point_run);
+}
+
+static int bench_create_delete(int num_scheds){
+    return bench_run_threads("create_context", "delete_context", num_scheds, thread_create_delete);
+}
+
+static int bench_cl_add_remove(int num_scheds){
+    return bench_run_threads("cl_add", "cl_remove", num_scheds, thread_cl_add_remove);
+}
+
+static int bench_get_cl(int num_scheds){
+    int i;
+
+    for(i = 0; i < config.num_sizes; i++){
+        if(bench_run_schedulers("get_cl", num_scheds, config.sizes[i], config.sizes[i], config.num_reps, false, routine_empty, entry_point_get_cl) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int bench_get_rl(int num_scheds){
+    int i;
+
+    for(i = 0; i < config.num_sizes; i++){
+        if(bench_run_schedulers("get_rl", num_scheds, config.sizes[i], config.sizes[i], config.num_reps, false, routine_yield_once, entry_point_get_rl) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int bench_lookup(int num_scheds){
+    return bench_run_schedulers("lookup", num_scheds, 1, 1, config.num_iterations, false, routine_yield_loop, entry_point_lookup);
+}
+
+typedef struct bench_t{
+    const char* name;
+    int (*run)(int num_scheds);
+}bench_t;
+
+static const bench_t benches[] = {
+    {"yield", bench_yield},
+    {"execute_cl", bench_execute_cl},
+    {"execute_rl", bench_execute_rl},
+    {"create_delete", bench_create_delete},
+    {"cl_add_remove", bench_cl_add_remove},
+    {"get_cl", bench_get_cl},
+    {"get_rl", bench_get_rl},
+    {"lookup", bench_lookup},
+};
+#define BENCH_NUM   ((int)(sizeof(benches)/sizeof(benches[0])))
+// -----------------------------------------------------------------------------------------------------
+
+static void usage(const char* prog){
+    int i;
+
+    fprintf(stderr,
+            "usage: %s [-b bench,...] [-s schedulers,...] [-c cpu_base] [-n iterations] [-r reps] [-l sizes,...] [-p pool_size] [-o csv|json|table]\n"
+            "  -b  benchmarks to run (default all):", prog);
+    for(i = 0; i < BENCH_NUM; i++)
+        fprintf(stderr, " %s", benches[i].name);
+    fprintf(stderr, "\n"
+            "  -s  numbers of schedulers (or threads) to run each benchmark with (default 1)\n"
+            "  -c  pin the i-th scheduler to cpu_base+i (default -1, not pinned)\n"
+            "  -n  samples per scheduler of yield, execute_cl, execute_rl, create_delete, cl_add_remove, lookup (default %d)\n"
+            "  -r  calls per scheduler and list size of get_cl, get_rl (default %d)\n"
+            "  -l  list sizes of get_cl, get_rl (default 1,16,256,1024)\n"
+            "  -p  worker pool size of the schedulers (default 0)\n"
+            "  -o  output format on stdout (default csv), the messages go to stderr\n",
+            config.num_iterations, config.num_reps);
+}
+
+int main(int argc, char **argv){
+    char bench_list[256] = "";
+    bool selected[BENCH_NUM];
+    int sched_counts[BENCH_LIST_MAX] = {1};
+    int num_sched_counts = 1;
+    bench_format_t format = BENCH_FORMAT_CSV;
+    char* name;
+    int opt, i, j;
+    int res = 0;
+
+    while((opt = getopt(argc, argv, "b:s:c:n:r:l:p:o:h")) != -1){
+        switch(opt){
+            case 'b': snprintf(bench_list, sizeof(bench_list), "%s", optarg); break;
+            case 's': num_sched_counts = bench_parse_list(optarg, sched_counts, BENCH_LIST_MAX); break;
+            case 'c': config.cpu_base = atoi(optarg); break;
+            case 'n': config.num_iterations = atoi(optarg); break;
+            case 'r': config.num_reps = atoi(optarg); break;
+            case 'l': config.num_sizes = bench_parse_list(optarg, config.sizes, BENCH_LIST_MAX); break;
+            case 'p': config.pool_size = atoi(optarg); break;
+            case 'o':
+                if(bench_format_parse(optarg, &format) != 0){
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(num_sched_counts < 1 || config.num_sizes < 1 || config.num_iterations < 1 || config.num_reps < 1){
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    for(i = 0; i < num_sched_counts; i++){
+        if(sched_counts[i] < 1){
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    for(i = 0; i < config.num_sizes; i++){
+        if(config.sizes[i] < 1){
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(i = 0; i < BENCH_NUM; i++)
+        selected[i] = (bench_list[0] == '\0');
+    for(name = strtok(bench_list, ","); name != NULL; name = strtok(NULL, ",")){
+        for(i = 0; i < BENCH_NUM && strcmp(name, benches[i].name) != 0; i++);
+        if(i == BENCH_NUM){
+            fprintf(stderr, "unknown benchmark %s\n", name);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        selected[i] = true;
+    }
+
+    if(ums_init() != SUCCESS){
+        fprintf(stderr, "ums_init() failed, is the module loaded?\n");
+        return EXIT_FAILURE;
+    }
+    if(bench_output_begin(format) != 0){
+        fprintf(stderr, "output not available\n");
+        return EXIT_FAILURE;
+    }
+
+    for(i = 0; i < BENCH_NUM && res == 0; i++){
+        if(!selected[i])
+            continue;
+        for(j = 0; j < num_sched_counts && res == 0; j++){
+            res = benches[i].run(sched_counts[j]);
+            if(res != 0)
+                fprintf(stderr, "%s with %d schedulers failed\n", benches[i].name, sched_counts[j]);
+        }
+    }
+
+    bench_output_end();
+    ums_destroy();
+
+    return (res == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,665 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/sysinfo.h>
+
+#include "ums.h"
+#include "bench_common.h"
+
+/// @file
+/// Stress test of libums and of the UMS kernel module.
+/// N ums_completion_lists are shared by M schedulers (the j-th one manages the list j%N and is pinned to the cpu j%ncpus),
+/// K ums_contexts run slices of random length and then yield, block (usleep) or end. An ended ums_context is replaced by
+/// a new one in the list of the scheduler, so the load is constant until the end of the run.
+/// A watchdog fails the run if a scheduler that is not parked stops making progress, if nothing progresses at all,
+/// or if the schedulers do not exit at the end: all of them are lost wake ups (or deadlocks) of the module
+///
+
+#define STRESS_SAMPLES_MAX  65536   /** user-side samples of each request for each scheduler */
+#define STRESS_PROC_MAX     4096    /** bytes of a /proc file that are reported */
+
+typedef struct stress_config_t{
+    int num_lists;
+    int num_scheds;
+    int num_contexts;
+    int duration_s;
+    int work_us;    /** maximum length of a slice of a ums_context */
+    int end_permille;   /** probability that a ums_context ends after a slice */
+    int block_permille; /** probability that a ums_context blocks (usleep) after a slice */
+    int watchdog_s;
+    int pool_size;
+    bool pinned;
+    bool verbose;
+}stress_config_t;
+
+/**
+ * @brief state of a scheduler, written by its thread and read by the watchdog and by the main thread
+ *
+ */
+typedef struct stress_sched_t{
+    int index;
+    int cpu;
+    int list;
+    ums_scheduler_descriptor_t sd;
+    pid_t pid;
+    unsigned int seed;
+
+    unsigned long switches;  /** calls of the entry_point for a yield, an end or a block */
+    unsigned long yields;
+    unsigned long ends;
+    unsigned long blocks;
+    unsigned long parks;
+    unsigned long created;  /** ums_contexts created to replace the ended ones */
+
+    uint64_t last_progress_ns;  /** last call of the entry_point or return from park_scheduler() */
+    int last_reason;
+    bool parked;
+    bool exited;
+
+    bench_samples_t execute_ns; /** execute_next_new_thread() and execute_next_ready_thread() */
+    bench_samples_t replace_ns; /** create_ums_context() and completion_list_add_ums_context() of a replacement */
+    bench_samples_t park_ns;    /** time spent in park_scheduler() */
+
+    char info[STRESS_PROC_MAX]; /** /proc/ums/<tgid>/schedulers/<pid>/info at the end of the run */
+    char latency[STRESS_PROC_MAX];  /** /proc/ums/<tgid>/schedulers/<pid>/latency at the end of the run */
+}stress_sched_t;
+
+/**
+ * @brief arguments of a ums_context, freed by its routine
+ *
+ */
+typedef struct stress_context_t{
+    unsigned int seed;
+}stress_context_t;
+
+static stress_config_t config = {
+    .num_lists = 4,
+    .num_scheds = 0,    // number of cpus, at least num_lists
+    .num_contexts = 1000,
+    .duration_s = 10,
+    .work_us = 50,
+    .end_permille = 10,
+    .block_permille = 0,
+    .watchdog_s = 5,
+    .pool_size = 0,
+    .pinned = true,
+    .verbose = false
+};
+
+static ums_completion_list_descriptor_t* lists;
+static stress_sched_t* scheds;
+
+static bool stop = false;   /** the run is over: the ums_contexts end and are no longer replaced */
+static bool failed = false; /** a scheduler got an unexpected error */
+static long live = 0;   /** ums_contexts created and not ended, the schedulers exit when it is 0 */
+
+#define STRESS_LOAD(var)        __atomic_load_n(&(var), __ATOMIC_SEQ_CST)
+#define STRESS_STORE(var, val)  __atomic_store_n(&(var), (val), __ATOMIC_SEQ_CST)
+
+// -----------------------------------------------------------------------------------------------------
+static void* routine_stress(void* args){
+    stress_context_t* c = args;
+    uint64_t until;
+    int r;
+
+    while(!STRESS_LOAD(stop)){
+        until = bench_now_ns() + (uint64_t)(rand_r(&c->seed) % (config.work_us + 1)) * 1000;
+        while(bench_now_ns() < until);
+
+        r = rand_r(&c->seed) % 1000;
+        if(r < config.end_permille)
+            break;
+        if(r < config.end_permille + config.block_permille)
+            usleep(1 + rand_r(&c->seed) % 100);    // REASON_THREAD_BLOCKED
+        yield();
+    }
+
+    free(c);
+    __atomic_sub_fetch(&live, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+/**
+ * @brief routine of the ums_contexts added at the end of the run to wake up the parked schedulers, not counted in live
+ *
+ */
+static void* routine_kick(void* args){
+    return NULL;
+}
+
+static stress_context_t* stress_context_new(unsigned int* seed){
+    stress_context_t* c = malloc(sizeof(stress_context_t));
+
+    if(c != NULL)
+        c->seed = rand_r(seed);
+    return c;
+}
+
+/**
+ * @brief replace an ended ums_context with a new one in the ums_completion_list of the scheduler
+ *
+ * live is incremented before stop is checked, so the main thread never sees live == 0 while a replacement is created
+ */
+static void stress_replace_context(stress_sched_t* s, ums_context_descriptor_t ended){
+    ums_context_descriptor_t ucd;
+    stress_context_t* c;
+    uint64_t t0;
+
+    delete_ums_context(ended);
+
+    __atomic_add_fetch(&live, 1, __ATOMIC_SEQ_CST);
+    if(STRESS_LOAD(stop) || (c = stress_context_new(&s->seed)) == NULL){
+        __atomic_sub_fetch(&live, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+
+    t0 = bench_now_ns();
+    if(create_ums_context(&ucd, routine_stress, c, NULL) != SUCCESS
+            || completion_list_add_ums_context(lists[s->list], ucd) != SUCCESS){
+        printf("%s(): scheduler %d, replacement not created, errno=%d\n", __func__, s->index, errno);
+        free(c);
+        __atomic_sub_fetch(&live, 1, __ATOMIC_SEQ_CST);
+        STRESS_STORE(failed, true);
+        return;
+    }
+    bench_samples_add(&s->replace_ns, bench_now_ns() - t0);
+    s->created++;
+}
+
+static inline void stress_progress(stress_sched_t* s){
+    __atomic_store_n(&s->last_progress_ns, bench_now_ns(), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief execute a ums_context of the completion_list or of the ready_list, the first one tried is random
+ *
+ * @return res_t Returns 0 on success, otherwise -1 and sets errno (ERR_EMPTY_READY_LIST if both are empty)
+ */
+static res_t stress_execute(stress_sched_t* s){
+    bool from_cl_first = rand_r(&s->seed) & 1;
+    uint64_t t0 = bench_now_ns();
+    res_t res;
+
+    res = (from_cl_first)? execute_next_new_thread() : execute_next_ready_thread();
+    if(res == -1 && (errno == ERR_EMPTY_COMP_LIST || errno == ERR_EMPTY_READY_LIST))
+        res = (from_cl_first)? execute_next_ready_thread() : execute_next_new_thread();
+    if(res == -1 && errno == ERR_EMPTY_COMP_LIST)
+        errno = ERR_EMPTY_READY_LIST;
+    bench_samples_add(&s->execute_ns, bench_now_ns() - t0);
+    return res;
+}
+
+static void entry_point_stress(entry_point_args_t* entry_point_args){
+    stress_sched_t* s = entry_point_args->sched_args;
+    uint64_t t0;
+    res_t res;
+
+    stress_progress(s);
+    s->last_reason = entry_point_args->reason;
+    switch(entry_point_args->reason){
+        case REASON_STARTUP:
+            s->pid = syscall(SYS_gettid);
+        break;
+        case REASON_THREAD_YIELD:
+            s->yields++;
+        break;
+        case REASON_THREAD_ENDED:
+            s->ends++;
+            stress_replace_context(s, entry_point_args->activation_payload);
+        break;
+        case REASON_THREAD_BLOCKED:
+            // the ums_context goes in the ready_list when its thread wakes up
+            s->blocks++;
+        break;
+    }
+    if(entry_point_args->reason != REASON_STARTUP)
+        __atomic_add_fetch(&s->switches, 1, __ATOMIC_RELAXED);
+
+    while(true){
+        res = stress_execute(s);
+        if(res == 0)
+            return;
+        if(errno != ERR_EMPTY_READY_LIST){
+            printf("%s(): scheduler %d, unexpected errno=%d\n", __func__, s->index, errno);
+            STRESS_STORE(failed, true);
+            break;
+        }
+        // nothing to do: at the end of the run exit when no ums_context is left, otherwise wait for work
+        if(STRESS_LOAD(stop) && STRESS_LOAD(live) == 0)
+            break;
+
+        __atomic_store_n(&s->parked, true, __ATOMIC_RELAXED);
+        t0 = bench_now_ns();
+        park_scheduler();
+        bench_samples_add(&s->park_ns, bench_now_ns() - t0);
+        __atomic_store_n(&s->parked, false, __ATOMIC_RELAXED);
+        s->parks++;
+        stress_progress(s);
+    }
+
+    STRESS_STORE(s->exited, true);
+    exit_scheduler(STRESS_LOAD(failed)? EXIT_FAILURE : 0);
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+/**
+ * @brief read a /proc file of the module in buf, an empty string if it is not available
+ *
+ */
+static void stress_read_proc(const char* path, char* buf, size_t size){
+    FILE* f = fopen(path, "r");
+    size_t n = 0;
+
+    if(f != NULL){
+        n = fread(buf, 1, size - 1, f);
+        fclose(f);
+    }
+    buf[n] = '\0';
+}
+
+static void stress_print_indented(const char* title, const char* text){
+    const char* line = text;
+    const char* end;
+
+    if(text[0] == '\0')
+        return;
+    printf("%s\n", title);
+    while(*line != '\0'){
+        end = strchr(line, '\n');
+        if(end == NULL)
+            end = line + strlen(line);
+        printf("    %.*s\n", (int)(end - line), line);
+        line = (*end == '\n')? end + 1 : end;
+    }
+}
+
+static unsigned long stress_total_switches(void){
+    unsigned long total = 0;
+    int j;
+
+    for(j = 0; j < config.num_scheds; j++)
+        total += __atomic_load_n(&scheds[j].switches, __ATOMIC_RELAXED);
+    return total;
+}
+
+/**
+ * @brief print the state of the schedulers and what the module exposes of them, then terminate the process
+ *
+ * The schedulers are stuck, the process can not be ended cleanly
+ */
+static void stress_hang(const char* what){
+    char path[128];
+    char buf[STRESS_PROC_MAX];
+    uint64_t now = bench_now_ns();
+    stress_sched_t* s;
+    int j;
+
+    printf("\nFAIL: %s\n", what);
+    printf("%4s %5s %6s %8s %8s %7s %12s %14s\n", "idx", "cpu", "list", "pid", "parked", "exited", "last_reason", "idle_ms");
+    for(j = 0; j < config.num_scheds; j++){
+        s = &scheds[j];
+        printf("%4d %5d %6d %8d %8d %7d %12d %14llu\n", s->index, s->cpu, s->list, s->pid,
+                    __atomic_load_n(&s->parked, __ATOMIC_RELAXED),
+                    STRESS_LOAD(s->exited),
+                    s->last_reason,
+                    (unsigned long long)(now - __atomic_load_n(&s->last_progress_ns, __ATOMIC_RELAXED)) / 1000000);
+    }
+    printf("live ums_contexts: %ld\n", STRESS_LOAD(live));
+
+    for(j = 0; j < config.num_scheds; j++){
+        if(STRESS_LOAD(scheds[j].exited))
+            continue;
+        snprintf(path, sizeof(path), "/proc/ums/%d/schedulers/%d/info", getpid(), scheds[j].pid);
+        stress_read_proc(path, buf, sizeof(buf));
+        stress_print_indented(path, buf);
+    }
+    snprintf(path, sizeof(path), "/proc/ums/%d/workers", getpid());
+    stress_read_proc(path, buf, sizeof(buf));
+    stress_print_indented(path, buf);
+
+    fflush(stdout);
+    _exit(2);
+}
+
+/**
+ * @brief watchdog: every 100ms checks that the schedulers make progress, until all of them have exited
+ *
+ * While the ums_contexts are running, a scheduler that is not parked must be called back within watchdog_s, since
+ * the slices are much shorter. A parked scheduler is reported if the others go on but it is not woken up.
+ * At the end of the run all the schedulers must exit within watchdog_s
+ */
+static void* stress_watchdog(void* args){
+    uint64_t timeout_ns = (uint64_t)config.watchdog_s * 1000000000ULL;
+    uint64_t last_switches_ns = bench_now_ns();
+    uint64_t stop_ns = 0;
+    unsigned long last_switches = 0;
+    unsigned long switches;
+    uint64_t now, idle;
+    bool all_exited;
+    char what[160];
+    stress_sched_t* s;
+    int j;
+
+    while(true){
+        usleep(100000);
+        now = bench_now_ns();
+
+        all_exited = true;
+        for(j = 0; j < config.num_scheds; j++){
+            s = &scheds[j];
+            if(STRESS_LOAD(s->exited))
+                continue;
+            all_exited = false;
+
+            idle = now - __atomic_load_n(&s->last_progress_ns, __ATOMIC_RELAXED);
+            if(s->last_progress_ns != 0 && !__atomic_load_n(&s->parked, __ATOMIC_RELAXED) && idle > timeout_ns){
+                snprintf(what, sizeof(what), "scheduler %d (pid %d) not called back for %llu ms, lost wake up of the scheduler",
+                            j, s->pid, (unsigned long long)idle / 1000000);
+                stress_hang(what);
+            }
+        }
+        if(all_exited)
+            return NULL;
+
+        switches = stress_total_switches();
+        if(switches != last_switches){
+            last_switches = switches;
+            last_switches_ns = now;
+        }
+        else if(!STRESS_LOAD(stop) && now - last_switches_ns > timeout_ns){
+            snprintf(what, sizeof(what), "no switch for %llu ms", (unsigned long long)(now - last_switches_ns) / 1000000);
+            stress_hang(what);
+        }
+
+        if(STRESS_LOAD(stop)){
+            if(stop_ns == 0)
+                stop_ns = now;
+            else if(now - stop_ns > timeout_ns){
+                snprintf(what, sizeof(what), "the schedulers did not exit %d s after the end of the run", config.watchdog_s);
+                stress_hang(what);
+            }
+        }
+    }
+}
+
+/**
+ * @brief end of the run: wait for the ums_contexts to end, then wake up the parked schedulers until all of them exit
+ *
+ * A ums_context is added to a completion_list to wake up its parked schedulers, they find live == 0 and exit
+ */
+static void stress_shutdown(void){
+    ums_context_descriptor_t ucd;
+    bool all_exited;
+    bool list_alive;
+    int i, j;
+
+    STRESS_STORE(stop, true);
+    while(STRESS_LOAD(live) > 0)
+        usleep(1000);
+
+    do{
+        all_exited = true;
+        for(i = 0; i < config.num_lists; i++){
+            list_alive = false;
+            for(j = i; j < config.num_scheds; j += config.num_lists)
+                list_alive |= !STRESS_LOAD(scheds[j].exited);
+            if(!list_alive)
+                continue;
+            all_exited = false;
+            if(create_ums_context(&ucd, routine_kick, NULL, NULL) == SUCCESS)
+                completion_list_add_ums_context(lists[i], ucd);
+        }
+        usleep(10000);
+    }while(!all_exited);
+}
+// -----------------------------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------------------------
+static void stress_print_samples(const char* name, bench_samples_t* samples){
+    bench_stats_t stats;
+
+    bench_stats_compute(samples, &stats);
+    printf("%-10s %10d %10llu %10llu %10llu %12llu\n", name, stats.num,
+                (unsigned long long)stats.min_ns,
+                (unsigned long long)stats.p50_ns,
+                (unsigned long long)stats.p99_ns,
+                (unsigned long long)stats.max_ns);
+}
+
+static void stress_report(uint64_t elapsed_ns){
+    bench_samples_t execute_ns, replace_ns, park_ns;
+    char buf[STRESS_PROC_MAX];
+    double seconds = (double)elapsed_ns / 1e9;
+    double total = 0, sum_sq = 0, min = 0, max = 0, x;
+    stress_sched_t* s;
+    int j;
+
+    printf("\n%4s %5s %6s %8s %12s %12s %7s %10s %10s %10s %10s %10s\n",
+                "idx", "cpu", "list", "pid", "switches", "switches/s", "share%", "yields", "ends", "blocks", "parks", "created");
+    for(j = 0; j < config.num_scheds; j++){
+        x = scheds[j].switches;
+        total += x;
+        sum_sq += x * x;
+        min = (j == 0 || x < min)? x : min;
+        max = (j == 0 || x > max)? x : max;
+    }
+    for(j = 0; j < config.num_scheds; j++){
+        s = &scheds[j];
+        printf("%4d %5d %6d %8d %12lu %12.0f %7.2f %10lu %10lu %10lu %10lu %10lu\n",
+                    s->index, s->cpu, s->list, s->pid, s->switches, s->switches / seconds,
+                    (total > 0)? 100.0 * s->switches / total : 0.0,
+                    s->yields, s->ends, s->blocks, s->parks, s->created);
+    }
+    printf("\nswitches=%.0f switches/s=%.0f fairness(jain)=%.4f min/max=%.4f\n",
+                total, total / seconds,
+                (sum_sq > 0)? (total * total) / (config.num_scheds * sum_sq) : 0.0,
+                (max > 0)? min / max : 0.0);
+
+    // user-side view of the requests, including the time spent waiting for the spin_locks and the rwlock
+    bench_samples_init(&execute_ns, config.num_scheds * STRESS_SAMPLES_MAX);
+    bench_samples_init(&replace_ns, config.num_scheds * STRESS_SAMPLES_MAX);
+    bench_samples_init(&park_ns, config.num_scheds * STRESS_SAMPLES_MAX);
+    for(j = 0; j < config.num_scheds; j++){
+        bench_samples_merge(&execute_ns, &scheds[j].execute_ns);
+        bench_samples_merge(&replace_ns, &scheds[j].replace_ns);
+        bench_samples_merge(&park_ns, &scheds[j].park_ns);
+    }
+    printf("\n%-10s %10s %10s %10s %10s %12s\n", "request", "samples", "min_ns", "p50_ns", "p99_ns", "max_ns");
+    stress_print_samples("execute", &execute_ns);
+    stress_print_samples("replace", &replace_ns);
+    stress_print_samples("park", &park_ns);
+    bench_samples_free(&execute_ns);
+    bench_samples_free(&replace_ns);
+    bench_samples_free(&park_ns);
+
+    // module-side view, the cycles spent in each request (reset at the start if the file is writable)
+    printf("\n");
+    stress_read_proc("/proc/ums/ioctl_stats", buf, sizeof(buf));
+    stress_print_indented("/proc/ums/ioctl_stats", buf);
+    for(j = 0; j < config.num_scheds; j++){
+        snprintf(buf, sizeof(buf), "scheduler %d (pid %d) latency", j, scheds[j].pid);
+        stress_print_indented(buf, scheds[j].latency);
+        snprintf(buf, sizeof(buf), "scheduler %d (pid %d) info", j, scheds[j].pid);
+        stress_print_indented(buf, scheds[j].info);
+    }
+}
+// -----------------------------------------------------------------------------------------------------
+
+static void usage(const char* prog){
+    fprintf(stderr,
+            "usage: %s [-l lists] [-s schedulers] [-k contexts] [-d seconds] [-w work_us] [-e end_permille] [-b block_permille]\n"
+            "          [-t watchdog_s] [-p pool_size] [-u] [-v]\n"
+            "  -l  ums_completion_lists (default %d)\n"
+            "  -s  schedulers, the j-th one manages the list j%%lists and is pinned to the cpu j%%ncpus (default ncpus, at least lists)\n"
+            "  -k  ums_contexts, an ended one is replaced by a new one (default %d)\n"
+            "  -d  duration of the run in seconds (default %d)\n"
+            "  -w  maximum length of a slice of a ums_context in us (default %d)\n"
+            "  -e  probability in thousandths that a ums_context ends after a slice (default %d)\n"
+            "  -b  probability in thousandths that a ums_context blocks in usleep() after a slice (default %d)\n"
+            "  -t  watchdog timeout in seconds (default %d)\n"
+            "  -p  worker pool size of the schedulers (default %d)\n"
+            "  -u  do not pin the schedulers\n"
+            "  -v  print the switches every second\n",
+            prog, config.num_lists, config.num_contexts, config.duration_s, config.work_us,
+            config.end_permille, config.block_permille, config.watchdog_s, config.pool_size);
+}
+
+int main(int argc, char **argv){
+    ums_scheduler_attr_t attr;
+    ums_context_descriptor_t ucd;
+    stress_context_t* c;
+    pthread_t watchdog;
+    unsigned int seed = 1;
+    uint64_t start_ns, end_ns, next_ns;
+    unsigned long last_switches = 0;
+    char path[128];
+    FILE* f;
+    int opt, i, j, ret;
+    int res = EXIT_SUCCESS;
+
+    while((opt = getopt(argc, argv, "l:s:k:d:w:e:b:t:p:uvh")) != -1){
+        switch(opt){
+            case 'l': config.num_lists = atoi(optarg); break;
+            case 's': config.num_scheds = atoi(optarg); break;
+            case 'k': config.num_contexts = atoi(optarg); break;
+            case 'd': config.duration_s = atoi(optarg); break;
+            case 'w': config.work_us = atoi(optarg); break;
+            case 'e': config.end_permille = atoi(optarg); break;
+            case 'b': config.block_permille = atoi(optarg); break;
+            case 't': config.watchdog_s = atoi(optarg); break;
+            case 'p': config.pool_size = atoi(optarg); break;
+            case 'u': config.pinned = false; break;
+            case 'v': config.verbose = true; break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(config.num_scheds == 0)
+        config.num_scheds = (get_nprocs() > config.num_lists)? get_nprocs() : config.num_lists;
+    if(config.num_lists < 1 || config.num_scheds < config.num_lists || config.num_contexts < 1 || config.duration_s < 1
+            || config.work_us < 0 || config.end_permille < 0 || config.block_permille < 0
+            || config.end_permille + config.block_permille > 1000 || config.watchdog_s < 1 || config.pool_size < 0){
+        fprintf(stderr, "invalid arguments, there must be at least a scheduler for each list\n");
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if(ums_init() != SUCCESS){
+        fprintf(stderr, "ums_init() failed, is the module loaded?\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("lists=%d schedulers=%d contexts=%d duration_s=%d work_us=%d end_permille=%d block_permille=%d pinned=%d pool_size=%d\n",
+                config.num_lists, config.num_scheds, config.num_contexts, config.duration_s, config.work_us,
+                config.end_permille, config.block_permille, config.pinned, config.pool_size);
+
+    lists = calloc(config.num_lists, sizeof(ums_completion_list_descriptor_t));
+    scheds = calloc(config.num_scheds, sizeof(stress_sched_t));
+    if(lists == NULL || scheds == NULL)
+        return EXIT_FAILURE;
+
+    for(i = 0; i < config.num_lists; i++){
+        if(create_ums_completion_list(&lists[i]) != SUCCESS){
+            printf("create_ums_completion_list() failed, errno=%d\n", errno);
+            return EXIT_FAILURE;
+        }
+    }
+    for(i = 0; i < config.num_contexts; i++){
+        c = stress_context_new(&seed);
+        if(c == NULL || create_ums_context(&ucd, routine_stress, c, NULL) != SUCCESS
+                || completion_list_add_ums_context(lists[i % config.num_lists], ucd) != SUCCESS){
+            printf("ums_context %d not created, errno=%d\n", i, errno);
+            return EXIT_FAILURE;
+        }
+        live++;
+    }
+
+    // the statistics of the requests are global, reset them if allowed
+    f = fopen("/proc/ums/ioctl_stats", "w");
+    if(f != NULL){
+        fputs("0\n", f);
+        fclose(f);
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.pool_size = config.pool_size;
+    attr.pool_warm_up = config.pool_size;
+
+    start_ns = bench_now_ns();
+    for(j = 0; j < config.num_scheds; j++){
+        stress_sched_t* s = &scheds[j];
+        s->index = j;
+        s->list = j % config.num_lists;
+        s->cpu = (config.pinned)? j % get_nprocs() : -1;
+        s->seed = rand_r(&seed);
+        if(bench_samples_init(&s->execute_ns, STRESS_SAMPLES_MAX) != 0
+                || bench_samples_init(&s->replace_ns, STRESS_SAMPLES_MAX) != 0
+                || bench_samples_init(&s->park_ns, STRESS_SAMPLES_MAX) != 0)
+            return EXIT_FAILURE;
+        if(create_ums_scheduler_attr(&s->sd, lists[s->list], entry_point_stress, s, s->cpu, &attr) != SUCCESS){
+            printf("create_ums_scheduler_attr() failed, errno=%d\n", errno);
+            return EXIT_FAILURE;
+        }
+    }
+    pthread_create(&watchdog, NULL, stress_watchdog, NULL);
+
+    // run
+    next_ns = start_ns + 1000000000ULL;
+    end_ns = start_ns + (uint64_t)config.duration_s * 1000000000ULL;
+    while(bench_now_ns() < end_ns && !STRESS_LOAD(failed)){
+        usleep(10000);
+        if(config.verbose && bench_now_ns() >= next_ns){
+            unsigned long switches = stress_total_switches();
+            fprintf(stderr, "t=%llus switches/s=%lu live=%ld\n",
+                        (unsigned long long)(next_ns - start_ns) / 1000000000ULL, switches - last_switches, STRESS_LOAD(live));
+            last_switches = switches;
+            next_ns += 1000000000ULL;
+        }
+    }
+    end_ns = bench_now_ns();
+
+    // the /proc entries of a scheduler are removed when it exits
+    for(j = 0; j < config.num_scheds; j++){
+        snprintf(path, sizeof(path), "/proc/ums/%d/schedulers/%d/info", getpid(), scheds[j].pid);
+        stress_read_proc(path, scheds[j].info, sizeof(scheds[j].info));
+        snprintf(path, sizeof(path), "/proc/ums/%d/schedulers/%d/latency", getpid(), scheds[j].pid);
+        stress_read_proc(path, scheds[j].latency, sizeof(scheds[j].latency));
+    }
+
+    stress_shutdown();
+    for(j = 0; j < config.num_scheds; j++){
+        join_scheduler(&scheds[j].sd, &ret);
+        if(ret != 0)
+            res = EXIT_FAILURE;
+    }
+    pthread_join(watchdog, NULL);
+
+    stress_report(end_ns - start_ns);
+
+    for(i = 0; i < config.num_lists; i++)
+        delete_ums_completion_list(lists[i]);
+    for(j = 0; j < config.num_scheds; j++){
+        bench_samples_free(&scheds[j].execute_ns);
+        bench_samples_free(&scheds[j].replace_ns);
+        bench_samples_free(&scheds[j].park_ns);
+    }
+    free(scheds);
+    free(lists);
+    ums_destroy();
+
+    if(STRESS_LOAD(failed))
+        res = EXIT_FAILURE;
+    printf("\n%s\n", (res == EXIT_SUCCESS)? "PASS" : "FAIL");
+    return res;
+}
@@ -65,9 +65,9 @@ int main(int argc, char **argv){
     ums_completion_list_descriptor_t uld_0;
 
     
-    create_ums_context(&ucd_0, &routine, &value_0, &info_0);
-    create_ums_context(&ucd_1, &routine, &value_1, &info_1);
-    create_ums_context(&ucd_2, &routine, &value_2, &info_2);
+    create_ums_context_prio(&ucd_0, &routine, &value_0, &info_0, info_0.prio);
+    create_ums_context_prio(&ucd_1, &routine, &value_1, &info_1, info_1.prio);
+    create_ums_context_prio(&ucd_2, &routine, &value_2, &info_2, info_2.prio);
 
 
     
@@ -113,9 +113,6 @@ void entry_point(entry_point_args_t* entry_point_args){
     info_ums_context_t* iuc_to_exec;
     my_info_t* my_info;
 
-    int best_prio;
-    int best_id;
-
     switch(entry_point_args->reason){
         case REASON_STARTUP:
             printf("Startup\n");
@@ -138,8 +135,8 @@ void entry_point(entry_point_args_t* entry_point_args){
                 iuc_to_exec = &(info_ums_context[0]);
                 res = execute(iuc_to_exec);
                 if(res == -1){
-                    if(errno==ERR_ASSIGNED){
-                        printf("ums context already assigned, I will try the next one\n");
+                    if(errno==ERR_ASSIGNED || errno==ERR_STALE){
+                        printf("ums context already taken, I will try the next one\n");
                         res = execute_next_new_thread();
                         if(res == -1){
                             printf("error during execute_next_new_thread(). Exit\n");
@@ -166,37 +163,10 @@ void entry_point(entry_point_args_t* entry_point_args){
             if(res == -1){
                 if(errno == ERR_EMPTY_COMP_LIST){
                     printf("%s(): REASON_THREAD_YIELDED --- empty completion list\n", __func__);
-                    res = get_ums_contexts_from_rl(info_ums_context, 5);
-                    if(res > 0){
-                        best_prio = 99;
-                        best_id = -1;
-
-                        for(int i=0; i<res; i++){
-                            my_info = (my_info_t*) info_ums_context[i].user_reserved;
-
-                            printf("rl : info: id=%d, "
-                                                "time%u, " 
-                                                "ns=%d, "
-                                                "user=%d"
-                                                "\n"
-                                                , 
-                                                info_ums_context[i].ucd,
-                                                info_ums_context[i].run_time_ms, 
-                                                info_ums_context[i].number_switch, 
-                                                my_info->prio);
-
-                            if(my_info->prio < best_prio){
-                                best_prio = my_info->prio;
-                                best_id = info_ums_context[i].ucd;
-                            }
-                        }
-                        printf("chosen %d\n", best_id);
-                        iuc_to_exec = &(info_ums_context[best_id]);
-                        res = execute(iuc_to_exec);
-                        if(res == -1){
-                            printf("unexpected errno=%d\n", errno);
-                            exit_scheduler(EXIT_FAILURE);
-                        }
+                    // the kernel keeps the ready_list ordered by prio, no need to scan it
+                    res = execute_highest_prio_ready_thread();
+                    if(res == 0){
+                        printf("executed the highest priority ready context\n");
                     }
                     else if(errno == ERR_EMPTY_READY_LIST){
                         printf("ready list ended\n");